@@ -7,10 +7,21 @@ layout(location = 2) in vec3 fragNormal;
 layout(location = 3) in vec3 toColor;
 
 layout(binding = 1) uniform sampler2D texSampler;
+layout(binding = 2) uniform samplerCube envSampler;
+
+//the vertex stage reads the model matrix in front of it
+layout(push_constant) uniform drawblock {
+    layout(offset = 64) uint material;
+} draw;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler,fragCoords);
+    //sky light from the environment map, a small level stands in for irradiance
+    vec3 ambient = textureLod(envSampler, normalize(fragNormal), 6.0).rgb;
+    if (draw.material == 1)
+        outColor = vec4(fragColor * (0.6 * ambient + max(toColor, vec3(0.0))), 1.0);
+    else
+        outColor = texture(texSampler,fragCoords) * vec4(0.7 + 0.6 * ambient, 1.0);
     //outColor = vec4(toColor,1);
 }
\ No newline at end of file
@@ -8,10 +8,19 @@ layout(binding = 0) uniform uboobject {
     vec3 lightPos;
 } ubo;
 
+//per draw, DrawConstants
+layout(push_constant) uniform drawblock {
+    mat4 model;
+    uint material;
+} draw;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inColor;
 layout(location = 3) in vec2 inCoords;
+//per instance
+layout(location = 4) in mat4 instanceModel;
+layout(location = 8) in vec3 instanceColor;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragCoords;
@@ -29,9 +38,10 @@ void main() {
     float NdotL = dot(N, normalize(lightPos));
     vec3 color = vec3(0.7,0.7,0.75) * NdotL;
     
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    gl_Position = ubo.proj * ubo.view * draw.model * instanceModel * vec4(inPosition, 1.0);
+    fragColor = inColor * instanceColor;
     fragCoords = inCoords;
     toColor = color;
-    //fragNormal = ubo.lightPos;
+    //world space for the environment map, the instances only scale uniformly
+    fragNormal = mat3(draw.model * instanceModel) * inNormal;
 }
\ No newline at end of file
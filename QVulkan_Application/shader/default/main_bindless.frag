@@ -0,0 +1,30 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragCoords;
+layout(location = 2) in vec3 fragNormal;
+layout(location = 3) in vec3 toColor;
+
+layout(binding = 2) uniform samplerCube envSampler;
+//BindlessTable, every material texture of the renderer
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+//the vertex stage reads the model matrix in front of it
+layout(push_constant) uniform drawblock {
+    layout(offset = 64) uint material;
+    uint texture;
+} draw;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    //sky light from the environment map, a small level stands in for irradiance
+    vec3 ambient = textureLod(envSampler, normalize(fragNormal), 6.0).rgb;
+    if (draw.material == 1)
+        outColor = vec4(fragColor * (0.6 * ambient + max(toColor, vec3(0.0))), 1.0);
+    else
+        //a push constant, the same slot for the whole draw
+        outColor = texture(textures[draw.texture], fragCoords) * vec4(0.7 + 0.6 * ambient, 1.0);
+}
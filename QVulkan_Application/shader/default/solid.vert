@@ -8,10 +8,17 @@ layout(binding = 0) uniform uboobject {
     vec3 lightPos;
 } ubo;
 
+//per draw, DrawConstants
+layout(push_constant) uniform drawblock {
+    mat4 model;
+    uint material;
+} draw;
+
+//position only stream, the pipeline has no attribute binding
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec3 inColor;
-layout(location = 3) in vec2 inCoords;
+//per instance
+layout(location = 4) in mat4 instanceModel;
+layout(location = 8) in vec3 instanceColor;
 
 out gl_PerVertex {
    vec4 gl_Position;
@@ -19,6 +26,6 @@ out gl_PerVertex {
 
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * draw.model * instanceModel * vec4(inPosition, 1.0);
    
 }
\ No newline at end of file
@@ -4,9 +4,6 @@
 #include <scene.h>
 #include <QMouseEvent>
 
-#ifdef VML_USE_VULKAN
-#undef VML_USE_VULKAN
-#endif
 #include <matrix4x4.h>
 
 GLWindow::GLWindow(QWidget* parent) 
@@ -76,8 +73,8 @@ void GLWindow::mousePressEvent(QMouseEvent *e)
 void GLWindow::updateUniformBuffer(int w, int h)
 {
 	float aspect = w / (float)h;
-	ubo.data.proj = vml::perspectiveRH(45.f, aspect, 0.001f, 1000.f).transposed();
-	ubo.data.view = vml::lookAt(vec3f(3, 3, 3), vec3f(0, 0, 0), vec3f(0, 1, 0)).transposed();
+	ubo.data.proj = vml::perspective<vml::OpenGLConvention>(45.f, aspect, 0.001f, 1000.f).transposed();
+	ubo.data.view = vml::lookAt<vml::OpenGLConvention>(vec3f(3, 3, 3), vec3f(0, 0, 0), vec3f(0, 1, 0)).transposed();
 	ubo.data.lightPos = vec3f(4, 4, 4);
 
 	glBindBuffer(GL_UNIFORM_BUFFER, ubo.buffer);
@@ -47,6 +47,15 @@ void VKWindow::mousePressEvent(QMouseEvent *e)
 	{
 		m_renderer->updateShader();
 	}
+	if (e->buttons() == Qt::MiddleButton && m_renderer->isBuilt)
+	{
+		RayHit hit;
+		if (m_renderer->m_scene->pick((float)e->pos().x(), (float)e->pos().y(), hit))
+			LOG << "picked instance " << hit.instance << " mesh " << m_renderer->m_scene->instances[hit.instance].mesh
+				<< " triangle " << hit.triangle << " t " << hit.t << ENDL;
+		else
+			LOG << "picked nothing" << ENDL;
+	}
 	QWindow::mousePressEvent(e);
 }
 
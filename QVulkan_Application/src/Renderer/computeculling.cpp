@@ -0,0 +1,744 @@
+#include "computeculling.h"
+#include <vkrenderer.h>
+#include <vkdevice.h>
+#include <vklog.h>
+#include <vkdescriptor.h>
+#include <vkattachment.h>
+#include <scene.h>
+#include <array>
+
+namespace
+{
+	const uint32_t GROUP_SIZE = 64;
+	const uint32_t HIZ_GROUP_SIZE = 8;
+	//frames averaged by one report
+	const uint32_t REPORT_INTERVAL = 256;
+
+	//toRoot is the inverse of Scene::drawModel
+	void writeInstance(const Scene* scene, uint32_t index, const std::vector<uint32_t> &firstSlot,
+		const std::vector<uint32_t> &firstInstance, const Matrix4x4 &toRoot, GpuInstance &out)
+	{
+		const Instance &instance = scene->instances[index];
+		const Bounds &b = scene->worldBounds[index];
+		out.model = scene->instanceModel(index, toRoot).transposed();
+		out.color[0] = instance.color.x;
+		out.color[1] = instance.color.y;
+		out.color[2] = instance.color.z;
+		out.color[3] = 0.0f;
+		out.sphere[0] = b.center.x;
+		out.sphere[1] = b.center.y;
+		out.sphere[2] = b.center.z;
+		out.sphere[3] = b.radius;
+		out.boxMin[0] = b.min.x;
+		out.boxMin[1] = b.min.y;
+		out.boxMin[2] = b.min.z;
+		out.boxMin[3] = 0.0f;
+		out.boxMax[0] = b.max.x;
+		out.boxMax[1] = b.max.y;
+		out.boxMax[2] = b.max.z;
+		out.boxMax[3] = 0.0f;
+		//the levels of a mesh sit next to each other, in slots and in the stream
+		const VKMesh* mesh = scene->meshs[instance.mesh].get();
+		uint32_t slot = firstSlot[instance.mesh];
+		out.slot = slot;
+		out.region = firstInstance[slot];
+		out.regionSize = firstInstance[slot + 1] - firstInstance[slot];
+		out.lodCount = std::min(mesh->lodCount(), 5U);
+		float scale = scene->instanceScale(index);
+		for (uint32_t l = 0; l < 4; ++l)
+			out.lodError[l] = l + 1 < out.lodCount ? mesh->lods[l + 1].error * scale : FLT_MAX;
+	}
+
+	uint32_t floorPow2(uint32_t v)
+	{
+		uint32_t p = 1;
+		while (p * 2 <= v) p *= 2;
+		return p;
+	}
+}
+
+ComputeCulling::ComputeCulling(VkRenderer* renderer)
+	: m_renderer(renderer), m_vulkanDevice(renderer->m_vulkanDevice), m_device(renderer->m_device),
+	m_descriptors(renderer->m_device, 4), m_hizDescriptors(renderer->m_device, 16)
+{
+	//sampling is optional for depth formats, without it only the frustum test runs
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(m_renderer->m_physicalDevice, m_renderer->m_depthFormat, &properties);
+	m_occlusion = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	m_timestamps = m_vulkanDevice->m_properties.limits.timestampComputeAndGraphics == VK_TRUE;
+
+	if (m_timestamps)
+	{
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = TIMESTAMP_COUNT;
+		LOG_ERROR("failed to create timestamp query pool") <<
+			vkCreateQueryPool(m_device, &queryInfo, nullptr, &m_queryPool);
+		//update reads the pool before the first frame wrote it, reset queries are only not ready
+		VkCommandBuffer cmd = m_vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		vkCmdResetQueryPool(cmd, m_queryPool, 0, TIMESTAMP_COUNT);
+		m_vulkanDevice->flushCommandBuffer(cmd, m_renderer->m_queue);
+	}
+	LOG << "occlusion culling : " << (m_occlusion ? "on" : "off, depth format can not be sampled")
+		<< " gpu timestamps : " << (m_timestamps ? "on" : "off") << ENDL;
+}
+
+ComputeCulling::~ComputeCulling()
+{
+	report();
+	release();
+	releasePyramid();
+	if (m_queryPool)
+		vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+}
+
+bool ComputeCulling::supported(VulkanDevice* vulkanDevice)
+{
+	uint32_t graphics = vulkanDevice->m_queueFamilyIndices.graphics;
+	return (vulkanDevice->m_queueFamilyProperties[graphics].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+}
+
+void ComputeCulling::release()
+{
+	if (m_instanceData)
+		vkUnmapMemory(m_device, m_instances.memory);
+	if (m_cullDataMapped)
+		vkUnmapMemory(m_device, m_cullData.memory);
+	if (m_readbackMapped)
+		vkUnmapMemory(m_device, m_readback.memory);
+	m_instanceData = NULL;
+	m_cullDataMapped = NULL;
+	m_readbackMapped = NULL;
+
+	Buffer* buffers[] = { &m_instances, &m_stream, &m_commands, &m_resetCommands, &m_cullData,
+		&m_counters, &m_readback };
+	for (Buffer* buffer : buffers)
+	{
+		if (buffer->buffer)
+			m_vulkanDevice->destroyBuffer(buffer->buffer, buffer->memory);
+		*buffer = Buffer();
+	}
+
+	if (m_pipeline)
+		vkDestroyPipeline(m_device, m_pipeline, nullptr);
+	if (m_pipelineLayout)
+		vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+	//the layout stays in the renderer's cache for the next build
+	m_descriptors.reset();
+	m_pipeline = VK_NULL_HANDLE;
+	m_pipelineLayout = VK_NULL_HANDLE;
+	m_descriptorSetLayout = VK_NULL_HANDLE;
+	m_descriptorSet = VK_NULL_HANDLE;
+}
+
+void ComputeCulling::build(Scene* scene)
+{
+	LOG_SECTION("build compute culling");
+	release();
+	if (!m_hiz)
+		buildPyramid();
+	m_instanceCount = (uint32_t)scene->instances.size();
+	m_meshCount = (uint32_t)scene->meshs.size();
+	uint32_t phaseCount = phases();
+
+	/*REGIONS*/
+	//every level of a mesh owns room for all of its instances in the stream,
+	//once per phase
+	m_firstSlot.assign(m_meshCount + 1, 0);
+	for (uint32_t m = 0; m < m_meshCount; ++m)
+		m_firstSlot[m + 1] = m_firstSlot[m] + std::min(scene->meshs[m]->lodCount(), 5U);
+	m_slotCount = m_firstSlot[m_meshCount];
+	std::vector<uint32_t> meshInstances(m_meshCount, 0);
+	for (auto &instance : scene->instances)
+		meshInstances[instance.mesh]++;
+	m_firstInstance.assign(m_slotCount + 1, 0);
+	for (uint32_t m = 0; m < m_meshCount; ++m)
+		for (uint32_t slot = m_firstSlot[m]; slot < m_firstSlot[m + 1]; ++slot)
+			m_firstInstance[slot + 1] = m_firstInstance[slot] + meshInstances[m];
+	uint32_t streamCount = m_firstInstance[m_slotCount];
+
+	/*BUFFERS*/
+	VkDeviceSize instanceSize = sizeof(GpuInstance) * std::max(1U, m_instanceCount);
+	m_vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_instances.buffer, m_instances.memory, instanceSize);
+	LOG_ERROR("failed to map gpu instances") <<
+		vkMapMemory(m_device, m_instances.memory, 0, instanceSize, 0, (void**)&m_instanceData);
+	Matrix4x4 toRoot = scene->drawModel().invertedAffine();
+	for (uint32_t i = 0; i < m_instanceCount; ++i)
+		writeInstance(scene, i, m_firstSlot, m_firstInstance, toRoot, m_instanceData[i]);
+
+	VkDeviceSize streamSize = sizeof(InstanceVertex) * std::max(1U, streamCount) * phaseCount;
+	m_vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_stream.buffer, m_stream.memory, streamSize);
+
+	//firstInstance stays 0, draw binds the stream at the slot's region so
+	//drawIndirectFirstInstance is not needed
+	std::vector<VkDrawIndexedIndirectCommand> commands(std::max(1U, m_slotCount * phaseCount));
+	for (uint32_t m = 0; m < m_meshCount; ++m)
+	{
+		for (uint32_t slot = m_firstSlot[m]; slot < m_firstSlot[m + 1]; ++slot)
+		{
+			MeshLod lod = scene->meshs[m]->lod(slot - m_firstSlot[m]);
+			for (uint32_t phase = 0; phase < phaseCount; ++phase)
+			{
+				VkDrawIndexedIndirectCommand &command = commands[phase * m_slotCount + slot];
+				command.indexCount = lod.indexCount;
+				command.instanceCount = 0;
+				command.firstIndex = lod.firstIndex;
+				command.vertexOffset = 0;
+				command.firstInstance = 0;
+			}
+		}
+	}
+	VkDeviceSize commandSize = sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+	m_vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_commands.buffer, m_commands.memory, commandSize);
+	m_vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_resetCommands.buffer, m_resetCommands.memory, commandSize);
+	void* data;
+	vkMapMemory(m_device, m_resetCommands.memory, 0, commandSize, 0, &data);
+	memcpy(data, commands.data(), (size_t)commandSize);
+	vkUnmapMemory(m_device, m_resetCommands.memory);
+
+	m_vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_cullData.buffer, m_cullData.memory, sizeof(GpuCullData));
+	LOG_ERROR("failed to map cull data") <<
+		vkMapMemory(m_device, m_cullData.memory, 0, sizeof(GpuCullData), 0, (void**)&m_cullDataMapped);
+	*m_cullDataMapped = GpuCullData();
+	m_cullDataMapped->instanceCount = m_instanceCount;
+	m_cullDataMapped->slotCount = m_slotCount;
+	m_cullDataMapped->streamSize = streamCount;
+	m_cullDataMapped->occlusion = m_occlusion ? 1 : 0;
+	m_cullDataMapped->hizSize[0] = (float)m_hizWidth;
+	m_cullDataMapped->hizSize[1] = (float)m_hizHeight;
+
+	//counters stay on the device, the stats part is copied out once per frame
+	VkDeviceSize counterSize = sizeof(GpuCullStats) + sizeof(uint32_t) * std::max(1U, m_instanceCount);
+	m_vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_counters.buffer, m_counters.memory, counterSize);
+	m_vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_readback.buffer, m_readback.memory, sizeof(GpuCullStats));
+	LOG_ERROR("failed to map cull counters") <<
+		vkMapMemory(m_device, m_readback.memory, 0, sizeof(GpuCullStats), 0, (void**)&m_readbackMapped);
+	memset(m_readbackMapped, 0, sizeof(GpuCullStats));
+
+	buildPipelines();
+
+	LOG << "gpu instances : " << m_instanceCount << " meshs : " << m_meshCount << " levels : " << m_slotCount
+		<< " phases : " << phaseCount
+		<< " instance data : " << instanceSize << " stream : " << streamSize << ENDL;
+}
+
+void ComputeCulling::buildPipelines()
+{
+	/*DESCRIPTORS*/
+	//instances, commands, stream, cull data, pyramid, counters
+	std::array<VkDescriptorSetLayoutBinding, 6> bindings = {};
+	for (uint32_t i = 0; i < bindings.size(); ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	m_descriptorSetLayout = m_renderer->m_layoutCache->get(bindings.data(), (uint32_t)bindings.size());
+	//the pyramid binding is written again after every resize, so not a cached set
+	m_descriptorSet = m_descriptors.allocate(m_descriptorSetLayout);
+
+	VkDescriptorBufferInfo bufferInfos[6] = {
+		{ m_instances.buffer, 0, VK_WHOLE_SIZE },
+		{ m_commands.buffer, 0, VK_WHOLE_SIZE },
+		{ m_stream.buffer, 0, VK_WHOLE_SIZE },
+		{ m_cullData.buffer, 0, sizeof(GpuCullData) },
+		{},
+		{ m_counters.buffer, 0, VK_WHOLE_SIZE }
+	};
+	std::array<VkWriteDescriptorSet, 5> writes = {};
+	uint32_t write = 0;
+	for (uint32_t i = 0; i < bindings.size(); ++i)
+	{
+		if (i == 4) continue;
+		writes[write].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[write].dstSet = m_descriptorSet;
+		writes[write].dstBinding = i;
+		writes[write].descriptorCount = 1;
+		writes[write].descriptorType = bindings[i].descriptorType;
+		writes[write].pBufferInfo = &bufferInfos[i];
+		++write;
+	}
+	vkUpdateDescriptorSets(m_device, writes.size(), writes.data(), 0, nullptr);
+	writePyramidDescriptor();
+
+	/*PIPELINE*/
+	//phase index
+	VkPushConstantRange pushRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) };
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+	LOG_ERROR("failed to create culling pipeline layout") <<
+		vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout);
+
+	m_cullShader = shader_ptr(new Shader(m_device));
+	m_cullShader->buildCompute("./shader/default/cull.comp");
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = m_cullShader->shaderStage[0];
+	pipelineInfo.layout = m_pipelineLayout;
+	LOG_ERROR("failed to create culling pipeline") <<
+		vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline);
+}
+
+void ComputeCulling::writePyramidDescriptor()
+{
+	VkDescriptorImageInfo hizInfo{};
+	hizInfo.sampler = m_sampler;
+	hizInfo.imageView = m_hizView;
+	hizInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_descriptorSet;
+	write.dstBinding = 4;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &hizInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+/*HIERARCHICAL Z*/
+void ComputeCulling::buildPyramid()
+{
+	//the cull pass always binds a pyramid, it is only reduced into with occlusion
+	m_depthSource = m_renderer->m_depthStencil.depthView;
+	m_depthGeneration = m_renderer->m_targetGeneration;
+	//the depth is drawn at the render extent, below the swapchain's with dynamic resolution
+	VkExtent2D extent = m_renderer->renderExtent();
+	m_depthWidth = extent.width;
+	m_depthHeight = extent.height;
+	m_hizWidth = floorPow2(std::max(1U, m_depthWidth));
+	m_hizHeight = floorPow2(std::max(1U, m_depthHeight));
+	m_hizLevels = 1;
+	while ((m_hizWidth >> m_hizLevels) || (m_hizHeight >> m_hizLevels))
+		++m_hizLevels;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.extent = { m_hizWidth, m_hizHeight, 1 };
+	imageInfo.mipLevels = m_hizLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	LOG_ERROR("failed to create hi-z image") <<
+		vkCreateImage(m_device, &imageInfo, nullptr, &m_hiz);
+
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(m_device, m_hiz, &memReqs);
+	VkMemoryAllocateInfo memAllocInfo{};
+	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memAllocInfo.allocationSize = memReqs.size;
+	memAllocInfo.memoryTypeIndex = m_vulkanDevice->getMemoryType(memReqs.memoryTypeBits,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	LOG_ERROR("failed to allocate hi-z memory") <<
+		vkAllocateMemory(m_device, &memAllocInfo, nullptr, &m_hizMemory);
+	vkBindImageMemory(m_device, m_hiz, m_hizMemory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_hiz;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_hizLevels, 0, 1 };
+	LOG_ERROR("failed to create hi-z view") <<
+		vkCreateImageView(m_device, &viewInfo, nullptr, &m_hizView);
+	m_hizLevelViews.resize(m_hizLevels);
+	for (uint32_t level = 0; level < m_hizLevels; ++level)
+	{
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+		LOG_ERROR("failed to create hi-z level view") <<
+			vkCreateImageView(m_device, &viewInfo, nullptr, &m_hizLevelViews[level]);
+	}
+
+	//texelFetch while reducing, four nearest taps while testing
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = (float)m_hizLevels;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	LOG_ERROR("failed to create hi-z sampler") <<
+		vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler);
+
+	//the pyramid lives in GENERAL, written as storage and sampled in turns.
+	//the depth starts at the far plane so the first frame rejects nothing
+	VkCommandBuffer cmd = m_vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	std::array<VkImageMemoryBarrier, 2> barriers = {};
+	for (auto &barrier : barriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+	VkImageAspectFlags aspect = attachmentAspect(m_renderer->m_depthFormat);
+	barriers[0].image = m_hiz;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_hizLevels, 0, 1 };
+	barriers[1].image = m_renderer->m_depthStencil.image;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].subresourceRange = { aspect, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, m_occlusion ? 2 : 1, barriers.data());
+	if (m_occlusion)
+	{
+		VkClearDepthStencilValue farPlane = { 1.0f, 0 };
+		VkImageSubresourceRange range = { aspect, 0, 1, 0, 1 };
+		vkCmdClearDepthStencilImage(cmd, m_renderer->m_depthStencil.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			&farPlane, 1, &range);
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barriers[1]);
+	}
+	m_vulkanDevice->flushCommandBuffer(cmd, m_renderer->m_queue);
+
+	LOG << "hi-z pyramid : " << m_hizWidth << " x " << m_hizHeight << " levels : " << m_hizLevels << ENDL;
+	if (!m_occlusion)
+		return;
+
+	/*REDUCTION*/
+	//one set per level, level 0 reads the depth and every other level the one above
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+	bindings[0].binding = 0;
+	bindings[0].descriptorCount = 1;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1] = bindings[0];
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	m_hizSetLayout = m_renderer->m_layoutCache->get(bindings.data(), (uint32_t)bindings.size());
+
+	m_hizSets.resize(m_hizLevels);
+	for (uint32_t level = 0; level < m_hizLevels; ++level)
+	{
+		m_hizSets[level] = m_hizDescriptors.allocate(m_hizSetLayout);
+		VkDescriptorImageInfo source{};
+		source.sampler = m_sampler;
+		source.imageView = level ? m_hizLevelViews[level - 1] : m_depthSource;
+		source.imageLayout = level ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		VkDescriptorImageInfo target{};
+		target.imageView = m_hizLevelViews[level];
+		target.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> writes = {};
+		for (uint32_t i = 0; i < writes.size(); ++i)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = m_hizSets[level];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = bindings[i].descriptorType;
+		}
+		writes[0].pImageInfo = &source;
+		writes[1].pImageInfo = &target;
+		vkUpdateDescriptorSets(m_device, writes.size(), writes.data(), 0, nullptr);
+	}
+
+	//source and target size
+	VkPushConstantRange pushRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, 4 * sizeof(int32_t) };
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_hizSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+	LOG_ERROR("failed to create hi-z pipeline layout") <<
+		vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_hizPipelineLayout);
+
+	m_hizShader = shader_ptr(new Shader(m_device));
+	m_hizShader->buildCompute("./shader/default/hiz.comp");
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = m_hizShader->shaderStage[0];
+	pipelineInfo.layout = m_hizPipelineLayout;
+	LOG_ERROR("failed to create hi-z pipeline") <<
+		vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_hizPipeline);
+}
+
+void ComputeCulling::releasePyramid()
+{
+	if (!m_hiz) return;
+	if (m_hizPipeline)
+	{
+		vkDestroyPipeline(m_device, m_hizPipeline, nullptr);
+		vkDestroyPipelineLayout(m_device, m_hizPipelineLayout, nullptr);
+		//the level sets point at the views destroyed below, all go at once
+		m_hizDescriptors.reset();
+	}
+	vkDestroySampler(m_device, m_sampler, nullptr);
+	for (auto view : m_hizLevelViews)
+		vkDestroyImageView(m_device, view, nullptr);
+	vkDestroyImageView(m_device, m_hizView, nullptr);
+	vkDestroyImage(m_device, m_hiz, nullptr);
+	vkFreeMemory(m_device, m_hizMemory, nullptr);
+	m_hizLevelViews.clear();
+	m_hizSets.clear();
+	m_hizShader.reset();
+	m_hizPipeline = VK_NULL_HANDLE;
+	m_hizPipelineLayout = VK_NULL_HANDLE;
+	m_hizSetLayout = VK_NULL_HANDLE;
+	m_sampler = VK_NULL_HANDLE;
+	m_hizView = VK_NULL_HANDLE;
+	m_hiz = VK_NULL_HANDLE;
+	m_hizMemory = VK_NULL_HANDLE;
+}
+
+void ComputeCulling::resize()
+{
+	//VkRenderer::rebuildTargets builds a new depth stencil, the reduction has to follow it
+	if (!m_occlusion || m_depthGeneration == m_renderer->m_targetGeneration)
+		return;
+	releasePyramid();
+	buildPyramid();
+	writePyramidDescriptor();
+	m_cullDataMapped->hizSize[0] = (float)m_hizWidth;
+	m_cullDataMapped->hizSize[1] = (float)m_hizHeight;
+}
+
+bool ComputeCulling::update(Scene* scene)
+{
+	if (scene->instances.size() != m_instanceCount || scene->meshs.size() != m_meshCount)
+		return true;
+
+	//VkRenderer::end waits for the queue, the passes of the last frame are done
+	Matrix4x4 toRoot = scene->drawModel().invertedAffine();
+	for (uint32_t index : scene->moved)
+		writeInstance(scene, index, m_firstSlot, m_firstInstance, toRoot, m_instanceData[index]);
+	memcpy(m_cullDataMapped->planes, scene->frustum.planes, sizeof(m_cullDataMapped->planes));
+	m_cullDataMapped->viewProj = (scene->camera->proj * scene->camera->view).transposed();
+	m_cullDataMapped->lodScale = scene->lodScale();
+	m_cullDataMapped->znear = scene->camera->m_znear;
+	for (int i = 0; i < 4; ++i)
+		m_cullDataMapped->viewDepth[i] = scene->camera->view[2][i];
+
+	/*LAST FRAME*/
+	const GpuCullStats &stats = *m_readbackMapped;
+	m_totals[0] += stats.frustumCulled;
+	m_totals[1] += stats.rejected;
+	m_totals[2] += stats.occludedFinal;
+	m_totals[3] += stats.drawn[0];
+	m_totals[4] += stats.drawn[1];
+	m_totals[5] += stats.fullTriangles;
+	m_totals[6] += stats.drawnTriangles;
+	if (m_timestamps)
+	{
+		uint64_t stamps[TIMESTAMP_COUNT] = {};
+		uint32_t last = m_occlusion ? DRAW_1 : DRAW_0;
+		//not ready before the first submit
+		if (vkGetQueryPoolResults(m_device, m_queryPool, 0, last + 1, sizeof(stamps), stamps,
+			sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			double period = m_vulkanDevice->m_properties.limits.timestampPeriod * 1e-6;
+			for (uint32_t i = CULL_0; i <= last; ++i)
+				m_gpuMs[i] += (stamps[i] - stamps[i - 1]) * period;
+		}
+	}
+	if (++m_frames == REPORT_INTERVAL)
+		report();
+	return false;
+}
+
+void ComputeCulling::report()
+{
+	if (!m_frames) return;
+	double frames = (double)m_frames;
+	LOG << "culling, per frame over " << m_frames << " frames : " << m_instanceCount << " instances, "
+		<< m_totals[0] / frames << " outside the frustum";
+	if (m_occlusion)
+		LOG << ", " << m_totals[1] / frames << " rejected by the last depth, "
+			<< m_totals[2] / frames << " still hidden after the re-test";
+	LOG << ", drawn " << m_totals[3] / frames << " + " << m_totals[4] / frames << ENDL;
+	LOG << "triangles per frame : " << m_totals[6] / frames << " drawn of " << m_totals[5] / frames << ", "
+		<< (m_totals[5] - m_totals[6]) / frames << " saved by the levels of detail" << ENDL;
+	if (m_timestamps)
+	{
+		LOG << "gpu ms : cull " << m_gpuMs[CULL_0] / frames << " draw " << m_gpuMs[DRAW_0] / frames;
+		if (m_occlusion)
+			LOG << " re-test " << m_gpuMs[CULL_1] / frames << " draw " << m_gpuMs[DRAW_1] / frames;
+		LOG << ENDL;
+	}
+	memset(m_totals, 0, sizeof(m_totals));
+	memset(m_gpuMs, 0, sizeof(m_gpuMs));
+	m_frames = 0;
+}
+
+void ComputeCulling::recordPyramid(VkCommandBuffer cmd)
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_hizPipeline);
+	//every level reads the one before, the cull pass reads them all
+	VkMemoryBarrier levelDone{};
+	levelDone.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	levelDone.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	levelDone.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	for (uint32_t level = 0; level < m_hizLevels; ++level)
+	{
+		int32_t sizes[4] = {
+			int32_t(level ? std::max(1U, m_hizWidth >> (level - 1)) : m_depthWidth),
+			int32_t(level ? std::max(1U, m_hizHeight >> (level - 1)) : m_depthHeight),
+			int32_t(std::max(1U, m_hizWidth >> level)),
+			int32_t(std::max(1U, m_hizHeight >> level))
+		};
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_hizPipelineLayout, 0, 1,
+			&m_hizSets[level], 0, nullptr);
+		vkCmdPushConstants(cmd, m_hizPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(sizes), sizes);
+		vkCmdDispatch(cmd, (sizes[2] + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+			(sizes[3] + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+		//the graph orders the last level before the cull pass
+		if (level + 1 < m_hizLevels)
+			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &levelDone, 0, nullptr, 0, nullptr);
+	}
+}
+
+void ComputeCulling::declare(RenderGraph &graph, uint32_t depth)
+{
+	m_graph.instances = graph.importBuffer("cull instances", m_instances.buffer);
+	m_graph.stream = graph.importBuffer("cull stream", m_stream.buffer);
+	m_graph.commands = graph.importBuffer("cull commands", m_commands.buffer);
+	m_graph.resetCommands = graph.importBuffer("cull reset commands", m_resetCommands.buffer);
+	m_graph.cullData = graph.importBuffer("cull data", m_cullData.buffer);
+	m_graph.counters = graph.importBuffer("cull counters", m_counters.buffer);
+	m_graph.readback = graph.importBuffer("cull readback", m_readback.buffer);
+	//the pyramid stays in GENERAL, written as storage and sampled in turns
+	VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_hizLevels, 0, 1 };
+	m_graph.hiz = graph.importImage("hi-z", m_hiz, VK_FORMAT_R32_SFLOAT, range,
+		GraphAccess::STORAGE_COMPUTE, VK_IMAGE_LAYOUT_GENERAL);
+	m_graph.depth = depth;
+	if (m_occlusion)
+		graph.output(depth, GraphAccess::DEPTH_ATTACHMENT);
+}
+
+void ComputeCulling::addPasses(RenderGraph &graph, uint32_t phase)
+{
+	if (phase == 0)
+	{
+		uint32_t reset = graph.addPass("cull reset", false, [this](VkCommandBuffer cmd)
+		{
+			if (m_timestamps)
+			{
+				vkCmdResetQueryPool(cmd, m_queryPool, 0, TIMESTAMP_COUNT);
+				vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, FRAME_BEGIN);
+			}
+			//instanceCount and the stats back to 0, the shader counts into them
+			VkBufferCopy copy = {};
+			copy.size = sizeof(VkDrawIndexedIndirectCommand) * std::max(1U, m_slotCount * phases());
+			vkCmdCopyBuffer(cmd, m_resetCommands.buffer, m_commands.buffer, 1, &copy);
+			vkCmdFillBuffer(cmd, m_counters.buffer, 0, sizeof(GpuCullStats), 0);
+		});
+		graph.use(reset, m_graph.resetCommands, GraphAccess::TRANSFER_READ);
+		graph.use(reset, m_graph.commands, GraphAccess::TRANSFER_WRITE);
+		graph.use(reset, m_graph.counters, GraphAccess::TRANSFER_WRITE);
+	}
+
+	//phase 0 reduces the depth the last frame left behind, phase 1 the one phase 0 drew
+	if (m_occlusion)
+	{
+		uint32_t pyramid = graph.addPass(phase ? "hi-z 1" : "hi-z 0", false, [this, phase](VkCommandBuffer cmd)
+		{
+			if (phase && m_timestamps)
+				vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, DRAW_0);
+			recordPyramid(cmd);
+		});
+		graph.use(pyramid, m_graph.depth, GraphAccess::SAMPLED_COMPUTE);
+		graph.use(pyramid, m_graph.hiz, GraphAccess::STORAGE_COMPUTE);
+	}
+
+	uint32_t cull = graph.addPass(phase ? "cull 1" : "cull 0", false, [this, phase](VkCommandBuffer cmd)
+	{
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+		vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+		//phase 1 only walks the rejected list but its length is known on the gpu alone
+		vkCmdDispatch(cmd, (m_instanceCount + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+		if (m_timestamps)
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_queryPool, phase ? CULL_1 : CULL_0);
+	});
+	//the host writes instances and planes before the submit, that orders them already
+	graph.use(cull, m_graph.instances, GraphAccess::STORAGE_READ_COMPUTE);
+	graph.use(cull, m_graph.cullData, GraphAccess::UNIFORM_COMPUTE);
+	graph.use(cull, m_graph.hiz, GraphAccess::SAMPLED_COMPUTE);
+	graph.use(cull, m_graph.commands, GraphAccess::STORAGE_COMPUTE);
+	graph.use(cull, m_graph.stream, GraphAccess::STORAGE_COMPUTE);
+	graph.use(cull, m_graph.counters, GraphAccess::STORAGE_COMPUTE);
+}
+
+void ComputeCulling::useDraws(RenderGraph &graph, uint32_t pass)
+{
+	//counts feed the indirect draws, the stream feeds the vertex input
+	graph.use(pass, m_graph.commands, GraphAccess::INDIRECT);
+	graph.use(pass, m_graph.stream, GraphAccess::VERTEX);
+}
+
+void ComputeCulling::addReadback(RenderGraph &graph)
+{
+	//read by the next update, after VkRenderer::end waited for the queue
+	uint32_t readback = graph.addPass("cull readback", false, [this](VkCommandBuffer cmd)
+	{
+		if (m_timestamps)
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, m_occlusion ? DRAW_1 : DRAW_0);
+		VkBufferCopy copy = {};
+		copy.size = sizeof(GpuCullStats);
+		vkCmdCopyBuffer(cmd, m_counters.buffer, m_readback.buffer, 1, &copy);
+	});
+	graph.use(readback, m_graph.counters, GraphAccess::TRANSFER_READ);
+	graph.use(readback, m_graph.readback, GraphAccess::TRANSFER_WRITE);
+	graph.output(m_graph.readback, GraphAccess::HOST_READ);
+}
+
+void ComputeCulling::draw(RenderQueue &queue, uint32_t pass, uint32_t phase, uint32_t mesh, RenderDraw draw)
+{
+	draw.instanceBuffer = m_stream.buffer;
+	draw.indirectBuffer = m_commands.buffer;
+	for (uint32_t slot = m_firstSlot[mesh]; slot < m_firstSlot[mesh + 1]; ++slot)
+	{
+		//meshs without instances have no region
+		if (m_firstInstance[slot + 1] == m_firstInstance[slot])
+			return;
+		draw.instanceOffset = sizeof(InstanceVertex) * (phase * m_firstInstance[m_slotCount] + m_firstInstance[slot]);
+		draw.indirectOffset = sizeof(VkDrawIndexedIndirectCommand) * (phase * m_slotCount + slot);
+		queue.submit(pass, draw);
+	}
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <matrix4x4.h>
+#include <shader.h>
+#include <mesh.h>
+#include <renderqueue.h>
+#include <vkdescriptor.h>
+#include <rendergraph.h>
+
+//std430 instance record read by shader/default/cull.comp
+struct GpuInstance
+{
+	Matrix4x4 model;			//transposed, as in InstanceVertex
+	float color[4];
+	float sphere[4];			//world center, radius
+	float boxMin[4];
+	float boxMax[4];
+	uint32_t slot;				//command of the mesh's full level, the coarser follow
+	uint32_t region;			//first entry of level 0 in the instance stream
+	uint32_t regionSize;		//entries per level, the mesh's instance count
+	uint32_t lodCount;
+	float lodError[4];			//world units of levels 1 to 4
+};
+
+//std140 cullblock, one host visible uniform buffer
+struct GpuCullData
+{
+	float planes[6][4];
+	Matrix4x4 viewProj;			//transposed
+	uint32_t instanceCount;
+	uint32_t slotCount;			//indirect commands per phase
+	uint32_t occlusion;
+	uint32_t streamSize;		//instance stream entries per phase
+	float hizSize[2];
+	float lodScale;				//Scene::lodScale
+	float znear;
+	float viewDepth[4];			//third row of the view matrix
+};
+
+//counters of one frame, written by the cull passes
+struct GpuCullStats
+{
+	uint32_t rejected;			//phase 0 occluded, the list phase 1 tests again
+	uint32_t frustumCulled;
+	uint32_t occludedFinal;		//still hidden behind the depth of this frame
+	uint32_t drawn[2];
+	uint32_t fullTriangles;		//of the drawn instances at level 0
+	uint32_t drawnTriangles;
+	uint32_t pad;
+};
+
+class Scene;
+class VkRenderer;
+class VulkanDevice;
+//instance culling on the gpu. a compute pass tests every instance, picks
+//its level of detail, appends it to the region of that mesh and level in
+//the instance stream and counts it into the VkDrawIndexedIndirectCommand
+//of the pair. the recorded command
+//buffers never change with visibility, per frame cpu work is the plane
+//upload plus the instances that moved.
+//with occlusion the frame runs in two phases. phase 0 tests against a
+//hierarchical z pyramid of the last frame's depth and draws what passes,
+//phase 1 rebuilds the pyramid from that depth and draws the rejected
+//instances that turn out to be visible after all
+class ComputeCulling
+{
+public:
+	ComputeCulling(VkRenderer* renderer);
+	~ComputeCulling();
+
+	//the graphics queue runs the pass, its family has to support compute
+	static bool supported(VulkanDevice* vulkanDevice);
+
+	//buffers, descriptors and pipeline sized for the scene, every instance uploaded
+	void build(Scene* scene);
+	//pyramid for the current depth stencil, call before recording
+	void resize();
+	//frustum planes and moved instances, counters of the last frame. true
+	//if the instance count changed and build plus a command buffer rebuild are needed
+	bool update(Scene* scene);
+
+	bool occlusion() const { return m_occlusion; }
+	uint32_t phases() const { return m_occlusion ? 2 : 1; }
+
+	//buffers and pyramid into graph, depth is the renderer's depth stencil.
+	//with occlusion the depth is kept for the next frame's phase 0
+	void declare(RenderGraph &graph, uint32_t depth);
+	//reset, pyramid and cull passes of a phase, before its draw pass
+	void addPasses(RenderGraph &graph, uint32_t phase);
+	//indirect commands and instance stream of the phase's draws
+	void useDraws(RenderGraph &graph, uint32_t pass);
+	//counters copied for the next update, after the last draw pass
+	void addReadback(RenderGraph &graph);
+	//indirect draws of one mesh into queue, one per level. draw carries
+	//the pipeline, descriptor set and geometry
+	void draw(RenderQueue &queue, uint32_t pass, uint32_t phase, uint32_t mesh, RenderDraw draw);
+
+	//rejected counts and gpu time averaged since the last report
+	void report();
+
+private:
+	void buildPipelines();
+	void buildPyramid();
+	void releasePyramid();
+	void writePyramidDescriptor();
+	void release();
+	void recordPyramid(VkCommandBuffer cmd);
+
+	VkRenderer* m_renderer;
+	VulkanDevice* m_vulkanDevice;
+	VkDevice m_device;
+
+	uint32_t m_instanceCount = 0;
+	uint32_t m_meshCount = 0;
+	//a slot is one level of one mesh with its own command and region
+	uint32_t m_slotCount = 0;
+	std::vector<uint32_t> m_firstSlot;
+	//first entry of every slot in the instance stream, per phase
+	std::vector<uint32_t> m_firstInstance;
+
+	Buffer m_instances = {};			//GpuInstance, host visible
+	GpuInstance* m_instanceData = NULL;
+	Buffer m_stream = {};				//InstanceVertex per phase, written by the pass
+	Buffer m_commands = {};				//VkDrawIndexedIndirectCommand per phase and slot
+	Buffer m_resetCommands = {};		//same with instanceCount 0, copied every frame
+	Buffer m_cullData = {};
+	GpuCullData* m_cullDataMapped = NULL;
+	Buffer m_counters = {};				//GpuCullStats then the rejected instance list
+	Buffer m_readback = {};				//GpuCullStats of the last frame
+	GpuCullStats* m_readbackMapped = NULL;
+
+	shader_ptr m_cullShader;
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+	//reset by release, a page holds a few builds before it grows
+	DescriptorAllocator m_descriptors;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+	/*HIERARCHICAL Z*/
+	//farthest depth per texel, power of two below the frame size
+	bool m_occlusion = false;
+	//depth view the reduction reads, a new one after every resize
+	VkImageView m_depthSource = VK_NULL_HANDLE;
+	//VkRenderer::m_targetGeneration of that view, handles of new views may repeat old ones
+	uint32_t m_depthGeneration = 0;
+	uint32_t m_depthWidth = 0, m_depthHeight = 0;
+	uint32_t m_hizWidth = 0, m_hizHeight = 0, m_hizLevels = 0;
+	VkImage m_hiz = VK_NULL_HANDLE;
+	VkDeviceMemory m_hizMemory = VK_NULL_HANDLE;
+	VkImageView m_hizView = VK_NULL_HANDLE;
+	std::vector<VkImageView> m_hizLevelViews;
+	VkSampler m_sampler = VK_NULL_HANDLE;
+	shader_ptr m_hizShader;
+	VkDescriptorSetLayout m_hizSetLayout = VK_NULL_HANDLE;
+	//a set per level, reset by releasePyramid
+	DescriptorAllocator m_hizDescriptors;
+	std::vector<VkDescriptorSet> m_hizSets;
+	VkPipelineLayout m_hizPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_hizPipeline = VK_NULL_HANDLE;
+
+	/*GRAPH*/
+	//resources of the graph being declared
+	struct
+	{
+		uint32_t instances, stream, commands, resetCommands, cullData, counters, readback;
+		uint32_t depth, hiz;
+	} m_graph = {};
+
+	/*TIMING*/
+	enum Timestamp { FRAME_BEGIN, CULL_0, DRAW_0, CULL_1, DRAW_1, TIMESTAMP_COUNT };
+	VkQueryPool m_queryPool = VK_NULL_HANDLE;
+	bool m_timestamps = false;
+	double m_gpuMs[TIMESTAMP_COUNT] = {};
+	uint64_t m_totals[7] = {};
+	uint32_t m_frames = 0;
+};
@@ -0,0 +1,59 @@
+#include "dynamicresolution.h"
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	//frames averaged before a decision, the first ones after a step included
+	const uint32_t SETTLE_FRAMES = 16;
+	const double SMOOTHING = 0.1;
+	//a step up has to fit this much of the target
+	const double HEADROOM = 0.85;
+}
+
+DynamicResolution::DynamicResolution(double targetMs, float minScale, float maxScale, float step)
+	: m_targetMs(targetMs), m_minScale(minScale), m_maxScale(std::max(minScale, maxScale)),
+	m_step(std::max(step, 1e-3f))
+{
+	//the last level is the largest scale even where the steps do not reach it evenly
+	m_levels = (uint32_t)ceilf((m_maxScale - m_minScale) / m_step - 1e-3f) + 1;
+	m_level = m_levels - 1;
+}
+
+float DynamicResolution::scaleOf(uint32_t level) const
+{
+	return std::min(m_minScale + level * m_step, m_maxScale);
+}
+
+double DynamicResolution::predictedMs(uint32_t level) const
+{
+	double ratio = scaleOf(level) / scale();
+	return m_averageMs * ratio * ratio;
+}
+
+bool DynamicResolution::update(double gpuMs)
+{
+	m_averageMs = m_frames ? m_averageMs + (gpuMs - m_averageMs) * SMOOTHING : gpuMs;
+	if (++m_frames < SETTLE_FRAMES)
+		return false;
+
+	//down as far as it takes to fit, up one step at a time
+	uint32_t level = m_level;
+	while (level > 0 && predictedMs(level) > m_targetMs)
+		--level;
+	if (level == m_level && level + 1 < m_levels && predictedMs(level + 1) < m_targetMs * HEADROOM)
+		++level;
+	if (level == m_level)
+		return false;
+
+	m_level = level;
+	m_frames = 0;
+	++m_changes;
+	return true;
+}
+
+VkExtent2D DynamicResolution::extent(VkExtent2D full) const
+{
+	float s = scale();
+	return { std::max(1U, (uint32_t)(full.width * s + 0.5f)), std::max(1U, (uint32_t)(full.height * s + 0.5f)) };
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+
+//scale of the scene's render target against the swapchain, from the gpu time
+//of the frames. the time is taken to follow the pixel count, the square of
+//the scale. the scale moves in fixed steps so the target is only built again
+//when a step changes, and it only goes up with headroom left so it does not
+//come straight back down
+class DynamicResolution
+{
+public:
+	DynamicResolution(double targetMs, float minScale = 0.5f, float maxScale = 1.0f, float step = 0.125f);
+
+	//gpu time of the last frame, true if the scale moved
+	bool update(double gpuMs);
+
+	float scale() const { return scaleOf(m_level); }
+	//the full extent at the current scale, at least a texel
+	VkExtent2D extent(VkExtent2D full) const;
+	double targetMs() const { return m_targetMs; }
+	//moving average of the frames since the last step
+	double averageMs() const { return m_averageMs; }
+	uint32_t changes() const { return m_changes; }
+
+private:
+	float scaleOf(uint32_t level) const;
+	double predictedMs(uint32_t level) const;
+
+	double m_targetMs;
+	float m_minScale;
+	float m_maxScale;
+	float m_step;
+	uint32_t m_levels;
+	uint32_t m_level;
+	double m_averageMs = 0.0;
+	uint32_t m_frames = 0;
+	uint32_t m_changes = 0;
+};
@@ -0,0 +1,666 @@
+#include "rendergraph.h"
+#include <vklog.h>
+#include <vkattachment.h>
+#include <algorithm>
+
+namespace
+{
+	const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT |
+		VK_ACCESS_MEMORY_WRITE_BIT;
+	const VkPipelineStageFlags FRAGMENT_TESTS = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	const uint32_t NO_GROUP = ~0U;
+	const uint32_t NO_ALIAS = ~0U;
+
+	bool isDepth(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 ||
+			format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM_S8_UINT ||
+			format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+}
+
+GraphAccessInfo GraphAccessInfo::of(GraphAccess access)
+{
+	switch (access)
+	{
+	case GraphAccess::ACQUIRED:
+		//nothing to make available, the render pass only has to wait for the semaphore's stage
+		return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, true };
+	case GraphAccess::COLOR_ATTACHMENT:
+		return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+	case GraphAccess::DEPTH_ATTACHMENT:
+		return { FRAGMENT_TESTS,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+	case GraphAccess::SAMPLED_FRAGMENT:
+		return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+	case GraphAccess::SAMPLED_COMPUTE:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+	case GraphAccess::STORAGE_READ_COMPUTE:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case GraphAccess::STORAGE_COMPUTE:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_GENERAL, true };
+	case GraphAccess::UNIFORM_COMPUTE:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case GraphAccess::INDIRECT:
+		return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case GraphAccess::VERTEX:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case GraphAccess::TRANSFER_READ:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+	case GraphAccess::TRANSFER_WRITE:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+	case GraphAccess::PRESENT:
+		//the semaphore of the submit makes it visible to the presentation engine
+		return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false };
+	case GraphAccess::HOST_READ:
+		return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	default:
+		return { 0, 0, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	}
+}
+
+RenderGraph::RenderGraph(VkDevice device)
+	: m_device(device)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	for (auto &renderPass : m_renderPasses)
+		vkDestroyRenderPass(m_device, renderPass.second, nullptr);
+}
+
+void RenderGraph::clear()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_groups.clear();
+	m_final = {};
+	m_stats = {};
+}
+
+/*DECLARATION*/
+uint32_t RenderGraph::importImage(const char* name, VkImage image, VkFormat format,
+	const VkImageSubresourceRange &range, GraphAccess before, VkImageLayout pinned)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.image = image;
+	resource.format = format;
+	resource.range = range;
+	resource.pinned = pinned;
+	resource.before = before;
+	resource.alias = NO_ALIAS;
+	m_resources.push_back(resource);
+	return (uint32_t)m_resources.size() - 1;
+}
+
+uint32_t RenderGraph::importBuffer(const char* name, VkBuffer buffer, GraphAccess before)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.buffer = buffer;
+	resource.pinned = VK_IMAGE_LAYOUT_UNDEFINED;
+	resource.before = before;
+	resource.alias = NO_ALIAS;
+	m_resources.push_back(resource);
+	return (uint32_t)m_resources.size() - 1;
+}
+
+void RenderGraph::output(uint32_t resource, GraphAccess after)
+{
+	m_resources[resource].outputs = true;
+	m_resources[resource].after = after;
+}
+
+void RenderGraph::aliases(uint32_t resource, uint32_t earlier)
+{
+	m_resources[resource].alias = earlier;
+}
+
+uint32_t RenderGraph::addPass(const char* name, bool graphics, std::function<void(VkCommandBuffer)> record)
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.graphics = graphics;
+	pass.record = record;
+	pass.group = NO_GROUP;
+	m_passes.push_back(pass);
+	return (uint32_t)m_passes.size() - 1;
+}
+
+void RenderGraph::use(uint32_t pass, uint32_t resource, GraphAccess access)
+{
+	if (!m_passes[pass].graphics && isAttachment(access))
+		LOG_ASSERT("attachment of a pass outside a render pass");
+	Use use = {};
+	use.resource = resource;
+	use.access = access;
+	m_passes[pass].uses.push_back(use);
+}
+
+void RenderGraph::target(uint32_t pass, VkFramebuffer framebuffer, VkExtent2D extent)
+{
+	m_passes[pass].framebuffer = framebuffer;
+	m_passes[pass].extent = extent;
+}
+
+void RenderGraph::clearAttachment(uint32_t pass, uint32_t resource, VkClearValue value)
+{
+	for (Use &use : m_passes[pass].uses)
+		if (use.resource == resource && isAttachment(use.access))
+		{
+			use.clear = true;
+			use.value = value;
+			return;
+		}
+	LOG_WARN("clear of a resource the pass does not attach : " + m_resources[resource].name);
+}
+
+/*COMPILE*/
+GraphAccessInfo RenderGraph::info(const Resource &resource, GraphAccess access) const
+{
+	GraphAccessInfo result = GraphAccessInfo::of(access);
+	if (!resource.image || result.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+		return result;
+	if (resource.pinned != VK_IMAGE_LAYOUT_UNDEFINED)
+		result.layout = resource.pinned;
+	else if (isDepth(resource.format) && result.layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		result.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	return result;
+}
+
+void RenderGraph::cull()
+{
+	//backwards from the outputs, a pass lives if it writes something still read later
+	std::vector<bool> needed(m_resources.size());
+	for (uint32_t r = 0; r < m_resources.size(); ++r)
+		needed[r] = m_resources[r].outputs;
+	for (uint32_t p = (uint32_t)m_passes.size(); p-- > 0;)
+	{
+		Pass &pass = m_passes[p];
+		pass.alive = false;
+		for (const Use &use : pass.uses)
+			if (GraphAccessInfo::of(use.access).writes && needed[use.resource])
+				pass.alive = true;
+		if (!pass.alive)
+		{
+			m_stats.culled++;
+			continue;
+		}
+		//only what the pass reads keeps earlier writers, a cleared attachment does not
+		for (const Use &use : pass.uses)
+		{
+			GraphAccessInfo in = GraphAccessInfo::of(use.access);
+			if (!in.writes || use.access == GraphAccess::STORAGE_COMPUTE || (isAttachment(use.access) && !use.clear))
+				needed[use.resource] = true;
+		}
+	}
+}
+
+void RenderGraph::buildGroups()
+{
+	//neighbouring graphics passes on one frame buffer share a render pass as long
+	//as none of them samples what another one attaches
+	Group* current = NULL;
+	for (uint32_t p = 0; p < m_passes.size(); ++p)
+	{
+		Pass &pass = m_passes[p];
+		if (!pass.alive)
+			continue;
+		if (!pass.graphics)
+		{
+			current = NULL;
+			continue;
+		}
+		bool merge = current && current->framebuffer == pass.framebuffer &&
+			current->extent.width == pass.extent.width && current->extent.height == pass.extent.height;
+		for (uint32_t q = 0; merge && q < current->passes.size(); ++q)
+			for (const Use &earlier : m_passes[current->passes[q]].uses)
+				for (const Use &use : pass.uses)
+					if (earlier.resource == use.resource && isAttachment(earlier.access) != isAttachment(use.access))
+						merge = false;
+		if (!merge)
+		{
+			m_groups.push_back(Group());
+			current = &m_groups.back();
+			current->framebuffer = pass.framebuffer;
+			current->extent = pass.extent;
+			current->renderPass = VK_NULL_HANDLE;
+		}
+		pass.group = (uint32_t)m_groups.size() - 1;
+		pass.subpass = (uint32_t)current->passes.size();
+		current->passes.push_back(p);
+	}
+}
+
+bool RenderGraph::usedAfter(uint32_t pass, uint32_t resource) const
+{
+	for (uint32_t p = pass + 1; p < m_passes.size(); ++p)
+	{
+		if (!m_passes[p].alive)
+			continue;
+		for (const Use &use : m_passes[p].uses)
+			if (use.resource == resource)
+				return true;
+	}
+	return false;
+}
+
+void RenderGraph::access(Resource &resource, GraphAccess access, Batch &batch)
+{
+	GraphAccessInfo in = info(resource, access);
+	State &state = resource.state;
+	bool transition = resource.image && in.layout != VK_IMAGE_LAYOUT_UNDEFINED && in.layout != state.layout;
+	VkPipelineStageFlags srcStages = state.writeStages;
+	VkAccessFlags srcAccess = state.writeAccess;
+	VkPipelineStageFlags aliasStages = 0;
+	aliasWait(resource, aliasStages, srcAccess);
+	bool needed;
+	if (transition || in.writes || aliasStages)
+	{
+		//a write after reads only has to wait for them, nothing to make available
+		srcStages |= state.readStages | aliasStages;
+		needed = transition || srcStages;
+	}
+	else
+		//reads after reads and reads the write is visible to already go as they are
+		needed = state.writeStages && ((state.visibleStages & in.stages) != in.stages ||
+			(state.visibleAccess & in.access) != in.access);
+
+	if (needed)
+	{
+		batch.srcStages |= srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		batch.dstStages |= in.stages ? in.stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		if (resource.image)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = in.access;
+			barrier.oldLayout = state.layout;
+			barrier.newLayout = transition ? in.layout : state.layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image;
+			barrier.subresourceRange = resource.range;
+			batch.images.push_back(barrier);
+		}
+		else
+		{
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = in.access;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = resource.buffer;
+			barrier.size = VK_WHOLE_SIZE;
+			batch.buffers.push_back(barrier);
+		}
+	}
+
+	if (in.writes)
+	{
+		state.writeStages = in.stages;
+		state.writeAccess = in.access & WRITE_ACCESS;
+		state.readStages = 0;
+		state.visibleStages = 0;
+		state.visibleAccess = 0;
+	}
+	else if (transition)
+	{
+		//the transition is a write later readers wait for through the barrier's stages
+		state.writeStages = in.stages;
+		state.writeAccess = 0;
+		state.readStages = in.stages;
+		state.visibleStages = in.stages;
+		state.visibleAccess = in.access;
+	}
+	else
+	{
+		state.readStages |= in.stages;
+		if (needed)
+		{
+			state.visibleStages |= in.stages;
+			state.visibleAccess |= in.access;
+		}
+	}
+	if (transition)
+		state.layout = in.layout;
+}
+
+void RenderGraph::aliasWait(Resource &resource, VkPipelineStageFlags &stages, VkAccessFlags &access)
+{
+	//the earlier image's contents are gone, only its last use has to finish
+	if (!resource.state.used && resource.alias != NO_ALIAS)
+	{
+		const State &earlier = m_resources[resource.alias].state;
+		stages |= earlier.writeStages | earlier.readStages;
+		access |= earlier.writeAccess;
+	}
+	resource.state.used = true;
+}
+
+void RenderGraph::attach(Group &group, uint32_t subpass, const Use &use, bool laterUse)
+{
+	Resource &resource = m_resources[use.resource];
+	State &state = resource.state;
+	GraphAccessInfo in = info(resource, use.access);
+	uint32_t index = (uint32_t)(std::find(group.attachments.begin(), group.attachments.end(), use.resource) -
+		group.attachments.begin());
+
+	VkSubpassDependency dependency = {};
+	dependency.dstSubpass = subpass;
+	dependency.dstStageMask = in.stages;
+	dependency.dstAccessMask = in.access;
+	if (index == group.attachments.size())
+	{
+		//first subpass of the attachment, load or clear and wait for the frame before
+		VkAttachmentDescription description = {};
+		description.format = resource.format;
+		description.samples = VK_SAMPLE_COUNT_1_BIT;
+		if (use.clear)
+			description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		else
+			description.loadOp = state.layout != VK_IMAGE_LAYOUT_UNDEFINED ?
+				VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		//contents that are not loaded skip the transition from the old layout
+		description.initialLayout = description.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ?
+			state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		description.finalLayout = in.layout;
+		group.attachments.push_back(use.resource);
+		group.descriptions.push_back(description);
+		group.clearValues.push_back(use.value);
+
+		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependency.srcStageMask = state.writeStages | state.readStages;
+		dependency.srcAccessMask = state.writeAccess;
+		aliasWait(resource, dependency.srcStageMask, dependency.srcAccessMask);
+	}
+	else
+	{
+		//same attachment in an earlier subpass, only the region under each fragment matters
+		dependency.srcSubpass = 0;
+		for (uint32_t k = 0; k < subpass; ++k)
+			for (const Use &earlier : m_passes[group.passes[k]].uses)
+				if (earlier.resource == use.resource)
+					dependency.srcSubpass = k;
+		dependency.srcStageMask = state.writeStages;
+		dependency.srcAccessMask = state.writeAccess;
+		dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		//the subpasses in between do not use it, without preserving it the contents are undefined
+		for (uint32_t k = dependency.srcSubpass + 1; k < subpass; ++k)
+			group.preserveRefs[k].push_back(index);
+	}
+	if (dependency.srcStageMask || group.descriptions[index].initialLayout != in.layout)
+	{
+		if (!dependency.srcStageMask)
+			dependency.srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		group.dependencies.push_back(dependency);
+	}
+
+	VkAttachmentReference reference = { index, in.layout };
+	if (use.access == GraphAccess::DEPTH_ATTACHMENT)
+		group.depthRefs[subpass] = reference;
+	else
+		group.colorRefs[subpass].push_back(reference);
+
+	state.layout = in.layout;
+	state.writeStages = in.stages;
+	state.writeAccess = in.access & WRITE_ACCESS;
+	state.readStages = 0;
+	state.visibleStages = 0;
+	state.visibleAccess = 0;
+
+	VkAttachmentDescription &described = group.descriptions[index];
+	if (laterUse)
+	{
+		described.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		return;
+	}
+	//last use of the frame, the render pass leaves it where the frame has to end
+	GraphAccess after = resource.outputs ? resource.after : resource.before;
+	described.storeOp = after != GraphAccess::NONE ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	GraphAccessInfo out = info(resource, after);
+	if (out.layout == VK_IMAGE_LAYOUT_UNDEFINED || out.layout == in.layout)
+		return;
+	described.finalLayout = out.layout;
+	VkSubpassDependency leave = {};
+	leave.srcSubpass = subpass;
+	leave.dstSubpass = VK_SUBPASS_EXTERNAL;
+	leave.srcStageMask = in.stages;
+	leave.srcAccessMask = state.writeAccess;
+	leave.dstStageMask = out.stages;
+	leave.dstAccessMask = out.access;
+	group.dependencies.push_back(leave);
+	state.layout = out.layout;
+	state.writeStages = out.stages;
+	state.writeAccess = 0;
+	state.readStages = out.stages;
+	state.visibleStages = out.stages;
+	state.visibleAccess = out.access;
+}
+
+void RenderGraph::count(const Batch &batch)
+{
+	if (batch.images.empty() && batch.buffers.empty())
+		return;
+	m_stats.barriers++;
+	m_stats.imageBarriers += (uint32_t)batch.images.size();
+	m_stats.bufferBarriers += (uint32_t)batch.buffers.size();
+}
+
+void RenderGraph::compile()
+{
+	m_groups.clear();
+	m_final = {};
+	m_stats = {};
+	m_stats.passes = (uint32_t)m_passes.size();
+
+	//VkRenderer::end waited for the last frame, only the layouts carry over.
+	//the acquire semaphore is waited for at its stage, first uses wait there too
+	for (Resource &resource : m_resources)
+	{
+		GraphAccessInfo in = info(resource, resource.before);
+		resource.state = {};
+		resource.state.layout = resource.image ? in.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		if (resource.before == GraphAccess::ACQUIRED)
+			resource.state.writeStages = in.stages;
+	}
+
+	cull();
+	buildGroups();
+
+	for (uint32_t p = 0; p < m_passes.size(); ++p)
+	{
+		Pass &pass = m_passes[p];
+		pass.before = {};
+		if (!pass.alive)
+			continue;
+		if (!pass.graphics)
+		{
+			for (const Use &use : pass.uses)
+				access(m_resources[use.resource], use.access, pass.before);
+			count(pass.before);
+			continue;
+		}
+		if (pass.subpass)
+			continue;
+
+		//whole render pass at its first subpass, what it reads besides the
+		//attachments is waited for before it begins
+		Group &group = m_groups[pass.group];
+		uint32_t last = group.passes.back();
+		group.colorRefs.resize(group.passes.size());
+		group.depthRefs.assign(group.passes.size(), { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+		group.preserveRefs.resize(group.passes.size());
+		for (uint32_t q : group.passes)
+			for (const Use &use : m_passes[q].uses)
+				if (!isAttachment(use.access))
+					access(m_resources[use.resource], use.access, pass.before);
+		count(pass.before);
+		for (uint32_t k = 0; k < group.passes.size(); ++k)
+			for (const Use &use : m_passes[group.passes[k]].uses)
+			{
+				if (!isAttachment(use.access))
+					continue;
+				bool laterUse = usedAfter(last, use.resource);
+				for (uint32_t j = k + 1; !laterUse && j < group.passes.size(); ++j)
+					for (const Use &other : m_passes[group.passes[j]].uses)
+						laterUse |= other.resource == use.resource;
+				attach(group, k, use, laterUse);
+			}
+		m_stats.subpasses += (uint32_t)group.passes.size();
+	}
+	m_stats.renderPasses = (uint32_t)m_groups.size();
+	for (const Group &group : m_groups)
+		for (const VkAttachmentDescription &description : group.descriptions)
+		{
+			uint64_t bytes = (uint64_t)group.extent.width * group.extent.height * attachmentTexelSize(description.format);
+			if (description.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+				m_stats.loadBytes += bytes;
+			if (description.storeOp == VK_ATTACHMENT_STORE_OP_STORE)
+				m_stats.storeBytes += bytes;
+		}
+
+	//back to the imported state, or on to the output one
+	for (Resource &resource : m_resources)
+	{
+		GraphAccess after = resource.outputs ? resource.after : resource.before;
+		if (after == GraphAccess::NONE)
+			continue;
+		GraphAccessInfo out = info(resource, after);
+		bool transition = resource.image && out.layout != VK_IMAGE_LAYOUT_UNDEFINED &&
+			out.layout != resource.state.layout;
+		//host reads need the writes made available, a restored buffer needs nothing
+		if (transition || (resource.outputs && out.access))
+			access(resource, after, m_final);
+	}
+	count(m_final);
+}
+
+/*EXECUTE*/
+VkRenderPass RenderGraph::renderPass(uint32_t index)
+{
+	Group &group = m_groups[index];
+	if (group.renderPass)
+		return group.renderPass;
+
+	std::vector<VkSubpassDescription> subpasses(group.passes.size());
+	std::vector<uint32_t> key;
+	key.push_back((uint32_t)group.descriptions.size());
+	for (const VkAttachmentDescription &description : group.descriptions)
+	{
+		key.push_back(description.format);
+		key.push_back(description.loadOp);
+		key.push_back(description.storeOp);
+		key.push_back(description.initialLayout);
+		key.push_back(description.finalLayout);
+	}
+	for (uint32_t k = 0; k < subpasses.size(); ++k)
+	{
+		subpasses[k] = {};
+		subpasses[k].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[k].colorAttachmentCount = (uint32_t)group.colorRefs[k].size();
+		subpasses[k].pColorAttachments = group.colorRefs[k].data();
+		if (group.depthRefs[k].attachment != VK_ATTACHMENT_UNUSED)
+			subpasses[k].pDepthStencilAttachment = &group.depthRefs[k];
+		key.push_back(subpasses[k].colorAttachmentCount);
+		for (const VkAttachmentReference &reference : group.colorRefs[k])
+		{
+			key.push_back(reference.attachment);
+			key.push_back(reference.layout);
+		}
+		key.push_back(group.depthRefs[k].attachment);
+		key.push_back(group.depthRefs[k].layout);
+		subpasses[k].preserveAttachmentCount = (uint32_t)group.preserveRefs[k].size();
+		subpasses[k].pPreserveAttachments = group.preserveRefs[k].data();
+		key.push_back(subpasses[k].preserveAttachmentCount);
+		key.insert(key.end(), group.preserveRefs[k].begin(), group.preserveRefs[k].end());
+	}
+	for (const VkSubpassDependency &dependency : group.dependencies)
+	{
+		key.push_back(dependency.srcSubpass);
+		key.push_back(dependency.dstSubpass);
+		key.push_back(dependency.srcStageMask);
+		key.push_back(dependency.dstStageMask);
+		key.push_back(dependency.srcAccessMask);
+		key.push_back(dependency.dstAccessMask);
+		key.push_back(dependency.dependencyFlags);
+	}
+
+	auto found = m_renderPasses.find(key);
+	if (found != m_renderPasses.end())
+		return group.renderPass = found->second;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = (uint32_t)group.descriptions.size();
+	renderPassInfo.pAttachments = group.descriptions.data();
+	renderPassInfo.subpassCount = (uint32_t)subpasses.size();
+	renderPassInfo.pSubpasses = subpasses.data();
+	renderPassInfo.dependencyCount = (uint32_t)group.dependencies.size();
+	renderPassInfo.pDependencies = group.dependencies.data();
+	LOG_ERROR("failed to create graph render pass") <<
+		vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &group.renderPass);
+	m_renderPasses[key] = group.renderPass;
+	return group.renderPass;
+}
+
+void RenderGraph::record(VkCommandBuffer cmd, const Batch &batch)
+{
+	if (batch.images.empty() && batch.buffers.empty())
+		return;
+	vkCmdPipelineBarrier(cmd, batch.srcStages, batch.dstStages, 0, 0, nullptr,
+		(uint32_t)batch.buffers.size(), batch.buffers.data(), (uint32_t)batch.images.size(), batch.images.data());
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd)
+{
+	for (const Pass &pass : m_passes)
+	{
+		if (!pass.alive)
+			continue;
+		if (!pass.graphics)
+		{
+			record(cmd, pass.before);
+			pass.record(cmd);
+			continue;
+		}
+
+		Group &group = m_groups[pass.group];
+		if (pass.subpass == 0)
+		{
+			record(cmd, pass.before);
+			VkRenderPassBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.renderPass = renderPass(pass.group);
+			beginInfo.framebuffer = group.framebuffer;
+			beginInfo.renderArea.extent = group.extent;
+			beginInfo.clearValueCount = (uint32_t)group.clearValues.size();
+			beginInfo.pClearValues = group.clearValues.data();
+			vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		}
+		else
+			vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+		pass.record(cmd);
+		if (pass.subpass + 1 == group.passes.size())
+			vkCmdEndRenderPass(cmd);
+	}
+	record(cmd, m_final);
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+#include <stdint.h>
+
+//how a pass touches a resource. every access stands for the stages, access
+//bits and image layout the barriers are built from
+enum class GraphAccess : uint32_t
+{
+	NONE,					//no earlier use, contents undefined
+	ACQUIRED,				//swapchain image, waited for at color output by the submit
+	COLOR_ATTACHMENT,
+	DEPTH_ATTACHMENT,
+	SAMPLED_FRAGMENT,
+	SAMPLED_COMPUTE,
+	STORAGE_READ_COMPUTE,
+	STORAGE_COMPUTE,		//read and written
+	UNIFORM_COMPUTE,
+	INDIRECT,
+	VERTEX,
+	TRANSFER_READ,
+	TRANSFER_WRITE,
+	PRESENT,
+	HOST_READ,
+	COUNT
+};
+
+struct GraphAccessInfo
+{
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	//buffers ignore it, depth images are sampled read only instead
+	VkImageLayout layout;
+	bool writes;
+
+	static GraphAccessInfo of(GraphAccess access);
+};
+
+//one recorded frame as passes that declare what they read and write. compile
+//drops passes whose results nobody uses, puts the barriers and layout
+//transitions between the rest and merges graphics passes on the same frame
+//buffer into the subpasses of one render pass. imported resources end the
+//frame in the state they were imported with, or the one given to output.
+//render passes are created by execute and kept across clear, compile itself
+//touches no vulkan object
+class RenderGraph
+{
+public:
+	RenderGraph(VkDevice device);
+	~RenderGraph();
+
+	//drops passes and resources, the render passes stay for the next frame
+	void clear();
+
+	//before is the state the image is in when the frame starts. images that
+	//stay in one layout, like storage images sampled in GENERAL, pin it
+	uint32_t importImage(const char* name, VkImage image, VkFormat format, const VkImageSubresourceRange &range,
+		GraphAccess before = GraphAccess::NONE, VkImageLayout pinned = VK_IMAGE_LAYOUT_UNDEFINED);
+	uint32_t importBuffer(const char* name, VkBuffer buffer, GraphAccess before = GraphAccess::NONE);
+	//read after the frame, what the passes writing it are kept for
+	void output(uint32_t resource, GraphAccess after);
+	//the image shares memory with earlier, whose last use has to be done
+	//before its first. see AttachmentPool::aliasOf
+	void aliases(uint32_t resource, uint32_t earlier);
+
+	uint32_t addPass(const char* name, bool graphics, std::function<void(VkCommandBuffer)> record);
+	//attachments of a graphics pass in the order of the frame buffer's views
+	void use(uint32_t pass, uint32_t resource, GraphAccess access);
+	void target(uint32_t pass, VkFramebuffer framebuffer, VkExtent2D extent);
+	//the attachment starts at value instead of what the image held
+	void clearAttachment(uint32_t pass, uint32_t resource, VkClearValue value);
+
+	void compile();
+	//needs compile after the last change
+	void execute(VkCommandBuffer cmd);
+
+	struct Stats
+	{
+		uint32_t passes;
+		uint32_t culled;
+		//vkCmdPipelineBarrier calls and what they carry
+		uint32_t barriers;
+		uint32_t imageBarriers;
+		uint32_t bufferBarriers;
+		uint32_t renderPasses;
+		uint32_t subpasses;
+		//attachment bytes the render passes load and store per frame
+		uint64_t loadBytes;
+		uint64_t storeBytes;
+	};
+	const Stats& stats() const { return m_stats; }
+	bool culled(uint32_t pass) const { return !m_passes[pass].alive; }
+	//render pass instance of a graphics pass and its subpass in it
+	uint32_t group(uint32_t pass) const { return m_passes[pass].group; }
+	uint32_t subpass(uint32_t pass) const { return m_passes[pass].subpass; }
+	const std::vector<VkAttachmentDescription>& attachments(uint32_t group) const { return m_groups[group].descriptions; }
+	//attachments a subpass keeps for a later one without using them
+	const std::vector<uint32_t>& preserved(uint32_t group, uint32_t subpass) const
+	{
+		return m_groups[group].preserveRefs[subpass];
+	}
+	VkImage image(uint32_t resource) const { return m_resources[resource].image; }
+	//layout an image is left in by the frame
+	VkImageLayout finalLayout(uint32_t resource) const { return m_resources[resource].state.layout; }
+	//created on first use, pipelines drawn in a merged subpass are built against it
+	VkRenderPass renderPass(uint32_t group);
+	uint32_t renderPassCount() const { return (uint32_t)m_renderPasses.size(); }
+
+private:
+	struct State
+	{
+		VkImageLayout layout;
+		//the last write, access is 0 once it was made available
+		VkPipelineStageFlags writeStages;
+		VkAccessFlags writeAccess;
+		//reads since that write, a later write waits for them
+		VkPipelineStageFlags readStages;
+		//stages and access the write is visible to already
+		VkPipelineStageFlags visibleStages;
+		VkAccessFlags visibleAccess;
+		bool used;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		VkImage image;
+		VkBuffer buffer;
+		VkFormat format;
+		VkImageSubresourceRange range;
+		VkImageLayout pinned;
+		GraphAccess before;
+		GraphAccess after;
+		bool outputs;
+		uint32_t alias;
+		State state;
+	};
+
+	struct Use
+	{
+		uint32_t resource;
+		GraphAccess access;
+		bool clear;
+		VkClearValue value;
+	};
+
+	//barriers recorded in one call
+	struct Batch
+	{
+		VkPipelineStageFlags srcStages;
+		VkPipelineStageFlags dstStages;
+		std::vector<VkImageMemoryBarrier> images;
+		std::vector<VkBufferMemoryBarrier> buffers;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		bool graphics;
+		std::function<void(VkCommandBuffer)> record;
+		std::vector<Use> uses;
+		VkFramebuffer framebuffer;
+		VkExtent2D extent;
+		bool alive;
+		uint32_t group;
+		uint32_t subpass;
+		Batch before;
+	};
+
+	//the passes of one render pass instance
+	struct Group
+	{
+		std::vector<uint32_t> passes;
+		VkFramebuffer framebuffer;
+		VkExtent2D extent;
+		std::vector<uint32_t> attachments;
+		std::vector<VkAttachmentDescription> descriptions;
+		std::vector<VkClearValue> clearValues;
+		//per subpass, color references then the depth one
+		std::vector<std::vector<VkAttachmentReference>> colorRefs;
+		std::vector<VkAttachmentReference> depthRefs;
+		std::vector<std::vector<uint32_t>> preserveRefs;
+		std::vector<VkSubpassDependency> dependencies;
+		VkRenderPass renderPass;
+	};
+
+	bool isAttachment(GraphAccess access) const
+	{
+		return access == GraphAccess::COLOR_ATTACHMENT || access == GraphAccess::DEPTH_ATTACHMENT;
+	}
+	GraphAccessInfo info(const Resource &resource, GraphAccess access) const;
+	void cull();
+	void buildGroups();
+	//the barrier one use needs into batch, the state follows it
+	void access(Resource &resource, GraphAccess access, Batch &batch);
+	//what the first use of an aliased image waits for besides its own state
+	void aliasWait(Resource &resource, VkPipelineStageFlags &stages, VkAccessFlags &access);
+	void attach(Group &group, uint32_t subpass, const Use &use, bool laterUse);
+	void record(VkCommandBuffer cmd, const Batch &batch);
+	void count(const Batch &batch);
+	//uses of a resource by alive passes after pass
+	bool usedAfter(uint32_t pass, uint32_t resource) const;
+
+	VkDevice m_device;
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+	std::vector<Group> m_groups;
+	//transitions back to the imported states
+	Batch m_final;
+	Stats m_stats = {};
+	//by the words of their descriptions
+	std::map<std::vector<uint32_t>, VkRenderPass> m_renderPasses;
+};
@@ -0,0 +1,180 @@
+#include "renderqueue.h"
+#include <algorithm>
+#include <string.h>
+
+VkPushConstantRange DrawConstants::range()
+{
+	VkPushConstantRange pushRange = { STAGES, 0, sizeof(DrawConstants) };
+	return pushRange;
+}
+
+RenderQueueStats& RenderQueueStats::operator+=(const RenderQueueStats &other)
+{
+	draws += other.draws;
+	pipelineBinds += other.pipelineBinds;
+	descriptorBinds += other.descriptorBinds;
+	vertexBinds += other.vertexBinds;
+	indexBinds += other.indexBinds;
+	pushes += other.pushes;
+	return *this;
+}
+
+bool RenderQueueStats::operator==(const RenderQueueStats &other) const
+{
+	return draws == other.draws && pipelineBinds == other.pipelineBinds &&
+		descriptorBinds == other.descriptorBinds && vertexBinds == other.vertexBinds &&
+		indexBinds == other.indexBinds && pushes == other.pushes;
+}
+
+void RenderQueue::clear(VkPipelineLayout layout)
+{
+	m_layout = layout;
+	m_draws.clear();
+	m_keys.clear();
+	m_order.clear();
+	m_pipelineIds.clear();
+	m_descriptorIds.clear();
+	m_geometryIds.clear();
+}
+
+uint32_t RenderQueue::id(std::unordered_map<uint64_t, uint32_t> &ids, uint64_t handle, uint32_t bits)
+{
+	auto found = ids.find(handle);
+	if (found != ids.end())
+		return found->second;
+	//past the key range states share the last id, order only gets worse
+	uint32_t next = std::min<uint32_t>((uint32_t)ids.size(), (1U << bits) - 1);
+	ids[handle] = next;
+	return next;
+}
+
+void RenderQueue::submit(uint32_t pass, const RenderDraw &draw, float depth)
+{
+	//a positive float's bits compare like the float
+	uint32_t depthBits = 0;
+	if (depth > 0.0f)
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t geometry = (uint64_t)draw.vertexBuffer * 31 + (uint64_t)draw.indexBuffer;
+
+	uint64_t key = uint64_t(pass & ((1U << PASS_BITS) - 1));
+	key = (key << PIPELINE_BITS) | id(m_pipelineIds, (uint64_t)draw.pipeline, PIPELINE_BITS);
+	key = (key << DESCRIPTOR_BITS) | id(m_descriptorIds, (uint64_t)draw.descriptorSet, DESCRIPTOR_BITS);
+	key = (key << GEOMETRY_BITS) | id(m_geometryIds, geometry, GEOMETRY_BITS);
+	key = (key << DEPTH_BITS) | (depthBits >> (31 - DEPTH_BITS));
+
+	m_keys.push_back(key);
+	m_order.push_back((uint32_t)m_draws.size());
+	m_draws.push_back(draw);
+}
+
+void RenderQueue::sort()
+{
+	//least significant byte first, a counting pass per byte. bytes every
+	//key shares are skipped, with few states most of the high ones are
+	std::vector<uint64_t> keys(m_keys.size());
+	std::vector<uint32_t> order(m_order.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		uint32_t offsets[257] = {};
+		for (uint64_t key : m_keys)
+			offsets[((key >> shift) & 0xff) + 1]++;
+		if (std::count(offsets + 1, offsets + 257, (uint32_t)m_keys.size()))
+			continue;
+		for (uint32_t b = 1; b < 257; ++b)
+			offsets[b] += offsets[b - 1];
+		for (size_t i = 0; i < m_keys.size(); ++i)
+		{
+			uint32_t to = offsets[(m_keys[i] >> shift) & 0xff]++;
+			keys[to] = m_keys[i];
+			order[to] = m_order[i];
+		}
+		m_keys.swap(keys);
+		m_order.swap(order);
+	}
+}
+
+template<typename Emit>
+RenderQueueStats RenderQueue::walk(Emit &&emit) const
+{
+	RenderQueueStats stats;
+	const RenderDraw* bound = NULL;
+	for (uint32_t i : m_order)
+	{
+		const RenderDraw &draw = m_draws[i];
+		bool pipeline = !bound || bound->pipeline != draw.pipeline;
+		//a pipeline with another layout would disturb the set, all share m_layout
+		bool descriptor = !bound || bound->descriptorSet != draw.descriptorSet;
+		bool vertex = !bound || bound->vertexBuffer != draw.vertexBuffer ||
+			bound->attributeOffset != draw.attributeOffset;
+		bool instance = !bound || bound->instanceBuffer != draw.instanceBuffer ||
+			bound->instanceOffset != draw.instanceOffset;
+		bool index = !bound || bound->indexBuffer != draw.indexBuffer;
+		//push constants outlive pipeline binds of the same layout
+		bool push = !bound || memcmp(&bound->constants, &draw.constants, sizeof(DrawConstants)) != 0;
+		emit(draw, pipeline, descriptor, vertex, instance, index, push);
+
+		stats.draws++;
+		stats.pipelineBinds += pipeline;
+		stats.descriptorBinds += descriptor;
+		stats.vertexBinds += vertex + instance;
+		stats.indexBinds += index;
+		stats.pushes += push;
+		bound = &draw;
+	}
+	return stats;
+}
+
+RenderQueueStats RenderQueue::record(VkCommandBuffer cmd) const
+{
+	VkPipelineLayout layout = m_layout;
+	return walk([cmd, layout](const RenderDraw &draw, bool pipeline, bool descriptor,
+		bool vertex, bool instance, bool index, bool push)
+	{
+		if (pipeline)
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+		if (descriptor)
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &draw.descriptorSet, 0, NULL);
+		if (vertex)
+		{
+			VkBuffer buffers[2] = { draw.vertexBuffer, draw.vertexBuffer };
+			VkDeviceSize offsets[2] = { 0, draw.attributeOffset };
+			vkCmdBindVertexBuffers(cmd, 0, 2, buffers, offsets);
+		}
+		if (instance)
+			vkCmdBindVertexBuffers(cmd, 2, 1, &draw.instanceBuffer, &draw.instanceOffset);
+		if (index)
+			vkCmdBindIndexBuffer(cmd, draw.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+		if (push)
+			vkCmdPushConstants(cmd, layout, DrawConstants::STAGES, 0, sizeof(DrawConstants), &draw.constants);
+
+		if (draw.indirectBuffer)
+			vkCmdDrawIndexedIndirect(cmd, draw.indirectBuffer, draw.indirectOffset, 1, sizeof(VkDrawIndexedIndirectCommand));
+		else
+			vkCmdDrawIndexed(cmd, draw.indexCount, draw.instanceCount, draw.firstIndex, 0, draw.firstInstance);
+	});
+}
+
+RenderQueueStats RenderQueue::count() const
+{
+	return walk([](const RenderDraw&, bool, bool, bool, bool, bool, bool) {});
+}
+
+RenderQueueStats RenderQueue::unsorted() const
+{
+	//pipeline, geometry, index buffer and constants per draw, the
+	//descriptor set and instance stream only where they change
+	RenderQueueStats stats;
+	const RenderDraw* bound = NULL;
+	for (const RenderDraw &draw : m_draws)
+	{
+		stats.draws++;
+		stats.pipelineBinds++;
+		stats.descriptorBinds += !bound || bound->descriptorSet != draw.descriptorSet;
+		stats.vertexBinds += 1 + (!bound || bound->instanceBuffer != draw.instanceBuffer ||
+			bound->instanceOffset != draw.instanceOffset);
+		stats.indexBinds++;
+		stats.pushes++;
+		bound = &draw;
+	}
+	return stats;
+}
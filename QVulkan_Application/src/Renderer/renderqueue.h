@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <matrix4x4.h>
+
+//push constants of one draw, drawblock in the default shaders. 80 bytes of
+//the 128 every device guarantees
+struct DrawConstants
+{
+	Matrix4x4 model;			//transposed, applied after the instance's own
+	uint32_t material;			//main.frag: 0 textured, 1 vertex and instance color
+	uint32_t texture;			//slot in the bindless table, unused without it
+	uint32_t pad[2];
+
+	static const VkShaderStageFlags STAGES = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	//the range a pipeline layout declares for them
+	static VkPushConstantRange range();
+};
+
+//everything one vkCmdDrawIndexed(Indirect) needs bound
+struct RenderDraw
+{
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	//positions at binding 0 from offset 0, attributes at binding 1 from attributeOffset
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkDeviceSize attributeOffset = 0;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	//per instance stream at binding 2
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	VkDeviceSize instanceOffset = 0;
+
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstIndex = 0;
+	uint32_t firstInstance = 0;
+	//a VkDrawIndexedIndirectCommand replaces the counts above when set
+	VkBuffer indirectBuffer = VK_NULL_HANDLE;
+	VkDeviceSize indirectOffset = 0;
+
+	//pushed before the draw when they differ from the last pushed
+	DrawConstants constants = {};
+};
+
+//state changes a list of draws costs
+struct RenderQueueStats
+{
+	uint32_t draws = 0;
+	uint32_t pipelineBinds = 0;
+	uint32_t descriptorBinds = 0;
+	uint32_t vertexBinds = 0;			//geometry and instance stream calls
+	uint32_t indexBinds = 0;
+	uint32_t pushes = 0;				//vkCmdPushConstants, not counted as binds
+
+	uint32_t binds() const { return pipelineBinds + descriptorBinds + vertexBinds + indexBinds; }
+	RenderQueueStats& operator+=(const RenderQueueStats &other);
+	bool operator==(const RenderQueueStats &other) const;
+};
+
+//draws of one render pass, sorted by a 64 bit key and recorded with
+//every bind that repeats the bound state skipped. the key from the top:
+//  4 bits pass, order the caller wants the groups in
+// 12 bits pipeline
+// 12 bits descriptor set
+// 16 bits geometry, vertex and index buffer
+// 20 bits depth, front to back inside the same state
+//handles get dense ids in submission order, so the key stays small and
+//the order of equal states is stable
+class RenderQueue
+{
+public:
+	static const uint32_t PASS_BITS = 4;
+	static const uint32_t PIPELINE_BITS = 12;
+	static const uint32_t DESCRIPTOR_BITS = 12;
+	static const uint32_t GEOMETRY_BITS = 16;
+	static const uint32_t DEPTH_BITS = 20;
+
+	//every draw recorded binds descriptorSet and pushes its constants
+	//through layout, which needs DrawConstants::range
+	void clear(VkPipelineLayout layout);
+	//view depth orders draws of the same state, negative counts as 0
+	void submit(uint32_t pass, const RenderDraw &draw, float depth = 0.0f);
+	//radix sort of the keys, draws stay in submission order for equal keys
+	void sort();
+
+	//records the sorted draws, the state of cmd is unknown at the start
+	RenderQueueStats record(VkCommandBuffer cmd) const;
+	//the binds record issues, without a command buffer
+	RenderQueueStats count() const;
+	//the binds of submission order with every draw binding its full state,
+	//what a draw loop without the queue costs
+	RenderQueueStats unsorted() const;
+
+	size_t size() const { return m_draws.size(); }
+	uint64_t key(size_t i) const { return m_keys[i]; }
+	const RenderDraw& draw(size_t i) const { return m_draws[m_order[i]]; }
+
+private:
+	template<typename Emit>
+	RenderQueueStats walk(Emit &&emit) const;
+	uint32_t id(std::unordered_map<uint64_t, uint32_t> &ids, uint64_t handle, uint32_t bits);
+
+	VkPipelineLayout m_layout = VK_NULL_HANDLE;
+	std::vector<RenderDraw> m_draws;
+	//sorted, m_order[i] is the draw of m_keys[i]
+	std::vector<uint64_t> m_keys;
+	std::vector<uint32_t> m_order;
+
+	std::unordered_map<uint64_t, uint32_t> m_pipelineIds;
+	std::unordered_map<uint64_t, uint32_t> m_descriptorIds;
+	std::unordered_map<uint64_t, uint32_t> m_geometryIds;
+};
@@ -7,6 +7,18 @@
 #include <vertex.h>
 #include <vkswapchain.h>
 #include <texture.h>
+#include <textureresidency.h>
+#include <vkattachment.h>
+#include <computeculling.h>
+#include <vkdescriptor.h>
+#include <vkbindless.h>
+#include <vkdevice.h>
+#include <random>
+
+uint32_t TextureRenderer::stressInstances = 0;
+bool TextureRenderer::cpuCulling = false;
+bool TextureRenderer::bindlessTextures = true;
+double TextureRenderer::targetFrameMs = 0.0;
 
 TextureRenderer::TextureRenderer(QWindow* window)
 	: VkRenderer(window)//, //m_scene(NULL)
@@ -23,25 +35,32 @@ TextureRenderer::~TextureRenderer()
 	if (wirePipeline)
 		vkDestroyPipeline(m_device, wirePipeline, nullptr);
 
+	if (m_residency)
+		m_residency->report();
+	SAFE_DELETE(m_residency);
 	SAFE_DELETE(m_texture);
+	SAFE_DELETE(m_envTexture);
+	SAFE_DELETE(m_computeCulling);
 	SAFE_DELETE(m_scene);
+	SAFE_DELETE(m_bindless);
 
 	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
 	m_pipelineLayout = VK_NULL_HANDLE;
-	vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
-	vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+	//the layout and set belong to VkRenderer's descriptor caches
 }
 
 void TextureRenderer::buildProcedural()
 {
 	VkRenderer::initialize();
+	//the occlusion pass of ComputeCulling tests against the last frame's depth
+	m_depthHistory = !cpuCulling && ComputeCulling::supported(m_vulkanDevice);
+	m_targetFrameMs = targetFrameMs;
 	VkRenderer::buildProcedural();
 	buildScene();
 	buildTexture();
 
 	buildDescriptorSetLayout();
 	buildPipeline();
-	buildDescriptorPool();
 	buildDescriptorSet();
 	buildCommandBuffers();
 
@@ -67,50 +86,86 @@ void TextureRenderer::buildScene()
 	m_scene->addElement(mesh);
 	m_scene->addElement(shader);
 
+	if (stressInstances)
+	{
+		//one knot mesh, every copy is an instance on its own graph node
+		vkmesh_ptr knot = vkmesh_ptr(new VKMesh);
+		meshTool::LoadModel("./model/knot.obj", knot.get());
+		//shaded with the instance colors instead of the texture
+		knot->material = 1;
+		m_scene->addElement(knot);
+		uint32_t knotMesh = (uint32_t)m_scene->meshs.size() - 1;
+
+		uint32_t side = (uint32_t)ceil(cbrt((double)stressInstances));
+		float spacing = std::max(knot->bounds.radius * 2.5f, 0.001f);
+		vec3f corner = vec3f(-0.5f * spacing * (side - 1));
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		for (uint32_t i = 1; i < stressInstances; ++i)
+		{
+			vec3f grid((float)(i % side), (float)(i / side % side), (float)(i / (side * side)));
+			uint32_t node = m_scene->graph.addNode(m_scene->root, corner + grid * spacing,
+				vec3f(unit(rng), unit(rng), unit(rng)) * 360.0f);
+			m_scene->addInstance(knotMesh, node, vec3f(unit(rng), unit(rng), unit(rng)));
+		}
+		LOG << "stress test : " << stressInstances << " knot instances" << ENDL;
+	}
+
+	m_scene->buildClusters();
+	m_scene->buildLods();
 	m_scene->buildVertexBuffer();
 	m_scene->buildIndiceBuffer();
 	m_scene->initUniformBuffer();
+	m_scene->initInstanceBuffer();
 	m_scene->buildInputState();
 
 	m_scene->updateUnifomrBuffers();
+	m_scene->buildBvh();
+	m_scene->cull();
+	LOG << "visible instances : " << m_scene->visible.size() << " / " << m_scene->instances.size()
+		<< " in " << m_scene->batches.size() << " draws, " << m_scene->occludedCount << " occluded, "
+		<< m_scene->clusterCulled << " triangles in " << m_scene->clusterTested << " meshlets culled" << ENDL;
+
+	if (!cpuCulling && ComputeCulling::supported(m_vulkanDevice))
+	{
+		m_computeCulling = new ComputeCulling(this);
+		m_computeCulling->build(m_scene);
+	}
+	else
+		LOG << "culling on the cpu" << ENDL;
 }
 
 
 void TextureRenderer::buildDescriptorSetLayout()
 {
 	LOG_SECTION("create descriptor set layout and pipeline layout");
-	VkDescriptorSetLayoutBinding uboLayoutBinding{};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.pImmutableSamplers = nullptr;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-	samplerLayoutBinding.binding = 1;
-	samplerLayoutBinding.descriptorCount = 1;
-	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.pImmutableSamplers = nullptr;
-	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {
-		uboLayoutBinding, samplerLayoutBinding
-	};
-	/*CREATE DESCRIPTOR LAYOUT*/
-	VkDescriptorSetLayoutCreateInfo descritorSetlayoutInfo{};
-	descritorSetlayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	descritorSetlayoutInfo.bindingCount = bindings.size();
-	descritorSetlayoutInfo.pBindings = bindings.data();
+	if (bindlessTextures && m_vulkanDevice->m_descriptorIndexing)
+	{
+		//the environment map in set 0 counts against the same limits
+		m_bindless = new BindlessTable(m_vulkanDevice, 1);
+		if (m_bindless->capacity() < m_materialTextures.size())
+			SAFE_DELETE(m_bindless);
+		for (uint32_t i = 0; m_bindless && i < m_materialTextures.size(); ++i)
+			m_textureSlots.push_back(m_bindless->add(m_materialTextures[i]->descriptor));
+	}
+	LOG << "material textures : " << m_materialTextures.size()
+		<< (m_bindless ? " in the bindless table" : " in a set each") << ENDL;
 
-	LOG_ERROR("failed to create descriptor set layouts") <<
-		vkCreateDescriptorSetLayout(m_device, &descritorSetlayoutInfo, nullptr, &m_descriptorSetLayout);
+	//layouts with the same bindings come from the cache, no matter who asks first
+	auto resources = descriptorResources(0);
+	m_descriptorSetLayout = m_descriptorCache->layout(resources.data(), (uint32_t)resources.size());
+	VkDescriptorSetLayout setLayouts[] = { m_descriptorSetLayout, m_bindless ? m_bindless->layout : VK_NULL_HANDLE };
 
 	/*CREATE PIPELINE LAYOUT*/
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutInfo.pNext = NULL;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	pipelineLayoutInfo.setLayoutCount = m_bindless ? 2 : 1;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+	//per draw model matrix and material, see DrawConstants
+	VkPushConstantRange pushRange = DrawConstants::range();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushRange;
 
 	LOG_ERROR("failed to create pipeline layout") <<
 		vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout);
@@ -130,7 +185,8 @@ void TextureRenderer::buildPipeline()
 
 	//SET MAIN SHADER
 	mainShader = shader_ptr(new Shader(m_device));
-	mainShader->buildGLSL("./shader/default/main.vert", "./shader/default/main.frag");
+	mainShader->buildGLSL("./shader/default/main.vert",
+		m_bindless ? "./shader/default/main_bindless.frag" : "./shader/default/main.frag");
 
 	pipelineInfo->shaderStages = mainShader->shaderStage;
 	pipelineInfo->buildPipelineInfo();
@@ -143,6 +199,8 @@ void TextureRenderer::buildPipeline()
 	}
 
 	//SET SOLID PIPELINE
+	//solid and wire only read positions, the attribute stream stays unbound
+	pipelineInfo->vertexInputState = m_scene->positionInputState;
 	auto solidShader = shader_ptr(new Shader(m_device));
 	solidShader->buildGLSL("./shader/default/solid.vert", "./shader/default/solid.frag");
 
@@ -165,81 +223,59 @@ void TextureRenderer::buildPipeline()
 
 }
 
-void TextureRenderer::buildDescriptorPool()
+std::vector<DescriptorResource> TextureRenderer::descriptorResources(uint32_t material) const
 {
-	LOG_SECTION("create descriptor pool");
-	std::array<VkDescriptorPoolSize, 2> poolSize = {};
-	poolSize[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSize[0].descriptorCount = 1;
-	poolSize[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSize[1].descriptorCount = 1;
-
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = poolSize.size();
-	poolInfo.pPoolSizes = poolSize.data();
-	poolInfo.maxSets = 1;
-	LOG << "descriptor pool size" << poolSize.size() << ENDL;
-
-	LOG_ERROR("failed to create descriptor pool") <<
-		vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool);
+	std::vector<DescriptorResource> resources = {
+		//vertex shader binding 0
+		DescriptorResource::ofBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT,
+			m_scene->ubo.buffer, 0, sizeof(UBODataType)),
+		//frag shader binding 2 (cubemap)
+		DescriptorResource::ofImage(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT,
+			m_envTexture->descriptor)
+	};
+	//frag shader binding 1, the table in set 1 replaces it
+	if (!m_bindless)
+		resources.push_back(DescriptorResource::ofImage(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			VK_SHADER_STAGE_FRAGMENT_BIT, m_materialTextures[material]->descriptor));
+	return resources;
 }
 
 void TextureRenderer::buildDescriptorSet()
 {
 	LOG_SECTION("update descriptor set");
-	VkDescriptorSetLayout layout[] = { m_descriptorSetLayout };
-	VkDescriptorSetAllocateInfo allocateinfo{};
-	allocateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocateinfo.descriptorPool = m_descriptorPool;
-	allocateinfo.descriptorSetCount = 1;
-	allocateinfo.pSetLayouts = layout;
-
-	LOG_ERROR("failed to allocate descriptor set") <<
-	vkAllocateDescriptorSets(m_device, &allocateinfo, &m_descriptorSet);
-
-	VkDescriptorImageInfo imageInfo{};
-
-	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageInfo.imageView = NULL;				//null for atm
-	imageInfo.sampler = NULL;				//yet implement
-
-	VkDescriptorBufferInfo bufferinfo{};
-	bufferinfo.buffer = m_scene->ubo.buffer;
-	bufferinfo.offset = 0;
-	bufferinfo.range = sizeof(UBODataType);
-
-	VkWriteDescriptorSet uniformWrites{};
-	//vertex shader binding 0
-	uniformWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	uniformWrites.dstSet = m_descriptorSet;
-	uniformWrites.dstBinding = 0;
-	uniformWrites.dstArrayElement = 0;
-	uniformWrites.descriptorCount = 1;
-	uniformWrites.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uniformWrites.pBufferInfo = &bufferinfo;
-
-	VkWriteDescriptorSet imageWrites{};
-	//frag shader binding 1
-	imageWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	imageWrites.dstSet = m_descriptorSet;
-	imageWrites.dstBinding = 1;
-	imageWrites.dstArrayElement = 0;
-	imageWrites.descriptorCount = 1;
-	imageWrites.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	imageWrites.pImageInfo = &m_texture->descriptor;
-
-	/*std::vector<VkWriteDescriptorSet> writesDescriptors{
-		uniformWrites, imageWrites
-	};*/
-	std::vector<VkWriteDescriptorSet> writeDescriptors;
-	writeDescriptors.push_back(uniformWrites);
-	writeDescriptors.push_back(imageWrites);
-	vkUpdateDescriptorSets(m_device, writeDescriptors.size(), writeDescriptors.data(),
-		0, nullptr);
-	/*vkUpdateDescriptorSets(m_device, 1, &descriptorWrites,
-		0, nullptr);*/
+	updateDescriptorSet();
+	LOG << "descriptor sets : " << m_descriptorAllocator->setCount() << " in " << m_descriptorAllocator->pageCount()
+		<< " pools, " << m_layoutCache->size() << " layouts" << ENDL;
+}
+
+bool TextureRenderer::updateDescriptorSet()
+{
+	//update after bind, recorded command buffers read the new views
+	if (m_bindless)
+		for (uint32_t i = 0; i < m_materialTextures.size(); ++i)
+			m_bindless->write(m_textureSlots[i], m_materialTextures[i]->descriptor);
+
+	//new sets are taken before the old ones are released, so a set the
+	//command buffers still hold is never written again. with the table all
+	//materials have the same resources and share one set
+	std::vector<VkDescriptorSet> previous;
+	previous.swap(m_materialSets);
+	for (uint32_t i = 0; i < m_materialTextures.size(); ++i)
+	{
+		auto resources = descriptorResources(i);
+		m_materialSets.push_back(m_descriptorCache->get(resources.data(), (uint32_t)resources.size()));
+	}
+	for (VkDescriptorSet set : previous)
+		m_descriptorCache->release(set);
+	return m_materialSets != previous;
+}
 
+DrawConstants TextureRenderer::drawConstants(const VKMesh* mesh) const
+{
+	DrawConstants constants = mesh->constants(m_drawModel);
+	if (m_bindless)
+		constants.texture = m_textureSlots[mesh->texture];
+	return constants;
 }
 
 void TextureRenderer::buildCommandBuffers()
@@ -250,50 +286,186 @@ void TextureRenderer::buildCommandBuffers()
 	clearValues[0].color = defaultClearColor;
 	clearValues[1].depthStencil = { 1.0f,0 };
 
-	VkRenderPassBeginInfo renderPassBeginInfo = vkInitializer::renderPassBeginInfo();
-	renderPassBeginInfo.renderPass = m_renderPass;
-	renderPassBeginInfo.renderArea.offset.x = 0;
-	renderPassBeginInfo.renderArea.offset.y = 0;
-	renderPassBeginInfo.renderArea.extent = { width,height };
-	renderPassBeginInfo.clearValueCount = 2;
-	renderPassBeginInfo.pClearValues = clearValues;
-
+	//with occlusion culling a second pass draws what the first pass's depth revealed
+	if (m_computeCulling)
+		m_computeCulling->resize();
+	uint32_t phases = m_computeCulling ? m_computeCulling->phases() : 1;
+	RenderQueueStats binds, unsorted;
+	//pushed by every draw, so recorded with the command buffers
+	m_drawModel = m_scene->drawModel();
+
+	RenderGraph &graph = *m_renderGraph;
+	VkExtent2D extent = renderExtent();
+	VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	//only the occlusion test reads the depth of the frame before
+	GraphAccess depthBefore = m_computeCulling && m_computeCulling->occlusion() ?
+		GraphAccess::DEPTH_ATTACHMENT : GraphAccess::NONE;
 	for (uint32_t i = 0; i < m_commandBuffers.size(); ++i)
 	{
-		renderPassBeginInfo.framebuffer = m_frameBuffers[i];
+		graph.clear();
+		uint32_t color = graph.importImage("swapchain", m_swapchain->m_buffers[i].image, m_colorFormat,
+			colorRange, GraphAccess::ACQUIRED);
+		graph.output(color, GraphAccess::PRESENT);
+		//with dynamic resolution the draws go to the scene color, blitted up at the end
+		uint32_t target = color;
+		if (m_resolution)
+			target = graph.importImage("scene color", m_sceneColor.image, m_colorFormat, colorRange);
+		uint32_t depth = graph.importImage("depth", m_depthStencil.image, m_depthFormat, m_depthStencil.range,
+			depthBefore);
+		//targets placed in each other's memory wait for each other
+		if (m_resolution && m_attachments->aliasOf(m_sceneAttachment) == m_depthAttachment)
+			graph.aliases(target, depth);
+		if (m_resolution && m_attachments->aliasOf(m_depthAttachment) == m_sceneAttachment)
+			graph.aliases(depth, target);
+		if (m_computeCulling)
+			m_computeCulling->declare(graph, depth);
+
+		for (uint32_t phase = 0; phase < phases; ++phase)
+		{
+			if (m_computeCulling)
+				m_computeCulling->addPasses(graph, phase);
+			uint32_t draw = graph.addPass(phase ? "draw 1" : "draw 0", true, [&, i, phase](VkCommandBuffer cmd)
+			{
+				VkViewport viewport = vkInitializer::viewport((float)extent.width, (float)extent.height,
+					0.0f, 1.0f);
+				vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+				VkRect2D scissor = vkInitializer::rect2D(extent.width, extent.height, 0, 0);
+				vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+				renderOptional(cmd, m_renderType, phase);
+				//every command buffer records the same draws
+				if (i == 0)
+				{
+					binds += m_renderQueue.count();
+					unsorted += m_renderQueue.unsorted();
+				}
+			});
+			graph.use(draw, target, GraphAccess::COLOR_ATTACHMENT);
+			graph.use(draw, depth, GraphAccess::DEPTH_ATTACHMENT);
+			graph.target(draw, m_resolution ? m_sceneColor.frameBuffer : m_frameBuffers[i], extent);
+			//phase 1 adds to what phase 0 drew
+			if (phase == 0)
+			{
+				graph.clearAttachment(draw, target, clearValues[0]);
+				graph.clearAttachment(draw, depth, clearValues[1]);
+			}
+			if (m_computeCulling)
+				m_computeCulling->useDraws(graph, draw);
+		}
+		if (m_computeCulling)
+			m_computeCulling->addReadback(graph);
+		if (m_resolution)
+			addUpscale(graph, target, color);
+		graph.compile();
 
 		vkBeginCommandBuffer(m_commandBuffers[i], &cmdBufInfo);
-		vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		VkViewport viewport = vkInitializer::viewport((float)width, (float)height,
-			0.0f, 1.0f);
-		vkCmdSetViewport(m_commandBuffers[i], 0, 1, &viewport);
-
-		VkRect2D scissor = vkInitializer::rect2D(width, height, 0, 0);
-		vkCmdSetScissor(m_commandBuffers[i], 0, 1, &scissor);
-
-		vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS,
-			m_pipelineLayout, 0, 1, &m_descriptorSet, 0, NULL);
-
-		renderOptional(m_commandBuffers[i], m_renderType);
-
-		vkCmdEndRenderPass(m_commandBuffers[i]);
-
+		beginFrameTiming(m_commandBuffers[i]);
+		//set 1 stays bound under every set 0 the render queue binds
+		if (m_bindless)
+			vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1, 1,
+				&m_bindless->set, 0, NULL);
+		graph.execute(m_commandBuffers[i]);
+		endFrameTiming(m_commandBuffers[i]);
 		vkEndCommandBuffer(m_commandBuffers[i]);
 	}
 
+	const RenderGraph::Stats &stats = graph.stats();
+	if (stats.barriers != m_loggedGraph.barriers || stats.renderPasses != m_loggedGraph.renderPasses ||
+		stats.storeBytes != m_loggedGraph.storeBytes)
+	{
+		LOG << "render graph : " << stats.passes - stats.culled << " of " << stats.passes << " passes in "
+			<< stats.renderPasses << " render passes, " << stats.barriers << " barriers ("
+			<< stats.imageBarriers << " image, " << stats.bufferBarriers << " buffer), attachments load "
+			<< stats.loadBytes / 1024 << " KB store " << stats.storeBytes / 1024 << " KB" << ENDL;
+		m_loggedGraph = stats;
+	}
+
+	//rebuilds follow visibility, only report when the cost changed
+	if (!(binds == m_loggedBinds))
+	{
+		LOG << "binds per frame : " << binds.binds() << " of " << unsorted.binds() << " for " << binds.draws
+			<< " draws (pipelines " << binds.pipelineBinds << "/" << unsorted.pipelineBinds
+			<< ", descriptor sets " << binds.descriptorBinds << "/" << unsorted.descriptorBinds
+			<< ", vertex buffers " << binds.vertexBinds << "/" << unsorted.vertexBinds
+			<< ", index buffers " << binds.indexBinds << "/" << unsorted.indexBinds << "), "
+			<< binds.pushes << " constant pushes" << ENDL;
+		m_loggedBinds = binds;
+	}
 }
 
 void TextureRenderer::buildTexture()
 {
 	m_texture = new Texture(m_vulkanDevice);
-	m_texture->loadTexture("./image/checker.jpg", VK_FORMAT_R8G8B8A8_UNORM, false);
+	m_envTexture = new Texture(m_vulkanDevice);
+
+	//checker and the six env faces cook in parallel and share one upload
+	std::vector<TextureRequest> requests = {
+		{ m_texture, { "./image/checker.jpg" }, VK_IMAGE_VIEW_TYPE_2D },
+		{ m_envTexture, {
+			"./image/env/posx.jpg", "./image/env/negx.jpg",
+			"./image/env/posy.jpg", "./image/env/negy.jpg",
+			"./image/env/posz.jpg", "./image/env/negz.jpg" }, VK_IMAGE_VIEW_TYPE_CUBE }
+	};
+	Texture::loadTextures(requests);
+
+	m_residency = new TextureResidency(m_vulkanDevice, m_descriptorCache);
+	m_residency->track(m_texture);
+	m_residency->track(m_envTexture);
+	//frames only sample both in the main pipeline, the wire modes let them
+	//drop under the budget. the path runs once here either way
+	m_residency->roundTrip();
+	m_materialTextures.push_back(m_texture);
 	//m_texture->loadTexture("./image/checker.jpg", VK_FORMAT_R8G8B8_UNORM, false);
 	//m_texture->loadTexture("./image/rock2.jpg", VK_FORMAT_R8G8B8A8_UNORM, false);
 }
 
 void TextureRenderer::render()
 {
+	//only the main pipeline samples the textures
+	if (m_renderType == RenderType::MAIN)
+	{
+		m_residency->touch(m_texture);
+		m_residency->touch(m_envTexture);
+	}
+	//a new scale builds the targets again, the recorded frames draw into the old ones
+	bool rebuild = updateResolution();
+	if (m_computeCulling)
+	{
+		//visibility is decided on the gpu, recorded commands only change with the instance count
+		m_scene->updateBounds();
+		m_scene->updateFrustum();
+		if (m_computeCulling->update(m_scene))
+		{
+			m_computeCulling->build(m_scene);
+			rebuild = true;
+		}
+	}
+	else
+	{
+		//the recorded draw list only has to change when the visible set or a level does
+		rebuild |= m_scene->cull();
+		m_fullTriangles += m_scene->fullTriangles;
+		m_drawnTriangles += m_scene->drawnTriangles;
+		if (++m_triangleFrames == 256)
+		{
+			LOG << "triangles per frame : " << m_drawnTriangles / m_triangleFrames << " drawn of "
+				<< m_fullTriangles / m_triangleFrames << ", " << (m_fullTriangles - m_drawnTriangles) / m_triangleFrames
+				<< " saved by the levels of detail and meshlet culling" << ENDL;
+			m_fullTriangles = m_drawnTriangles = 0;
+			m_triangleFrames = 0;
+		}
+	}
+	//the push constants hold the root transform
+	if (memcmp(m_drawModel.constData(), m_scene->drawModel().constData(), sizeof(Matrix4x4)))
+		rebuild = true;
+	//images were swapped, table slots are rewritten in place, other sets are
+	//replaced and the recorded command buffers with them
+	if (m_residency->update() && updateDescriptorSet())
+		rebuild = true;
+	if (rebuild)
+		rebuildCommandBuffers();
+
 	VkRenderer::begin();
 
 	m_submitInfo.commandBufferCount = 1;
@@ -324,28 +496,73 @@ void TextureRenderer::updateShader()
 }
 
 
-void TextureRenderer::renderOptional(VkCommandBuffer cmd, RenderType type)
+void TextureRenderer::renderOptional(VkCommandBuffer cmd, RenderType type, uint32_t phase)
 {
-	for (auto& mesh : m_scene->meshs)
+	//solid draws go before every wire draw, the queue keeps the passes apart
+	m_renderQueue.clear(m_pipelineLayout);
+	//one indirect draw per mesh and level, or one draw per visible batch
+	size_t drawCount = m_computeCulling ? m_scene->meshs.size() : m_scene->batches.size();
+	for (uint32_t i = 0; i < drawCount; ++i)
 	{
 		if (type == RenderType::MAIN)
-			mesh->render(cmd, NULL);
-
+			drawMesh(phase, 0, i, NULL);
 		else if (type == RenderType::SOILDWIRE) {
-			mesh->render(cmd, soildPipeline);
-			//vkCmdSetDepthBias (polygon offset)
-			/*commandBuffer is the command buffer into which the command will be recorded.
-			depthBiasConstantFactor : is a scalar factor controlling the
-				constant depth value added to each fragment.
-			depthBiasClamp  : is the maximum(or minimum) depth bias of a fragment.
-			depthBiasSlopeFactor : is a scalar factor applied to a fragments 
-				slope in depth bias calculations.*/
-			//set to slope increase clamps negative -1.0f from 0.0f - 1.0f
-			vkCmdSetDepthBias(cmd, 1.0f, 0.0f, -1.0f);
-			mesh->render(cmd, wirePipeline);
+			drawMesh(phase, 0, i, soildPipeline);
+			drawMesh(phase, 1, i, wirePipeline);
 		}
 		else if (type == RenderType::WIRE) {
-			mesh->render(cmd, wirePipeline);
+			drawMesh(phase, 0, i, wirePipeline);
 		}
 	}
-}
\ No newline at end of file
+
+	if (type != RenderType::MAIN)
+	{
+		//vkCmdSetDepthBias (polygon offset)
+		/*commandBuffer is the command buffer into which the command will be recorded.
+		depthBiasConstantFactor : is a scalar factor controlling the
+			constant depth value added to each fragment.
+		depthBiasClamp  : is the maximum(or minimum) depth bias of a fragment.
+		depthBiasSlopeFactor : is a scalar factor applied to a fragments 
+			slope in depth bias calculations.*/
+		//set to slope increase clamps negative -1.0f from 0.0f - 1.0f
+		vkCmdSetDepthBias(cmd, 1.0f, 0.0f, -1.0f);
+	}
+	m_renderQueue.sort();
+	m_renderQueue.record(cmd);
+}
+
+void TextureRenderer::drawMesh(uint32_t phase, uint32_t pass, uint32_t draw, VkPipeline pipeline)
+{
+	if (m_computeCulling)
+	{
+		RenderDraw indirect = m_scene->meshs[draw]->draw(pipeline);
+		indirect.descriptorSet = m_materialSets[m_scene->meshs[draw]->texture];
+		indirect.constants = drawConstants(m_scene->meshs[draw].get());
+		m_computeCulling->draw(m_renderQueue, pass, phase, draw, indirect);
+		return;
+	}
+	const DrawBatch &batch = m_scene->batches[draw];
+	const VKMesh* mesh = m_scene->meshs[batch.mesh].get();
+	RenderDraw command = mesh->draw(pipeline);
+	command.descriptorSet = m_materialSets[mesh->texture];
+	command.constants = drawConstants(mesh);
+	command.instanceBuffer = m_scene->instanceBuffer.buffer;
+	command.instanceCount = batch.instanceCount;
+	command.firstInstance = batch.firstInstance;
+	if (batch.rangeCount)
+	{
+		//the visible clusters of one instance
+		for (uint32_t r = 0; r < batch.rangeCount; ++r)
+		{
+			const IndexRange &range = m_scene->visibleRanges[batch.firstRange + r];
+			command.firstIndex = range.firstIndex;
+			command.indexCount = range.indexCount;
+			m_renderQueue.submit(pass, command, batch.depth);
+		}
+		return;
+	}
+	MeshLod range = mesh->lod(batch.lod);
+	command.firstIndex = range.firstIndex;
+	command.indexCount = range.indexCount;
+	m_renderQueue.submit(pass, command, batch.depth);
+}
@@ -3,6 +3,9 @@
 #include <vkrenderer.h>
 #include <shader.h>
 #include <pipelineinfo.h>
+#include <renderqueue.h>
+#include <rendergraph.h>
+#include <vector>
 
 enum class RenderType : uint32_t
 {
@@ -15,7 +18,12 @@ enum class RenderType : uint32_t
 class QWindow;
 class Shader;
 class Texture;
+class TextureResidency;
+class ComputeCulling;
+class BindlessTable;
+class VKMesh;
 class Pipeline;
+struct DescriptorResource;
 class TextureRenderer : public VkRenderer
 {
 public:
@@ -23,20 +31,41 @@ public:
 	virtual~TextureRenderer();
 
 	VkPipelineLayout m_pipelineLayout;
-	VkDescriptorSet m_descriptorSet;
-	VkDescriptorSetLayout m_descriptorSetLayout;
-	VkDescriptorPool m_descriptorPool;
+	//set 0, from VkRenderer::m_descriptorCache
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+
+	//knot instances added by buildScene, main sets it from --knots <count>
+	static uint32_t stressInstances;
+	//skip the compute culling pass even where it is supported, --cpu-culling
+	static bool cpuCulling;
+	//one texture table for all materials where descriptor indexing is
+	//supported, a set per material otherwise. --no-bindless turns it off
+	static bool bindlessTextures;
+	//gpu ms per frame the dynamic resolution keeps to, 0 draws at the
+	//swapchain's resolution. --frame-ms <ms>
+	static double targetFrameMs;
 
 	void buildProcedural();
 	void buildScene();
 	void buildDescriptorSetLayout();
 	void buildPipeline();
-	void buildDescriptorPool();
 	void buildDescriptorSet();
+	//true if the sets changed and command buffers have to be recorded again
+	bool updateDescriptorSet();
 	void buildCommandBuffers();
 
 	//texture
 	Texture* m_texture;
+	Texture* m_envTexture;
+	TextureResidency* m_residency = NULL;
+	//VKMesh::texture indexes these. a set per material, with the bindless
+	//table they all share one and the slots tell the textures apart
+	std::vector<Texture*> m_materialTextures;
+	std::vector<VkDescriptorSet> m_materialSets;
+	BindlessTable* m_bindless = NULL;
+	std::vector<uint32_t> m_textureSlots;
+	//gpu driven draws, NULL when culling runs on the cpu
+	ComputeCulling* m_computeCulling = NULL;
 	void buildTexture();
 	
 	void render();
@@ -44,7 +73,8 @@ public:
 
 	void updateShader();
 	//test
-	void renderOptional(VkCommandBuffer cmd, RenderType type);
+	//phase of the compute culling, 0 without it
+	void renderOptional(VkCommandBuffer cmd, RenderType type, uint32_t phase = 0);
 	RenderType m_renderType = RenderType::MAIN;
 
 	/*DEFAULT PIPELINES AND SHADER*/
@@ -60,6 +90,30 @@ public:
 	shader_ptr wireShader = NULL;*/
 	
 private:
+	//set 0 of a material, the ubo, the environment map and without the
+	//bindless table the material's texture
+	std::vector<DescriptorResource> descriptorResources(uint32_t material) const;
+	//mesh's push constants with its table slot
+	DrawConstants drawConstants(const VKMesh* mesh) const;
+
+	//draw is a mesh index with compute culling, a batch index otherwise.
+	//submits to m_renderQueue, pass orders it against the other draws
+	void drawMesh(uint32_t phase, uint32_t pass, uint32_t draw, VkPipeline pipeline);
+
+	//draws of the render pass being recorded
+	RenderQueue m_renderQueue;
+	//the bind counts buildCommandBuffers last reported
+	RenderQueueStats m_loggedBinds;
+	//and the barriers and render passes of the graph
+	RenderGraph::Stats m_loggedGraph = {};
+	//Scene::drawModel the command buffers were recorded with
+	Matrix4x4 m_drawModel;
+
 	VkPrimitiveTopology defaultTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	//triangles of the cpu culled frames since the last report, see render
+	uint64_t m_fullTriangles = 0;
+	uint64_t m_drawnTriangles = 0;
+	uint32_t m_triangleFrames = 0;
 };
 
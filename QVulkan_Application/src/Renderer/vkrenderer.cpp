@@ -4,6 +4,10 @@
 #include <vkdevice.h>
 #include <vkswapchain.h>
 #include <vksemaphore.h>
+#include <vkdescriptor.h>
+#include <rendergraph.h>
+#include <vkattachment.h>
+#include <dynamicresolution.h>
 
 VkRenderer::VkRenderer(QWindow *window)
 	: m_window(window), m_scene(NULL)
@@ -22,17 +26,22 @@ VkRenderer::~VkRenderer()
 	releaseCommandBuffers();
 	//sub build funtions
 	vkDestroyRenderPass(m_device, m_renderPass, nullptr);
-	for (uint32_t i = 0; i < m_frameBuffers.size(); i++)
-	{
-		vkDestroyFramebuffer(m_device, m_frameBuffers[i], nullptr);
-	}
+	SAFE_DELETE(m_renderGraph);
+	releaseFrameBuffer();
 
-	vkDestroyImageView(m_device, m_depthStencil.view, nullptr);
-	vkDestroyImage(m_device, m_depthStencil.image, nullptr);
-	vkFreeMemory(m_device, m_depthStencil.memory, nullptr);
+	releaseAttachments();
+	SAFE_DELETE(m_attachments);
+	SAFE_DELETE(m_resolution);
+	if (m_frameQueries)
+		vkDestroyQueryPool(m_device, m_frameQueries, nullptr);
 
 	vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
 
+	//sets go with their pools, layouts last
+	SAFE_DELETE(m_descriptorCache);
+	SAFE_DELETE(m_descriptorAllocator);
+	SAFE_DELETE(m_layoutCache);
+
 	if (m_commandPool)
 		vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 
@@ -55,7 +64,6 @@ void VkRenderer::initialize()
 	m_vulkanDevice->buildPhysicalDevice();
 	m_vulkanDevice->buildLogicalDevice(enabledFeatures);
 	m_vulkanDevice->getGraphicsQueue(&m_queue);					
-	m_vulkanDevice->getSupportedDepthFormat(&m_depthFormat);
 	
 	m_swapchain = new VulkanSwapchain(m_instance, m_device, m_physicalDevice, m_surface);
 	m_swapchain->init();
@@ -63,6 +71,11 @@ void VkRenderer::initialize()
 	m_semaphores = new VulkanSemaphore(m_device);
 	m_semaphores->buildSemaphores();
 
+	m_layoutCache = new DescriptorLayoutCache(m_device);
+	m_descriptorAllocator = new DescriptorAllocator(m_device);
+	m_descriptorCache = new DescriptorCache(m_device, *m_layoutCache, *m_descriptorAllocator);
+	m_renderGraph = new RenderGraph(m_device);
+
 	buildSubmitInfo();
 }
 
@@ -71,7 +84,10 @@ void VkRenderer::buildProcedural()
 	buildCommandPool();
 	m_swapchain->buildSwapchain(&width, &height);
 	allocateCommandBuffers();
-	buildDepthStencil();
+	buildResolution();
+	//sampled only when a later frame reads it
+	m_vulkanDevice->getSupportedDepthFormat(&m_depthFormat, m_depthBits, false, m_depthHistory);
+	buildAttachments();
 	buildRenderPass();
 	buildPipelineCache();
 	buildFrameBuffer();
@@ -106,15 +122,7 @@ void VkRenderer::resize()
 	isBuilt = false;
 
 	m_swapchain->buildSwapchain(&width, &height);
-
-	vkDestroyImageView(m_device, m_depthStencil.view, nullptr);
-	vkDestroyImage(m_device, m_depthStencil.image, nullptr);
-	vkFreeMemory(m_device, m_depthStencil.memory, nullptr);
-	buildDepthStencil();
-
-	for (auto frameBuffer : m_frameBuffers)
-		vkDestroyFramebuffer(m_device, frameBuffer, nullptr);
-	buildFrameBuffer();
+	rebuildTargets();
 
 	vkFreeCommandBuffers(m_device, m_commandPool, m_commandBuffers.size(), m_commandBuffers.data());
 	allocateCommandBuffers();
@@ -10,6 +10,12 @@ class VulkanInstance;
 class VulkanDevice;
 class VulkanSwapchain;
 class VulkanSemaphore;
+class DescriptorLayoutCache;
+class DescriptorAllocator;
+class DescriptorCache;
+class RenderGraph;
+class AttachmentPool;
+class DynamicResolution;
 class Scene;
 class VkRenderer
 {
@@ -23,6 +29,11 @@ public:
 	/*COMMON FORMAT*/
 	VkFormat m_colorFormat = VK_FORMAT_B8G8R8A8_UNORM;		//vec3
 	VkFormat m_depthFormat;
+	//the smallest format with that many bits is picked
+	uint32_t m_depthBits = 24;
+	//depth is read by the next frame, set before buildProcedural. it keeps
+	//its memory and contents, otherwise it is transient
+	bool m_depthHistory = false;
 
 	/*INSTANCE*/
 	VulkanInstance* m_vulkanInstance = NULL;
@@ -60,15 +71,54 @@ public:
 	{
 		VkImage image;
 		VkImageView view;
-		VkDeviceMemory memory;
+		//depth aspect only, for sampling in compute
+		VkImageView depthView;
+		//every aspect of the format, what barriers on the image cover
+		VkImageSubresourceRange range;
 	}m_depthStencil;
+	//memory of the render targets, shared or lazily allocated where it can be
+	AttachmentPool* m_attachments = NULL;
+	uint32_t m_depthAttachment;
+	//steps of the frame TextureRenderer records, what attachment lifetimes
+	//are given in. the pool is built before any graph is declared, so they
+	//are not taken from a compiled one
+	enum FrameStep : uint32_t { STEP_DRAW, STEP_UPSCALE };
+	//counted up by every buildAttachments. views of new targets may get
+	//the handles of destroyed ones, users compare this instead
+	uint32_t m_targetGeneration = 0;
+
+	/*DYNAMIC RESOLUTION*/
+	//gpu time per frame to keep under, set before buildProcedural. above 0
+	//the scene is drawn into m_sceneColor at a scale of the swapchain that
+	//follows the time, and blitted up into the swapchain image at the end
+	double m_targetFrameMs = 0.0;
+	DynamicResolution* m_resolution = NULL;
+	struct
+	{
+		VkImage image;
+		VkImageView view;
+		VkFramebuffer frameBuffer;
+	}m_sceneColor = {};
+	uint32_t m_sceneAttachment;
+	//begin and end of the frame
+	VkQueryPool m_frameQueries = VK_NULL_HANDLE;
 
 	/*REDNER PASS*/
+	//pipelines and frame buffers are built against it, frames record the
+	//compatible render passes of m_renderGraph
 	VkRenderPass m_renderPass;
+	RenderGraph* m_renderGraph = NULL;
 
 	/*PIPELINE CACHE*/
 	VkPipelineCache m_pipelineCache;
 
+	/*DESCRIPTORS*/
+	//layouts shared by every pass, sets that live as long as the renderer
+	//and the cache of written sets over them
+	DescriptorLayoutCache* m_layoutCache = NULL;
+	DescriptorAllocator* m_descriptorAllocator = NULL;
+	DescriptorCache* m_descriptorCache = NULL;
+
 	/*FRAME BUFFERS*/
 	std::vector<VkFramebuffer> m_frameBuffers;
 	uint32_t m_currentBuffer = 0;				//active frame buffer index
@@ -87,10 +137,30 @@ public:
 	/*SUB FUNCTIONS*/
 	void buildCommandPool();
 	void allocateCommandBuffers();
-	void buildDepthStencil();
+	void buildResolution();
+	//depth stencil and with dynamic resolution the scene color, at renderExtent
+	void buildAttachments();
+	void releaseAttachments();
 	void buildRenderPass();
 	void buildPipelineCache();
 	void buildFrameBuffer();
+	void releaseFrameBuffer();
+	//attachments and frame buffers for a new extent, the command buffers are left to the caller
+	void rebuildTargets();
+
+	/*DYNAMIC RESOLUTION FUNCTIONS*/
+	//extent the scene is drawn at, the swapchain's without dynamic resolution
+	VkExtent2D renderExtent() const;
+	//m_colorFormat blits with a linear filter into the swapchain images
+	bool canUpscale() const;
+	//timestamps around everything recorded in between
+	void beginFrameTiming(VkCommandBuffer cmd);
+	void endFrameTiming(VkCommandBuffer cmd);
+	//the scene color filtered up into target at the end of the frame
+	void addUpscale(RenderGraph &graph, uint32_t scene, uint32_t target);
+	//scale from the time of the last frame, true if the targets were built
+	//again and the command buffers have to follow
+	bool updateResolution();
 
 	/*COMMAND BUFFER FUNCTIONS*/
 	virtual void buildCommandBuffers() {};
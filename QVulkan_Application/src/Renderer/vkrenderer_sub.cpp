@@ -3,6 +3,9 @@
 #include <vktools.h>
 #include <vkswapchain.h>
 #include <vkdevice.h>
+#include <vkattachment.h>
+#include <rendergraph.h>
+#include <dynamicresolution.h>
 
 	/*SUB BUILD FUNCTIONS*/
 
@@ -31,69 +34,90 @@ void VkRenderer::allocateCommandBuffers()
 		vkAllocateCommandBuffers(m_device, &allocInfo, m_commandBuffers.data());
 }
 
-void VkRenderer::buildDepthStencil()
+void VkRenderer::buildAttachments()
 {
 	LOG_SECTION("create depth stencil");
-	VkImageCreateInfo imageInfo{};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.pNext = NULL;
-	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.format = m_depthFormat;
-	imageInfo.extent = { width , height, 1 };
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-	imageInfo.flags = 0;
-
-	VkMemoryAllocateInfo memAllocInfo{};
-	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAllocInfo.pNext = NULL;
-	memAllocInfo.allocationSize = 0;			//default 
-	memAllocInfo.memoryTypeIndex = 0;
+	//the occlusion pass of ComputeCulling samples it and starts it cleared to
+	//the far plane. any other depth never leaves the frame
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, m_depthFormat, &formatProperties);
+	if (m_depthHistory && (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+		usage |= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	//depth is drawn into, the scene color lives on until the upscale. the two
+	//overlap, so the pool never aliases them and aliasing in the real frame
+	//stays unused. the attachments bench exercises it
+	VkExtent2D extent = renderExtent();
+	if (!m_attachments)
+	{
+		m_attachments = new AttachmentPool(m_vulkanDevice);
+		m_depthAttachment = m_attachments->add({ "depth", m_depthFormat, extent, usage,
+			STEP_DRAW, STEP_DRAW, m_depthHistory });
+		if (m_resolution)
+			m_sceneAttachment = m_attachments->add({ "scene color", m_colorFormat, extent,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, STEP_DRAW, STEP_UPSCALE, false });
+	}
+	AttachmentDesc &desc = m_attachments->desc(m_depthAttachment);
+	desc.format = m_depthFormat;
+	desc.extent = extent;
+	desc.usage = usage;
+	desc.acrossFrames = m_depthHistory;
+	if (m_resolution)
+		m_attachments->desc(m_sceneAttachment).extent = extent;
+
+	/*CREATE IMAGE*/
+	++m_targetGeneration;
+	m_attachments->build();
+	m_attachments->report();
+	m_depthStencil.image = m_attachments->image(m_depthAttachment);
 
 	VkImageViewCreateInfo depthStencilView{};
 	depthStencilView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	depthStencilView.pNext = NULL;
-	//depthStencilView.image = ;      //we will attach image after bind
+	depthStencilView.image = m_depthStencil.image;
 	depthStencilView.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	depthStencilView.format = m_depthFormat;
 	depthStencilView.flags = 0;
 	depthStencilView.subresourceRange = {};
-	depthStencilView.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT |
-		VK_IMAGE_ASPECT_STENCIL_BIT;
+	depthStencilView.subresourceRange.aspectMask = attachmentAspect(m_depthFormat);
 	depthStencilView.subresourceRange.baseMipLevel = 0;
 	depthStencilView.subresourceRange.levelCount = 1;
 	depthStencilView.subresourceRange.baseArrayLayer = 0;
 	depthStencilView.subresourceRange.layerCount = 1;
 
-	VkMemoryRequirements memReqs;
-
-	/*CREATE IMAGE*/
-	vkCreateImage(m_device, &imageInfo, nullptr, &m_depthStencil.image);
-	//get reqiure memory
-	vkGetImageMemoryRequirements(m_device, m_depthStencil.image, &memReqs);
-	
-	//get allocate info from reqiurement memory properties
-	memAllocInfo.allocationSize = memReqs.size;			//default 
-	memAllocInfo.memoryTypeIndex = m_vulkanDevice->getMemoryType(memReqs.memoryTypeBits,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	LOG << "depth stencil memory size : "<<memReqs.size << ENDL;
-	LOG << "depth stencil type : " << memReqs.memoryTypeBits << ENDL;
-	
-	LOG_ERROR("failed to allocate depth memory") <<
-	vkAllocateMemory(m_device, &memAllocInfo, nullptr, &m_depthStencil.memory);
-
-	LOG_ERROR("failed to bind depth memory") <<
-	vkBindImageMemory(m_device,m_depthStencil.image, m_depthStencil.memory, 0);
-
-	depthStencilView.image = m_depthStencil.image;
-	
 	/*CREATE IMAGE VIEW*/
 	LOG_ERROR("failed to create depth image view") <<
 	vkCreateImageView(m_device, &depthStencilView, nullptr, &m_depthStencil.view);
+
+	m_depthStencil.range = depthStencilView.subresourceRange;
+	//a sampled view may only name one aspect
+	depthStencilView.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	LOG_ERROR("failed to create depth sampling view") <<
+	vkCreateImageView(m_device, &depthStencilView, nullptr, &m_depthStencil.depthView);
+
+	if (!m_resolution)
+		return;
+	m_sceneColor.image = m_attachments->image(m_sceneAttachment);
+	VkImageViewCreateInfo colorView{};
+	colorView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	colorView.image = m_sceneColor.image;
+	colorView.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	colorView.format = m_colorFormat;
+	colorView.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	LOG_ERROR("failed to create scene color view") <<
+	vkCreateImageView(m_device, &colorView, nullptr, &m_sceneColor.view);
+}
+
+void VkRenderer::releaseAttachments()
+{
+	vkDestroyImageView(m_device, m_depthStencil.depthView, nullptr);
+	vkDestroyImageView(m_device, m_depthStencil.view, nullptr);
+	vkDestroyImageView(m_device, m_sceneColor.view, nullptr);
+	m_sceneColor.view = VK_NULL_HANDLE;
+	//the images and their memory belong to the pool
+	if (m_attachments)
+		m_attachments->release();
 }
 
 void VkRenderer::buildRenderPass()
@@ -137,37 +161,17 @@ void VkRenderer::buildRenderPass()
 	subpassDescription.pPreserveAttachments = nullptr;
 	subpassDescription.pResolveAttachments = nullptr;
 
-	std::array<VkSubpassDependency, 2> dependencies;
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	dependencies[1].srcSubpass = 0;
-	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
+	//barriers and layouts around it come from the render graph, only the
+	//attachments and the subpass have to match the passes it builds
 	VkRenderPassCreateInfo renderPassinfo{};
 	renderPassinfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 	renderPassinfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 	renderPassinfo.pAttachments = attachments.data();
 	renderPassinfo.subpassCount = 1;
 	renderPassinfo.pSubpasses = &subpassDescription;
-	renderPassinfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-	renderPassinfo.pDependencies = dependencies.data();
 
 	LOG_ERROR("failed to create redner pass") <<
 		vkCreateRenderPass(m_device, &renderPassinfo, nullptr, &m_renderPass);
-
 }
 
 void VkRenderer::buildPipelineCache()
@@ -187,16 +191,26 @@ void VkRenderer::buildFrameBuffer()
 	//depth/ stencil attachment is the same for all frame buffers
 	attachments[1] = m_depthStencil.view;
 
+	VkExtent2D extent = renderExtent();
 	VkFramebufferCreateInfo frameBufferCreateinfo{};
 	frameBufferCreateinfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 	frameBufferCreateinfo.pNext = NULL;
 	frameBufferCreateinfo.renderPass = m_renderPass;
 	frameBufferCreateinfo.attachmentCount = 2;
 	frameBufferCreateinfo.pAttachments = attachments;
-	frameBufferCreateinfo.width = width;
-	frameBufferCreateinfo.height = height;
+	frameBufferCreateinfo.width = extent.width;
+	frameBufferCreateinfo.height = extent.height;
 	frameBufferCreateinfo.layers = 1;
 
+	//one for the scene color whatever swapchain image the frame goes to
+	if (m_resolution)
+	{
+		attachments[0] = m_sceneColor.view;
+		LOG_ERROR("failed to create scene frame buffer") <<
+		vkCreateFramebuffer(m_device, &frameBufferCreateinfo, nullptr, &m_sceneColor.frameBuffer);
+		return;
+	}
+
 	//create frambuffer for every swap chain image
 	m_frameBuffers.resize(m_swapchain->m_imageCount);
 	for (uint32_t i = 0; i < m_frameBuffers.size(); ++i)
@@ -213,6 +227,121 @@ void VkRenderer::buildFrameBuffer()
 
 }
 
+void VkRenderer::releaseFrameBuffer()
+{
+	for (auto frameBuffer : m_frameBuffers)
+		vkDestroyFramebuffer(m_device, frameBuffer, nullptr);
+	m_frameBuffers.clear();
+	vkDestroyFramebuffer(m_device, m_sceneColor.frameBuffer, nullptr);
+	m_sceneColor.frameBuffer = VK_NULL_HANDLE;
+}
+
+void VkRenderer::rebuildTargets()
+{
+	releaseAttachments();
+	buildAttachments();
+	releaseFrameBuffer();
+	buildFrameBuffer();
+}
+
+	/*DYNAMIC RESOLUTION*/
+
+void VkRenderer::buildResolution()
+{
+	if (m_targetFrameMs <= 0.0)
+		return;
+	LOG_SECTION("create dynamic resolution");
+	if (!canUpscale())
+	{
+		LOG << "dynamic resolution : off, no linear blit into the swapchain or no timestamps" << ENDL;
+		return;
+	}
+	m_resolution = new DynamicResolution(m_targetFrameMs);
+
+	VkQueryPoolCreateInfo queryInfo{};
+	queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryInfo.queryCount = 2;
+	LOG_ERROR("failed to create frame query pool") <<
+		vkCreateQueryPool(m_device, &queryInfo, nullptr, &m_frameQueries);
+	//queries start out undefined, reset once so a read before the first frame only finds them unavailable
+	VkCommandBuffer cmd = m_vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	vkCmdResetQueryPool(cmd, m_frameQueries, 0, 2);
+	m_vulkanDevice->flushCommandBuffer(cmd, m_queue);
+	//the frame starts once the image is acquired, not when it is submitted
+	m_submitPipelineStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	LOG << "dynamic resolution : " << m_targetFrameMs << " ms per frame" << ENDL;
+}
+
+VkExtent2D VkRenderer::renderExtent() const
+{
+	VkExtent2D full = { width, height };
+	return m_resolution ? m_resolution->extent(full) : full;
+}
+
+bool VkRenderer::canUpscale() const
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, m_colorFormat, &properties);
+	VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+		VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (properties.optimalTilingFeatures & needed) == needed &&
+		(m_swapchain->m_imageUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+		m_vulkanDevice->m_properties.limits.timestampComputeAndGraphics == VK_TRUE;
+}
+
+void VkRenderer::beginFrameTiming(VkCommandBuffer cmd)
+{
+	if (!m_frameQueries)
+		return;
+	vkCmdResetQueryPool(cmd, m_frameQueries, 0, 2);
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_frameQueries, 0);
+}
+
+void VkRenderer::endFrameTiming(VkCommandBuffer cmd)
+{
+	if (m_frameQueries)
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frameQueries, 1);
+}
+
+void VkRenderer::addUpscale(RenderGraph &graph, uint32_t scene, uint32_t target)
+{
+	uint32_t pass = graph.addPass("upscale", false, [this, &graph, scene, target](VkCommandBuffer cmd)
+	{
+		VkExtent2D extent = renderExtent();
+		VkImageBlit blit{};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		blit.srcOffsets[1] = { int32_t(extent.width), int32_t(extent.height), 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		blit.dstOffsets[1] = { int32_t(width), int32_t(height), 1 };
+		vkCmdBlitImage(cmd, graph.image(scene), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			graph.image(target), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+	});
+	graph.use(pass, scene, GraphAccess::TRANSFER_READ);
+	graph.use(pass, target, GraphAccess::TRANSFER_WRITE);
+}
+
+bool VkRenderer::updateResolution()
+{
+	if (!m_resolution)
+		return false;
+	//end waited for the queue, the stamps of the last frame are there. not before the first submit
+	uint64_t stamps[2] = {};
+	if (vkGetQueryPoolResults(m_device, m_frameQueries, 0, 2, sizeof(stamps), stamps, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return false;
+	double ms = (stamps[1] - stamps[0]) * m_vulkanDevice->m_properties.limits.timestampPeriod * 1e-6;
+	if (!m_resolution->update(ms))
+		return false;
+
+	rebuildTargets();
+	VkExtent2D extent = renderExtent();
+	LOG << "dynamic resolution : scale " << m_resolution->scale() << ", " << extent.width << " x " << extent.height
+		<< " of " << width << " x " << height << " at " << m_resolution->averageMs() << " ms for "
+		<< m_resolution->targetMs() << ENDL;
+	return true;
+}
+
 bool VkRenderer::checkCommandBuffers()
 {
 	for (auto& cmdBuffer : m_commandBuffers)
@@ -14,16 +14,19 @@ Camera::~Camera()
 
 void Camera::perspective(float fovy, float aspect, float znear, float zfar)
 {
+	//called every frame, the matrix only changes with the window
+	if (fovy == m_fovy && aspect == m_aspect && znear == m_znear && zfar == m_zfar)
+		return;
 	m_fovy = fovy;
 	m_aspect = aspect;
 	m_znear = znear;
 	m_zfar = zfar;
-	proj = vml::perspective(m_fovy, m_aspect, m_znear, m_zfar);
+	proj = vml::perspectiveRuntime<vml::VulkanConvention>(m_fovy, m_aspect, m_znear, m_zfar);
 }
 
 void Camera::lookAt(const vec3f &eye, const vec3f &center, const vec3f &up)
 {
-	view = vml::lookAt(eye, center, up);
+	view = vml::lookAt<vml::VulkanConvention>(eye, center, up);
 }
 
 void Camera::rotate(const vec3f & rot)
@@ -49,6 +52,6 @@ void Camera::update()
 //void Camera::update(uint32_t width, uint32_t height)
 //{
 //	m_aspect = width / (float)height;
-//	proj = vml::perspective(m_fovy, m_aspect, m_znear, m_zfar);
+//	proj = vml::perspective<vml::VulkanConvention>(m_fovy, m_aspect, m_znear, m_zfar);
 //	update();
 //}
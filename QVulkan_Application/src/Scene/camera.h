@@ -1,8 +1,6 @@
 #pragma once
 
 #include <vec3f.h>
-#define VML_USE_VULKAN
-//#define VML_USE_OPENGL
 #include <matrix4x4.h>
 #include <memory>
 class Camera
@@ -27,10 +25,10 @@ public:
 
 	float m_zoomSpeed = 0.0036f;
 
-	float m_aspect;
-	float m_fovy;
-	float m_znear;
-	float m_zfar;
+	float m_aspect = 0.0f;
+	float m_fovy = 0.0f;
+	float m_znear = 0.0f;
+	float m_zfar = 0.0f;
 
 	void update();
 	/*void update(uint32_t width, uint32_t height);*/
@@ -0,0 +1,39 @@
+#include "imagedecoder.h"
+#include <vklog.h>
+#include <threadpool.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_PNG
+#include <std_image/stb_image.h>
+
+DecodedImage::~DecodedImage()
+{
+	if (pixels)
+		stbi_image_free(pixels);
+}
+
+image_ptr imageDecoder::decode(const std::string &filename)
+{
+	image_ptr image = image_ptr(new DecodedImage);
+	int channels = 0;
+	//request 4 components, stb converts while decoding so there is no second pass
+	image->pixels = stbi_load(filename.c_str(), &image->width, &image->height, &channels, STBI_rgb_alpha);
+	if (!image->pixels)
+	{
+		LOG_WARN("failed to decode image : " + filename);
+		return nullptr;
+	}
+	return image;
+}
+
+std::future<image_ptr> imageDecoder::decodeAsync(const std::string &filename)
+{
+	return ThreadPool::global().enqueue([filename] { return decode(filename); });
+}
+
+bool imageDecoder::info(const std::string &filename, int *width, int *height)
+{
+	int channels = 0;
+	return stbi_info(filename.c_str(), width, height, &channels) != 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <future>
+
+//decoded 8 bit RGBA pixels owned by stb_image
+struct DecodedImage
+{
+	DecodedImage() {}
+	~DecodedImage();
+
+	int width = 0;
+	int height = 0;
+	uint8_t* pixels = nullptr;
+
+	size_t byteSize() const { return size_t(width) * height * 4; }
+};
+
+typedef std::shared_ptr<DecodedImage> image_ptr;
+
+namespace imageDecoder
+{
+	//decode jpg/png straight to RGBA on the calling thread
+	image_ptr decode(const std::string &filename);
+
+	//decode on the shared worker pool
+	std::future<image_ptr> decodeAsync(const std::string &filename);
+
+	//header only, does not decode pixels
+	bool info(const std::string &filename, int *width, int *height);
+}
@@ -97,7 +97,10 @@ void meshTool::LoadModel(
 			mesh->indices.push_back(uniqueVertices[vertex]);
 		}
 	}
+	if (!mesh->vertices.empty())
+		mesh->bounds = Bounds::fromPoints(&mesh->vertices[0].pos, mesh->vertices.size(), sizeof(Vertex));
 	LOG << "vertices num : " << mesh->vertices.size() << ENDL;
 	LOG << "indices num : " << mesh->indices.size() << ENDL;
+	LOG << "bounds : " << mesh->bounds.min << " " << mesh->bounds.max << " radius " << mesh->bounds.radius << ENDL;
 }
 
@@ -2,6 +2,23 @@
 
 #include <vktools.h>
 #include <vertex.h>
+#include <bvh.h>
+#include <occlusionbuffer.h>
+#include <simplify.h>
+#include <meshlet.h>
+#include <renderqueue.h>
+
+//part of a mesh's index buffer
+struct IndexRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+
+	bool operator==(const IndexRange &other) const
+	{
+		return firstIndex == other.firstIndex && indexCount == other.indexCount;
+	}
+};
 
 typedef struct Buffer
 {
@@ -15,6 +32,28 @@ public:
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 
+	//object space, filled by meshTool::LoadModel
+	Bounds bounds;
+	//object space triangles, built by Scene::buildBvh
+	TriangleBvh bvh;
+	//largest triangles for the software occlusion buffer, built with bvh
+	Occluder occluder;
+	//level 0 is indices, the coarser levels index the same vertices and follow
+	//it in lodIndices and in the index buffer. built by Scene::buildLods
+	std::vector<MeshLod> lods;
+	std::vector<uint32_t> lodIndices;
+	//clusters of level 0, indices is ordered so each one is a range of it.
+	//built by Scene::buildClusters
+	std::vector<Meshlet> meshlets;
+
+	uint32_t lodCount() const { return lods.empty() ? 1 : (uint32_t)lods.size(); }
+	MeshLod lod(uint32_t level) const
+	{
+		if (level < lods.size())
+			return lods[level];
+		MeshLod full = { 0, (uint32_t)indices.size(), 0.0f };
+		return full;
+	}
 };
 
 class VKMesh : public Mesh
@@ -22,27 +61,43 @@ class VKMesh : public Mesh
 public:
 	VKMesh() : Mesh(){}
 
+	//positions of every vertex, then their VertexAttributes at attributeOffset
 	Buffer vbo;
+	VkDeviceSize attributeOffset = 0;
 	Buffer ibo;
 	VkPipeline pipeline = VK_NULL_HANDLE;
 	/*VkPipeline pipeline;*/
+	//DrawConstants::material
+	uint32_t material = 0;
+	//texture of the material, index into TextureRenderer::m_materialTextures
+	uint32_t texture = 0;
+
+	//pipeline and both vertex streams, a position only pipeline ignores
+	//binding 1. the caller adds instances and the index range
+	RenderDraw draw(VkPipeline inPipeline = VK_NULL_HANDLE) const
+	{
+		RenderDraw result;
+		result.pipeline = inPipeline ? inPipeline : pipeline;
+		result.vertexBuffer = vbo.buffer;
+		result.attributeOffset = attributeOffset;
+		result.indexBuffer = ibo.buffer;
+		return result;
+	}
 
-	void render(VkCommandBuffer cmd, VkPipeline inPipeline = NULL)
+	//push constants of the mesh's draws, model is Scene::drawModel
+	DrawConstants constants(const Matrix4x4 &model) const
 	{
-		VkDeviceSize offset[1] = { 0 };
-		if (inPipeline)
-			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, inPipeline);
-		else
-			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-		vkCmdBindVertexBuffers(cmd, 0, 1, &vbo.buffer, offset);
-		vkCmdBindIndexBuffer(cmd, ibo.buffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(cmd, indices.size(), 1, 0, 0, 0);
+		DrawConstants result = {};
+		result.model = model.transposed();
+		result.material = material;
+		return result;
 	}
 
 	//VkPipeline& getPipeline()  { return pipeline; };
+	//every level
 	uint64_t indiceBufferSize() const
 	{
-		return uint64_t(sizeof(indices[0]) * indices.size());
+		return uint64_t(sizeof(indices[0]) * (indices.size() + lodIndices.size()));
 	}
 };
 
@@ -0,0 +1,386 @@
+#include "occlusionbuffer.h"
+#include <threadpool.h>
+#include <simd.h>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+const uint32_t OcclusionBuffer::TILE;
+
+/*OCCLUDER*/
+void Occluder::build(const vec3f* source, size_t stride, const uint32_t* sourceIndices, size_t indexCount,
+	uint32_t maxTriangles)
+{
+	positions.clear();
+	indices.clear();
+	const char* base = (const char*)source;
+	auto position = [&](uint32_t index) { return *(const vec3f*)(base + index * stride); };
+
+	//twice the area, largest first
+	size_t count = indexCount / 3;
+	std::vector<std::pair<float, uint32_t>> areas(count);
+	for (size_t t = 0; t < count; ++t)
+	{
+		vec3f a = position(sourceIndices[t * 3]);
+		vec3f e1 = position(sourceIndices[t * 3 + 1]) - a;
+		vec3f e2 = position(sourceIndices[t * 3 + 2]) - a;
+		vec3f n(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+		areas[t] = std::make_pair(-sqrtf(n.x * n.x + n.y * n.y + n.z * n.z), (uint32_t)t);
+	}
+	size_t kept = std::min<size_t>(count, maxTriangles);
+	std::partial_sort(areas.begin(), areas.begin() + kept, areas.end());
+
+	//compact to the vertices the kept triangles use
+	std::vector<uint32_t> remap(indexCount ? *std::max_element(sourceIndices, sourceIndices + indexCount) + 1 : 0, UINT32_MAX);
+	for (size_t k = 0; k < kept; ++k)
+	{
+		uint32_t t = areas[k].second;
+		for (int i = 0; i < 3; ++i)
+		{
+			uint32_t index = sourceIndices[t * 3 + i];
+			if (remap[index] == UINT32_MAX) {
+				remap[index] = (uint32_t)positions.size();
+				positions.push_back(position(index));
+			}
+			indices.push_back(remap[index]);
+		}
+	}
+}
+
+/*BUFFER*/
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height)
+{
+	resize(width, height);
+}
+
+void OcclusionBuffer::resize(uint32_t width, uint32_t height)
+{
+	m_tilesX = std::max(1U, (width + TILE - 1) / TILE);
+	m_tilesY = std::max(1U, (height + TILE - 1) / TILE);
+	m_width = m_tilesX * TILE;
+	m_height = m_tilesY * TILE;
+	m_depth.assign(m_width * m_height, 1.0f);
+	m_tileMax.assign(m_tilesX * m_tilesY, 1.0f);
+}
+
+void OcclusionBuffer::begin(const Matrix4x4 &viewProj)
+{
+	m_viewProj = viewProj;
+	m_draws.clear();
+}
+
+void OcclusionBuffer::add(const Occluder* occluder, const Matrix4x4 &world)
+{
+	if (!occluder || occluder->empty()) return;
+	Draw draw = { occluder, world };
+	m_draws.push_back(draw);
+}
+
+uint32_t OcclusionBuffer::triangleCount() const
+{
+	size_t count = 0;
+	for (size_t i = 0; i < m_draws.size() && i < m_triangles.size(); ++i)
+		count += m_triangles[i].size();
+	return (uint32_t)count;
+}
+
+void OcclusionBuffer::rasterize()
+{
+	if (m_triangles.size() < m_draws.size())
+		m_triangles.resize(m_draws.size());
+	ThreadPool::global().parallelFor((uint32_t)m_draws.size(), 4, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			setup(i);
+	});
+	ThreadPool::global().parallelFor(m_tilesY, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t band = begin; band < end; ++band)
+			rasterizeBand(band, true);
+	});
+}
+
+void OcclusionBuffer::rasterizeReference()
+{
+	if (m_triangles.size() < m_draws.size())
+		m_triangles.resize(m_draws.size());
+	for (uint32_t i = 0; i < m_draws.size(); ++i)
+		setup(i);
+	for (uint32_t band = 0; band < m_tilesY; ++band)
+		rasterizeBand(band, false);
+}
+
+/*SETUP*/
+void OcclusionBuffer::setup(uint32_t draw)
+{
+	const Occluder &occluder = *m_draws[draw].occluder;
+	Matrix4x4 M = m_viewProj * m_draws[draw].world;
+	std::vector<Triangle> &out = m_triangles[draw];
+	out.clear();
+
+	//clip space corners, one register per vertex
+	std::vector<float> clip(occluder.positions.size() * 4);
+#if VML_SIMD != VML_SIMD_NONE
+	simd::float4 c0 = simd::set(M.m[0][0], M.m[1][0], M.m[2][0], M.m[3][0]);
+	simd::float4 c1 = simd::set(M.m[0][1], M.m[1][1], M.m[2][1], M.m[3][1]);
+	simd::float4 c2 = simd::set(M.m[0][2], M.m[1][2], M.m[2][2], M.m[3][2]);
+	simd::float4 c3 = simd::set(M.m[0][3], M.m[1][3], M.m[2][3], M.m[3][3]);
+	for (size_t i = 0; i < occluder.positions.size(); ++i)
+	{
+		const vec3f &p = occluder.positions[i];
+		simd::store(&clip[i * 4], simd::madd(simd::splat(p.z), c2,
+			simd::madd(simd::splat(p.y), c1, simd::madd(simd::splat(p.x), c0, c3))));
+	}
+#else
+	for (size_t i = 0; i < occluder.positions.size(); ++i)
+	{
+		const vec3f &p = occluder.positions[i];
+		for (int r = 0; r < 4; ++r)
+			clip[i * 4 + r] = M.m[r][2] * p.z + (M.m[r][1] * p.y + (M.m[r][0] * p.x + M.m[r][3]));
+	}
+#endif
+
+	for (size_t t = 0; t + 2 < occluder.indices.size(); t += 3)
+	{
+		const float* v[3] = {
+			&clip[occluder.indices[t] * 4], &clip[occluder.indices[t + 1] * 4], &clip[occluder.indices[t + 2] * 4]
+		};
+		//all three outside one side plane, or behind the near plane
+		bool rejected = false;
+		for (int axis = 0; axis < 2 && !rejected; ++axis)
+		{
+			rejected |= v[0][axis] < -v[0][3] && v[1][axis] < -v[1][3] && v[2][axis] < -v[2][3];
+			rejected |= v[0][axis] > v[0][3] && v[1][axis] > v[1][3] && v[2][axis] > v[2][3];
+		}
+		int behind = (v[0][2] < 0.0f) + (v[1][2] < 0.0f) + (v[2][2] < 0.0f);
+		if (rejected || behind == 3)
+			continue;
+
+		float polygon[4][4];
+		int count = 0;
+		if (behind == 0)
+		{
+			for (int i = 0; i < 3; ++i)
+				std::copy(v[i], v[i] + 4, polygon[count++]);
+		}
+		else
+		{
+			//near plane z = 0, vulkan depth. one vertex behind gives a quad
+			for (int i = 0; i < 3; ++i)
+			{
+				const float* p = v[i];
+				const float* q = v[(i + 1) % 3];
+				if (p[2] >= 0.0f)
+					std::copy(p, p + 4, polygon[count++]);
+				if ((p[2] >= 0.0f) != (q[2] >= 0.0f))
+				{
+					float s = p[2] / (p[2] - q[2]);
+					for (int k = 0; k < 4; ++k)
+						polygon[count][k] = p[k] + (q[k] - p[k]) * s;
+					polygon[count++][2] = 0.0f;
+				}
+			}
+		}
+		for (int i = 1; i + 1 < count; ++i)
+		{
+			const float fan[3][4] = {
+				{ polygon[0][0], polygon[0][1], polygon[0][2], polygon[0][3] },
+				{ polygon[i][0], polygon[i][1], polygon[i][2], polygon[i][3] },
+				{ polygon[i + 1][0], polygon[i + 1][1], polygon[i + 1][2], polygon[i + 1][3] }
+			};
+			emit(fan, out);
+		}
+	}
+}
+
+void OcclusionBuffer::emit(const float (*clip)[4], std::vector<Triangle> &out) const
+{
+	//pixel centers sit at half integers, row 0 is the top as in vulkan
+	float x[3], y[3], z[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		float inv = 1.0f / clip[i][3];
+		x[i] = (clip[i][0] * inv * 0.5f + 0.5f) * m_width;
+		y[i] = (clip[i][1] * inv * 0.5f + 0.5f) * m_height;
+		z[i] = clip[i][2] * inv;
+	}
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (fabsf(area) < 1e-8f)
+		return;
+	//both faces are drawn, a clockwise triangle is turned around
+	if (area < 0.0f)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+
+	Triangle tri;
+	float minX = std::max(std::min(std::min(x[0], x[1]), x[2]), -1.0f);
+	float maxX = std::min(std::max(std::max(x[0], x[1]), x[2]), (float)m_width + 1.0f);
+	float minY = std::max(std::min(std::min(y[0], y[1]), y[2]), -1.0f);
+	float maxY = std::min(std::max(std::max(y[0], y[1]), y[2]), (float)m_height + 1.0f);
+	tri.minX = std::max(0, (int32_t)ceilf(minX - 0.5f));
+	tri.maxX = std::min((int32_t)m_width - 1, (int32_t)floorf(maxX - 0.5f));
+	tri.minY = std::max(0, (int32_t)ceilf(minY - 0.5f));
+	tri.maxY = std::min((int32_t)m_height - 1, (int32_t)floorf(maxY - 0.5f));
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		int j = (i + 1) % 3;
+		tri.a[i] = y[i] - y[j];
+		tri.b[i] = x[j] - x[i];
+		tri.c[i] = -(tri.a[i] * x[i] + tri.b[i] * y[i]);
+	}
+	float inv = 1.0f / area;
+	tri.zx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * inv;
+	tri.zy = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) * inv;
+	tri.z0 = z[0] - tri.zx * x[0] - tri.zy * y[0];
+	out.push_back(tri);
+}
+
+/*RASTER*/
+namespace
+{
+	//rows first to last of one triangle. edge and depth planes are evaluated
+	//in the same order as in the simd kernel so both write the same bits
+	template<typename T>
+	void scalarSpan(float* depth, uint32_t width, const T &tri, int32_t first, int32_t last)
+	{
+		for (int32_t y = first; y <= last; ++y)
+		{
+			float py = (float)y + 0.5f;
+			float rowC[3] = { tri.b[0] * py + tri.c[0], tri.b[1] * py + tri.c[1], tri.b[2] * py + tri.c[2] };
+			float rowZ = tri.zy * py + tri.z0;
+			float* row = depth + y * width;
+			for (int32_t x = tri.minX; x <= tri.maxX; ++x)
+			{
+				float px = (float)x + 0.5f;
+				float e0 = tri.a[0] * px + rowC[0];
+				float e1 = tri.a[1] * px + rowC[1];
+				float e2 = tri.a[2] * px + rowC[2];
+				if (std::min(e0, std::min(e1, e2)) < 0.0f)
+					continue;
+				row[x] = std::min(row[x], tri.zx * px + rowZ);
+			}
+		}
+	}
+
+#if VML_SIMD != VML_SIMD_NONE
+	using namespace simd;
+
+	template<typename V, typename T>
+	void simdSpan(float* depth, uint32_t width, const T &tri, int32_t first, int32_t last)
+	{
+		typedef lanes<V> L;
+		static const float offsets[8] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+		V a0 = L::splat(tri.a[0]), a1 = L::splat(tri.a[1]), a2 = L::splat(tri.a[2]);
+		V zx = L::splat(tri.zx);
+		//lanes left or right of the box stay untouched like in the scalar loop
+		V lo = L::splat((float)tri.minX), hi = L::splat((float)tri.maxX + 1.0f);
+		V zero = L::splat(0.0f), outside = L::splat(-1.0f);
+		V lane = L::load(offsets);
+		int32_t start = tri.minX / L::width * L::width;
+
+		for (int32_t y = first; y <= last; ++y)
+		{
+			float py = (float)y + 0.5f;
+			V c0 = L::splat(tri.b[0] * py + tri.c[0]);
+			V c1 = L::splat(tri.b[1] * py + tri.c[1]);
+			V c2 = L::splat(tri.b[2] * py + tri.c[2]);
+			V z = L::splat(tri.zy * py + tri.z0);
+			float* row = depth + y * width;
+			for (int32_t x = start; x <= tri.maxX; x += L::width)
+			{
+				V px = add(L::splat((float)x), lane);
+				V inside = min(madd(a0, px, c0), min(madd(a1, px, c1), madd(a2, px, c2)));
+				inside = select(less(px, lo), inside, outside);
+				inside = select(less(hi, px), inside, outside);
+				V d = L::load(row + x);
+				store(row + x, select(less(inside, zero), min(d, madd(zx, px, z)), d));
+			}
+		}
+	}
+#endif
+}
+
+void OcclusionBuffer::rasterizeBand(uint32_t band, bool useSimd)
+{
+	int32_t y0 = band * TILE, y1 = y0 + TILE;
+	std::fill(m_depth.begin() + y0 * m_width, m_depth.begin() + y1 * m_width, 1.0f);
+
+	for (uint32_t draw = 0; draw < m_draws.size(); ++draw)
+	{
+		for (const Triangle &tri : m_triangles[draw])
+		{
+			if (tri.maxY < y0 || tri.minY >= y1)
+				continue;
+			int32_t first = std::max(tri.minY, y0), last = std::min(tri.maxY, y1 - 1);
+#if VML_SIMD != VML_SIMD_NONE
+			if (useSimd)
+				simdSpan<floatN>(m_depth.data(), m_width, tri, first, last);
+			else
+#endif
+				scalarSpan(m_depth.data(), m_width, tri, first, last);
+		}
+	}
+
+	for (uint32_t tx = 0; tx < m_tilesX; ++tx)
+	{
+		float farthest = 0.0f;
+		for (int32_t y = y0; y < y1; ++y)
+			for (uint32_t x = tx * TILE; x < (tx + 1) * TILE; ++x)
+				farthest = std::max(farthest, m_depth[y * m_width + x]);
+		m_tileMax[band * m_tilesX + tx] = farthest;
+	}
+}
+
+/*QUERIES*/
+bool OcclusionBuffer::occluded(const vec3f &min, const vec3f &max) const
+{
+	float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+	float closest = FLT_MAX;
+	for (int i = 0; i < 8; ++i)
+	{
+		vec3f p((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+		float clip[4];
+		for (int r = 0; r < 4; ++r)
+			clip[r] = m_viewProj.m[r][0] * p.x + m_viewProj.m[r][1] * p.y + m_viewProj.m[r][2] * p.z + m_viewProj.m[r][3];
+		if (clip[2] < 0.0f)
+			return false;
+		float inv = 1.0f / clip[3];
+		float x = (clip[0] * inv * 0.5f + 0.5f) * m_width;
+		float y = (clip[1] * inv * 0.5f + 0.5f) * m_height;
+		minX = std::min(minX, x); maxX = std::max(maxX, x);
+		minY = std::min(minY, y); maxY = std::max(maxY, y);
+		closest = std::min(closest, clip[2] * inv);
+	}
+
+	//every pixel the rectangle touches
+	int32_t x0 = std::max(0, (int32_t)floorf(std::max(minX, -1.0f)));
+	int32_t x1 = std::min((int32_t)m_width - 1, (int32_t)floorf(std::min(maxX, (float)m_width)));
+	int32_t y0 = std::max(0, (int32_t)floorf(std::max(minY, -1.0f)));
+	int32_t y1 = std::min((int32_t)m_height - 1, (int32_t)floorf(std::min(maxY, (float)m_height)));
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	for (int32_t ty = y0 / TILE; ty <= y1 / (int32_t)TILE; ++ty)
+	{
+		for (int32_t tx = x0 / TILE; tx <= x1 / (int32_t)TILE; ++tx)
+		{
+			if (closest > m_tileMax[ty * m_tilesX + tx])
+				continue;
+			//part of the tile may still be in front, look at the pixels
+			int32_t px0 = std::max(x0, tx * (int32_t)TILE), px1 = std::min(x1, (tx + 1) * (int32_t)TILE - 1);
+			int32_t py0 = std::max(y0, ty * (int32_t)TILE), py1 = std::min(y1, (ty + 1) * (int32_t)TILE - 1);
+			for (int32_t y = py0; y <= py1; ++y)
+				for (int32_t x = px0; x <= px1; ++x)
+					if (closest <= m_depth[y * m_width + x])
+						return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <vec3f.h>
+#include <matrix4x4.h>
+#include <frustum.h>
+
+//triangles a mesh contributes to the occlusion buffer. a subset of the
+//surface never hides more than the whole mesh does, so the simplification
+//keeps the largest triangles and stays conservative
+struct Occluder
+{
+	std::vector<vec3f> positions;
+	std::vector<uint32_t> indices;
+
+	//stride in bytes so interleaved vertices work, as TriangleBvh::build
+	void build(const vec3f* positions, size_t stride, const uint32_t* indices, size_t indexCount,
+		uint32_t maxTriangles = 256);
+	uint32_t triangleCount() const { return (uint32_t)indices.size() / 3; }
+	bool empty() const { return indices.empty(); }
+};
+
+//low resolution depth buffer rasterized on the cpu, no graphics api involved.
+//occluders are transformed and clipped per draw, then every band of tile rows
+//is rasterized by one task of the thread pool, several pixels per instruction.
+//depth is zero to one as in vulkan, smaller is closer
+class OcclusionBuffer
+{
+public:
+	//pixels and rows in whole tiles, the width in whole simd registers
+	static const uint32_t TILE = 8;
+
+	explicit OcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+	void resize(uint32_t width, uint32_t height);
+
+	//forgets the queued occluders, proj * view of the camera
+	void begin(const Matrix4x4 &viewProj);
+	//occluder is not copied and has to live until rasterize returns
+	void add(const Occluder* occluder, const Matrix4x4 &world);
+	//every queued occluder over the thread pool, simd rows
+	void rasterize();
+	//the same triangles one pixel at a time on the calling thread, the
+	//reference rasterize() has to match exactly
+	void rasterizeReference();
+
+	//true if the box lies behind the rasterized depth wherever it covers the screen.
+	//boxes crossing the near plane are always visible
+	bool occluded(const vec3f &min, const vec3f &max) const;
+	bool occluded(const Bounds &bounds) const { return occluded(bounds.min, bounds.max); }
+
+	uint32_t width() const { return m_width; }
+	uint32_t height() const { return m_height; }
+	const float* depth() const { return m_depth.data(); }
+	//triangles left after clipping in the last rasterize
+	uint32_t triangleCount() const;
+
+private:
+	//screen space triangle, edge functions a * x + b * y + c are positive
+	//inside, depth is the plane z = zx * x + zy * y + z0
+	struct Triangle
+	{
+		float a[3], b[3], c[3];
+		float zx, zy, z0;
+		int32_t minX, maxX, minY, maxY;
+	};
+	struct Draw
+	{
+		const Occluder* occluder;
+		Matrix4x4 world;
+	};
+
+	void setup(uint32_t draw);
+	void emit(const float (*clip)[4], std::vector<Triangle> &out) const;
+	void rasterizeBand(uint32_t band, bool simd);
+
+	uint32_t m_width = 0, m_height = 0;
+	uint32_t m_tilesX = 0, m_tilesY = 0;
+	std::vector<float> m_depth;
+	//farthest depth of every tile, lets most box tests skip the pixels
+	std::vector<float> m_tileMax;
+
+	Matrix4x4 m_viewProj;
+	std::vector<Draw> m_draws;
+	//per draw, reused between frames
+	std::vector<std::vector<Triangle>> m_triangles;
+};
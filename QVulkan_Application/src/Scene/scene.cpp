@@ -2,15 +2,16 @@
 #include <vklog.h>
 #include <vkrenderer.h>
 #include <vkdevice.h>
-
-//#define VML_USE_VULKAN
-//#include <matrix4x4.h>
+#include <threadpool.h>
+#include <chrono>
 
 Scene::Scene(VkRenderer *renderer)
 	: m_renderer(renderer)
 {
 	vulkanDevice = m_renderer->m_vulkanDevice;
 	m_device = m_renderer->m_device;
+	//the model matrix every mesh used to share
+	root = graph.addNode(SceneGraph::NONE, vec3f(), vec3f(0.0f, 90.0f, 0.0f));
 }
 
 
@@ -26,7 +27,9 @@ void Scene::buildVertexBuffer()
 	
 	for (auto &mesh : meshs)
 	{
-		VkDeviceSize bufferSize = sizeof(mesh->vertices[0]) * mesh->vertices.size();
+		//positions first, the other attributes in a stream of their own
+		mesh->attributeOffset = sizeof(vec3f) * mesh->vertices.size();
+		VkDeviceSize bufferSize = mesh->attributeOffset + sizeof(VertexAttributes) * mesh->vertices.size();
 		VkBuffer stagingBuffer;
 		VkDeviceMemory stagingBufferMemory;
 
@@ -40,7 +43,16 @@ void Scene::buildVertexBuffer()
 
 		void* data;
 		vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, mesh->vertices.data(), (size_t)bufferSize);
+		vec3f* positions = (vec3f*)data;
+		VertexAttributes* attributes = (VertexAttributes*)((char*)data + mesh->attributeOffset);
+		for (size_t i = 0; i < mesh->vertices.size(); ++i)
+		{
+			const Vertex &v = mesh->vertices[i];
+			positions[i] = v.pos;
+			attributes[i].normal = v.normal;
+			attributes[i].color = v.color;
+			attributes[i].st = v.st;
+		}
 		vkUnmapMemory(m_device, stagingBufferMemory);
 
 		//create buffer for real vertex buffer object and memory
@@ -83,7 +95,10 @@ void Scene::buildIndiceBuffer()
 
 		void* data;
 		vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, mesh->indices.data(), (size_t)bufferSize);
+		//the coarser levels follow the full mesh
+		memcpy(data, mesh->indices.data(), sizeof(uint32_t) * mesh->indices.size());
+		if (!mesh->lodIndices.empty())
+			memcpy((uint32_t*)data + mesh->indices.size(), mesh->lodIndices.data(), sizeof(uint32_t) * mesh->lodIndices.size());
 		vkUnmapMemory(m_device, stagingBufferMemory);
 
 		vulkanDevice->createBuffer(
@@ -125,27 +140,160 @@ void Scene::initUniformBuffer()
 
 }
 
+void Scene::initInstanceBuffer()
+{
+	LOG_SECTION("initialize instance buffer");
+	if (instanceData)
+	{
+		vkUnmapMemory(m_device, instanceBuffer.memory);
+		destroyBuffer(instanceBuffer);
+	}
+	instanceCapacity = std::max<uint32_t>(1, (uint32_t)instances.size());
+	VkDeviceSize bufferSize = sizeof(InstanceVertex) * instanceCapacity;
+
+	vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		instanceBuffer.buffer,
+		instanceBuffer.memory,
+		bufferSize);
+	LOG_ERROR("failed to map instance buffer") <<
+		vkMapMemory(m_device, instanceBuffer.memory, 0, bufferSize, 0, (void**)&instanceData);
+	LOG << "instances : " << instanceCapacity << " buffer size : " << bufferSize << ENDL;
+}
+
+uint32_t Scene::addInstance(uint32_t mesh, uint32_t node, const vec3f &color)
+{
+	Instance instance = { mesh, node, color };
+	instances.push_back(instance);
+	return (uint32_t)instances.size() - 1;
+}
+
+bool Scene::buildInstances()
+{
+	bool grown = false;
+	if (visible.size() > instanceCapacity)
+	{
+		//the old buffer is referenced by recorded command buffers
+		initInstanceBuffer();
+		grown = true;
+	}
+
+	//counting sort by mesh and level, visible is ascending so each batch
+	//keeps instance order
+	std::vector<uint32_t> firstSlot(meshs.size() + 1, 0);
+	for (uint32_t m = 0; m < meshs.size(); ++m)
+		firstSlot[m + 1] = firstSlot[m] + meshs[m]->lodCount();
+	//instances drawn by cluster ranges get a slot each, after the batches
+	bool clustered = visibleRangeOffsets.size() == visible.size() + 1;
+	auto rangeCount = [&](uint32_t i) {
+		return clustered ? visibleRangeOffsets[i + 1] - visibleRangeOffsets[i] : 0;
+	};
+	std::vector<uint32_t> clusterSlot(visible.size(), 0);
+	uint32_t slotCount = firstSlot.back();
+	for (uint32_t i = 0; i < visible.size(); ++i)
+		if (rangeCount(i))
+			clusterSlot[i] = slotCount++;
+	auto slot = [&](uint32_t i) {
+		if (rangeCount(i))
+			return clusterSlot[i];
+		return firstSlot[instances[visible[i]].mesh] + (i < visibleLods.size() ? visibleLods[i] : 0);
+	};
+	std::vector<uint32_t> offsets(slotCount + 1, 0);
+	std::vector<float> depths(slotCount, FLT_MAX);
+	const Matrix4x4 &view = camera->view;
+	for (uint32_t i = 0; i < visible.size(); ++i)
+	{
+		offsets[slot(i) + 1]++;
+		const Bounds &b = worldBounds[visible[i]];
+		float depth = -(view[2][0] * b.center.x + view[2][1] * b.center.y + view[2][2] * b.center.z + view[2][3]) - b.radius;
+		depths[slot(i)] = std::min(depths[slot(i)], depth);
+	}
+	for (size_t m = 1; m < offsets.size(); ++m)
+		offsets[m] += offsets[m - 1];
+
+	std::vector<DrawBatch> result;
+	fullTriangles = drawnTriangles = 0;
+	for (uint32_t m = 0; m < meshs.size(); ++m)
+	{
+		for (uint32_t lod = 0; lod < meshs[m]->lodCount(); ++lod)
+		{
+			uint32_t s = firstSlot[m] + lod;
+			if (offsets[s + 1] == offsets[s]) continue;
+			DrawBatch batch = { m, lod, offsets[s], offsets[s + 1] - offsets[s], 0, 0, depths[s] };
+			result.push_back(batch);
+			fullTriangles += uint64_t(meshs[m]->indices.size() / 3) * batch.instanceCount;
+			drawnTriangles += uint64_t(meshs[m]->lod(lod).indexCount / 3) * batch.instanceCount;
+		}
+	}
+	for (uint32_t i = 0; i < visible.size(); ++i)
+	{
+		if (!rangeCount(i)) continue;
+		uint32_t m = instances[visible[i]].mesh;
+		DrawBatch batch = { m, 0, offsets[clusterSlot[i]], 1, visibleRangeOffsets[i], rangeCount(i), depths[clusterSlot[i]] };
+		result.push_back(batch);
+		fullTriangles += meshs[m]->indices.size() / 3;
+		for (uint32_t r = 0; r < batch.rangeCount; ++r)
+			drawnTriangles += visibleRanges[batch.firstRange + r].indexCount / 3;
+	}
+
+	Matrix4x4 toRoot = drawModel().invertedAffine();
+	for (uint32_t i = 0; i < visible.size(); ++i)
+	{
+		const Instance &instance = instances[visible[i]];
+		InstanceVertex &v = instanceData[offsets[slot(i)]++];
+		v.model = instanceModel(visible[i], toRoot).transposed();
+		v.color = instance.color;
+		v.pad = 0.0f;
+	}
+
+	bool changed = grown || result.size() != batches.size();
+	for (size_t i = 0; !changed && i < result.size(); ++i)
+		changed = result[i].mesh != batches[i].mesh || result[i].lod != batches[i].lod ||
+			result[i].firstInstance != batches[i].firstInstance || result[i].instanceCount != batches[i].instanceCount ||
+			result[i].firstRange != batches[i].firstRange || result[i].rangeCount != batches[i].rangeCount;
+
+	batches.swap(result);
+	return changed;
+}
+
 
 void Scene::buildInputState()
 {
-	vertexInputBinding = Vertex::getBindingDescribtion();
-	vertexInputAttrib = Vertex::getAttributeDescribtions();
+	auto vertexBinding = Vertex::getBindingDescribtions();
+	auto vertexAttrib = Vertex::getAttributeDescribtions();
+	auto instanceAttrib = InstanceVertex::getAttributeDescribtions();
+	vertexInputBinding[0] = vertexBinding[0];
+	vertexInputBinding[1] = vertexBinding[1];
+	vertexInputBinding[2] = InstanceVertex::getBindingDescribtion();
+	std::copy(vertexAttrib.begin(), vertexAttrib.end(), vertexInputAttrib.begin());
+	std::copy(instanceAttrib.begin(), instanceAttrib.end(), vertexInputAttrib.begin() + vertexAttrib.size());
 
 	vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputState.pNext = NULL;
-	vertexInputState.vertexBindingDescriptionCount = 1;
-	vertexInputState.pVertexBindingDescriptions = &vertexInputBinding;
+	vertexInputState.vertexBindingDescriptionCount = vertexInputBinding.size();
+	vertexInputState.pVertexBindingDescriptions = vertexInputBinding.data();
 	vertexInputState.vertexAttributeDescriptionCount = vertexInputAttrib.size();
 	vertexInputState.pVertexAttributeDescriptions = vertexInputAttrib.data();
 
+	//the same without binding 1
+	positionInputBinding[0] = vertexInputBinding[0];
+	positionInputBinding[1] = vertexInputBinding[2];
+	positionInputAttrib[0] = vertexAttrib[0];
+	std::copy(instanceAttrib.begin(), instanceAttrib.end(), positionInputAttrib.begin() + 1);
+
+	positionInputState = vertexInputState;
+	positionInputState.vertexBindingDescriptionCount = positionInputBinding.size();
+	positionInputState.pVertexBindingDescriptions = positionInputBinding.data();
+	positionInputState.vertexAttributeDescriptionCount = positionInputAttrib.size();
+	positionInputState.pVertexAttributeDescriptions = positionInputAttrib.data();
 }
 
 void Scene::updateUnifomrBuffers()
 {
 	camera->update();
-	Matrix4x4 modelRot;
-	modelRot.rotate(AXIS::Y, 90);
-	ubo.data.model = modelRot.transposed();
+	//vulkan draws push it per draw, see drawModel
+	ubo.data.model = graph.world(root).transposed();
 
 	float aspect = m_renderer->width / (float)m_renderer->height;
 	camera->perspective(45.0f, aspect, 0.001f, 1000.f);
@@ -164,6 +312,317 @@ void Scene::updateUnifomrBuffers()
 	vulkanDevice->copyBuffer(ubo.stagingBuffer, ubo.buffer, sizeof(ubo.data));
 }
 
+void Scene::buildBvh()
+{
+	LOG_SECTION("build bvh");
+	auto start = std::chrono::high_resolution_clock::now();
+	ThreadPool::global().parallelFor((uint32_t)meshs.size(), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			VKMesh* mesh = meshs[i].get();
+			if (mesh->vertices.empty()) continue;
+			mesh->bvh.build(&mesh->vertices[0].pos, sizeof(Vertex), mesh->indices.data(), mesh->indices.size());
+			mesh->occluder.build(&mesh->vertices[0].pos, sizeof(Vertex), mesh->indices.data(), mesh->indices.size());
+		}
+	});
+	auto end = std::chrono::high_resolution_clock::now();
+
+	for (auto &mesh : meshs)
+		LOG << "triangles : " << mesh->bvh.triangleCount() << " nodes : " << mesh->bvh.bvh.nodes.size()
+			<< " depth : " << mesh->bvh.bvh.depth() << ENDL;
+	LOG << "triangle bvhs : " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << ENDL;
+
+	bvh.clear();
+	updateBounds();
+}
+
+bool Scene::updateBounds()
+{
+	const std::vector<uint32_t> &changed = graph.update();
+	bool rebuild = bvh.empty() || worldBounds.size() != instances.size();
+	//readers take it every frame, a frame without changes moves nothing
+	moved.clear();
+	if (changed.empty() && !rebuild)
+		return false;
+
+	//only instances on a changed node move
+	std::vector<uint8_t> nodeMoved;
+	if (!rebuild)
+	{
+		nodeMoved.resize(graph.size(), 0);
+		for (uint32_t node : changed)
+			nodeMoved[node] = 1;
+	}
+	worldBounds.resize(instances.size());
+	for (uint32_t i = 0; i < instances.size(); ++i)
+	{
+		const Instance &instance = instances[i];
+		if (rebuild || nodeMoved[instance.node])
+		{
+			worldBounds[i] = meshs[instance.mesh]->bounds.transformed(graph.world(instance.node));
+			moved.push_back(i);
+		}
+	}
+
+	if (rebuild)
+		bvh.build(worldBounds, 2);
+	else
+		bvh.refit(worldBounds);
+	return true;
+}
+
+void Scene::updateFrustum()
+{
+	frustum.extract<vml::VulkanConvention>(camera->proj * camera->view);
+}
+
+bool Scene::cull()
+{
+	bool transformed = updateBounds();
+	updateFrustum();
+	bvh.cull(frustum, worldBounds, cullResult);
+	if (occlusionCulling)
+		cullOccluded();
+	//draw in instances order, and compare with last frame
+	std::sort(cullResult.begin(), cullResult.end());
+	float scale = lodScale();
+	cullLods.resize(cullResult.size());
+	for (size_t i = 0; i < cullResult.size(); ++i)
+		cullLods[i] = (uint8_t)selectLod(cullResult[i], scale);
+	cullClusters();
+	if (cullResult == visible && cullLods == visibleLods && cullRangeOffsets == visibleRangeOffsets &&
+		cullRanges == visibleRanges && !transformed)
+		return false;
+	//the same batches can still draw other ranges
+	bool rangesChanged = cullRanges != visibleRanges;
+	visible.swap(cullResult);
+	visibleLods.swap(cullLods);
+	visibleRanges.swap(cullRanges);
+	visibleRangeOffsets.swap(cullRangeOffsets);
+	return buildInstances() || rangesChanged;
+}
+
+void Scene::buildClusters()
+{
+	LOG_SECTION("build meshlets");
+	auto start = std::chrono::high_resolution_clock::now();
+	ThreadPool::global().parallelFor((uint32_t)meshs.size(), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			VKMesh* mesh = meshs[i].get();
+			if (mesh->vertices.empty()) continue;
+			mesh->meshlets = vml::buildMeshlets(mesh->indices.data(), mesh->indices.size(),
+				&mesh->vertices[0].pos, mesh->vertices.size(), sizeof(Vertex));
+		}
+	});
+	auto end = std::chrono::high_resolution_clock::now();
+
+	for (auto &mesh : meshs)
+	{
+		size_t count = std::max<size_t>(mesh->meshlets.size(), 1);
+		uint32_t vertexCount = 0;
+		for (auto &meshlet : mesh->meshlets)
+			vertexCount += meshlet.vertexCount;
+		LOG << "meshlets : " << mesh->meshlets.size() << " vertices : " << vertexCount / count
+			<< " triangles : " << mesh->indices.size() / 3 / count << " each" << ENDL;
+	}
+	LOG << "meshlets : " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << ENDL;
+}
+
+void Scene::cullClusters()
+{
+	cullRanges.clear();
+	cullRangeOffsets.assign(1, 0);
+	clusterTested = clusterCulled = 0;
+	if (!clusterCulling)
+	{
+		cullRangeOffsets.clear();
+		return;
+	}
+	//camera position, the view is rigid
+	Matrix4x4 cameraWorld = camera->view.invertedAffine();
+	vec3f eye(cameraWorld[0][3], cameraWorld[1][3], cameraWorld[2][3]);
+
+	for (size_t i = 0; i < cullResult.size(); ++i)
+	{
+		const Instance &instance = instances[cullResult[i]];
+		const VKMesh* mesh = meshs[instance.mesh].get();
+		size_t first = cullRanges.size();
+		if (cullLods[i] == 0 && mesh->meshlets.size() > 1)
+		{
+			const Matrix4x4 &world = graph.world(instance.node);
+			vec3f localEye = world.invertedAffine() * eye;
+			//a mirroring transform turns the winding around
+			float det = world[0][0] * (world[1][1] * world[2][2] - world[1][2] * world[2][1]) -
+				world[0][1] * (world[1][0] * world[2][2] - world[1][2] * world[2][0]) +
+				world[0][2] * (world[1][0] * world[2][1] - world[1][1] * world[2][0]);
+			float scale = instanceScale(cullResult[i]);
+			//the whole instance is inside, only the cones matter
+			const Bounds &bounds = worldBounds[cullResult[i]];
+			bool inside = frustum.classify(bounds.min, bounds.max) == Containment::INSIDE;
+
+			uint32_t culled = 0;
+			for (const Meshlet &meshlet : mesh->meshlets)
+			{
+				bool drop = (det > 0.0f && vml::backFacing(meshlet, localEye)) ||
+					(!inside && !frustum.contains(world * meshlet.center, meshlet.radius * scale));
+				if (drop)
+				{
+					culled += meshlet.indexCount;
+					continue;
+				}
+				//neighbouring meshlets merge into one draw
+				if (cullRanges.size() > first && cullRanges.back().firstIndex + cullRanges.back().indexCount == meshlet.firstIndex)
+					cullRanges.back().indexCount += meshlet.indexCount;
+				else
+				{
+					IndexRange range = { meshlet.firstIndex, meshlet.indexCount };
+					cullRanges.push_back(range);
+				}
+			}
+			clusterTested += (uint32_t)mesh->meshlets.size();
+			//not worth a draw of its own
+			if (culled < clusterMinSaving * mesh->indices.size())
+				cullRanges.resize(first);
+			else
+				clusterCulled += uint32_t(culled / 3);
+		}
+		cullRangeOffsets.push_back((uint32_t)cullRanges.size());
+	}
+}
+
+void Scene::buildLods()
+{
+	LOG_SECTION("build levels of detail");
+	auto start = std::chrono::high_resolution_clock::now();
+	//normal, color and texture coordinates follow pos in Vertex
+	static const float weights[8] = { 1.0f, 1.0f, 1.0f, 0.5f, 0.5f, 0.5f, 1.0f, 1.0f };
+	ThreadPool::global().parallelFor((uint32_t)meshs.size(), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			VKMesh* mesh = meshs[i].get();
+			if (mesh->vertices.empty()) continue;
+			SimplifyAttributes attributes;
+			attributes.data = &mesh->vertices[0].normal.x;
+			attributes.stride = sizeof(Vertex);
+			attributes.count = 8;
+			attributes.weights = weights;
+			mesh->lods = vml::buildLods(mesh->indices.data(), mesh->indices.size(), &mesh->vertices[0].pos,
+				mesh->vertices.size(), sizeof(Vertex), &attributes, 5, mesh->lodIndices);
+		}
+	});
+	auto end = std::chrono::high_resolution_clock::now();
+
+	for (auto &mesh : meshs)
+	{
+		LOG << "levels :";
+		for (auto &lod : mesh->lods)
+			LOG << " " << lod.indexCount / 3;
+		LOG << " triangles, coarsest error " << (mesh->lods.empty() ? 0.0f : mesh->lods.back().error) << ENDL;
+	}
+	LOG << "lod chains : " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << ENDL;
+}
+
+float Scene::lodScale() const
+{
+	//proj[1][1] is 1 / tan(fovy / 2), half the viewport height spans that at depth 1.
+	//pixels of the render target, with dynamic resolution coarser levels do
+	return fabsf(camera->proj.m[1][1]) * m_renderer->renderExtent().height * 0.5f / std::max(lodPixelError, 1e-3f);
+}
+
+float Scene::instanceScale(uint32_t instance) const
+{
+	float radius = meshs[instances[instance].mesh]->bounds.radius;
+	return radius > 0.0f ? worldBounds[instance].radius / radius : 1.0f;
+}
+
+uint32_t Scene::selectLod(uint32_t instance, float scale) const
+{
+	const VKMesh* mesh = meshs[instances[instance].mesh].get();
+	if (mesh->lods.size() < 2)
+		return 0;
+	//view depth of the closest point of the sphere
+	const Bounds &b = worldBounds[instance];
+	const Matrix4x4 &view = camera->view;
+	float depth = -(view[2][0] * b.center.x + view[2][1] * b.center.y + view[2][2] * b.center.z + view[2][3]) - b.radius;
+	float pixels = scale * instanceScale(instance) / std::max(depth, camera->m_znear);
+	uint32_t level = 0;
+	while (level + 1 < mesh->lods.size() && mesh->lods[level + 1].error * pixels <= 1.0f)
+		++level;
+	return level;
+}
+
+void Scene::cullOccluded()
+{
+	//big and close first, radius over view distance
+	const Matrix4x4 &view = camera->view;
+	std::vector<std::pair<float, uint32_t>> ranked;
+	ranked.reserve(cullResult.size());
+	for (uint32_t i : cullResult)
+	{
+		const Bounds &b = worldBounds[i];
+		if (meshs[instances[i].mesh]->occluder.empty()) continue;
+		float depth = -(view[2][0] * b.center.x + view[2][1] * b.center.y + view[2][2] * b.center.z + view[2][3]);
+		ranked.push_back(std::make_pair(-b.radius / std::max(depth, camera->m_znear), i));
+	}
+	occludedCount = 0;
+	if (ranked.empty())
+		return;
+	size_t count = std::min<size_t>(ranked.size(), maxOccluders);
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+
+	occlusionBuffer.begin(camera->proj * camera->view);
+	for (size_t k = 0; k < count; ++k)
+	{
+		const Instance &instance = instances[ranked[k].second];
+		occlusionBuffer.add(&meshs[instance.mesh]->occluder, graph.world(instance.node));
+	}
+	occlusionBuffer.rasterize();
+
+	size_t kept = 0;
+	for (uint32_t i : cullResult)
+		if (!occlusionBuffer.occluded(worldBounds[i]))
+			cullResult[kept++] = i;
+	occludedCount = uint32_t(cullResult.size() - kept);
+	cullResult.resize(kept);
+}
+
+bool Scene::pick(float x, float y, RayHit &hit) const
+{
+	//pixel to vulkan ndc (y down, depth 0 to 1), then back through proj * view
+	float ndcX = 2.0f * x / m_renderer->width - 1.0f;
+	float ndcY = 2.0f * y / m_renderer->height - 1.0f;
+	Matrix4x4 inv = (camera->proj * camera->view).inverted();
+	auto unproject = [&](float depth) {
+		float p[4];
+		for (int i = 0; i < 4; ++i)
+			p[i] = inv[i][0] * ndcX + inv[i][1] * ndcY + inv[i][2] * depth + inv[i][3];
+		return vec3f(p[0], p[1], p[2]) / p[3];
+	};
+	vec3f origin = unproject(0.0f);
+	Ray ray(origin, unproject(1.0f) - origin);
+
+	hit = RayHit();
+	return bvh.intersect(ray, [&](uint32_t instance, Ray &worldRay)
+	{
+		//object space ray with an unnormalized direction keeps t comparable
+		const Instance &placed = instances[instance];
+		Matrix4x4 M = graph.world(placed.node).invertedAffine();
+		vec3f o = M * worldRay.origin;
+		Ray local(o, M * (worldRay.origin + worldRay.direction) - o, worldRay.tmax);
+		RayHit localHit;
+		if (!meshs[placed.mesh]->bvh.intersect(local, localHit))
+			return false;
+		worldRay.tmax = localHit.t;
+		hit = localHit;
+		hit.instance = instance;
+		return true;
+	});
+}
+
 void Scene::releaseBuffers()
 {
 	/*VBO IBO*/
@@ -178,4 +637,11 @@ void Scene::releaseBuffers()
 	/*UBO*/
 	destroyBuffer(ubo.stagingBuffer, ubo.stagingMemory);
 	destroyBuffer(ubo.buffer, ubo.memory);
+	/*INSTANCES*/
+	if (instanceData)
+	{
+		vkUnmapMemory(m_device, instanceBuffer.memory);
+		destroyBuffer(instanceBuffer);
+	}
+	instanceData = NULL;
 }
\ No newline at end of file
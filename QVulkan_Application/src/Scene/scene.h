@@ -1,6 +1,5 @@
 #pragma once
 
-#define VML_USE_VULKAN
 #include <matrix4x4.h>
 
 #include <vertex.h>
@@ -10,8 +9,33 @@
 #include <ubo.h>
 #include <camera.h>
 #include <mesh.h>
+#include <bvh.h>
+#include <scenegraph.h>
 
 
+//one placed copy of a mesh, drawn from the instance stream
+struct Instance
+{
+	uint32_t mesh;
+	uint32_t node;
+	vec3f color;
+};
+
+//visible instances of one mesh, contiguous in the instance stream.
+//the pipeline is owned by the mesh, so this is one draw per mesh and material.
+//a batch with rangeCount draws one instance, only its visible clusters
+struct DrawBatch
+{
+	uint32_t mesh;
+	uint32_t lod;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	uint32_t firstRange;
+	uint32_t rangeCount;
+	//view depth of the closest instance, orders draws of the same state
+	float depth;
+};
+
 class VkRenderer;
 class VulkanDevice;
 class Scene
@@ -30,9 +54,118 @@ public:
 	UBO ubo;
 	camera_ptr camera;
 
+	/*TRANSFORMS*/
+	//addElement puts every mesh below root with one instance of its own
+	SceneGraph graph;
+	uint32_t root;
+	std::vector<Instance> instances;
+
+	uint32_t addInstance(uint32_t mesh, uint32_t node, const vec3f &color = vec3f(1.0f));
+	//pushed per draw as DrawConstants::model, the instance streams hold
+	//transforms relative to it so moving root rewrites no instance
+	Matrix4x4 drawModel() const { return graph.world(root); }
+	//world of an instance's node relative to drawModel, toRoot is its inverse
+	Matrix4x4 instanceModel(uint32_t instance, const Matrix4x4 &toRoot) const
+	{
+		return toRoot * graph.world(instances[instance].node);
+	}
+
+	/*INSTANCE STREAM*/
+	//visible instances grouped by mesh, rewritten only when the visible set
+	//or a transform changed. persistently mapped, a single copy is enough
+	//because VkRenderer::end waits for the queue
+	Buffer instanceBuffer = {};
+	InstanceVertex* instanceData = NULL;
+	uint32_t instanceCapacity = 0;
+	std::vector<DrawBatch> batches;
+
+	//room for every instance, grows again if instances are added later
+	void initInstanceBuffer();
+	//true if the batches changed and command buffers have to be recorded again
+	bool buildInstances();
+
+	/*SPATIAL*/
+	//per instance, the instance hierarchy is built over worldBounds
+	std::vector<Bounds> worldBounds;
+	Bvh bvh;
+	//instances whose world bounds the last updateBounds rewrote
+	std::vector<uint32_t> moved;
+	//indices into instances that touch the camera frustum, ascending
+	std::vector<uint32_t> visible;
+	std::vector<uint32_t> cullResult;
+	Frustum frustum;
+
+	/*LEVELS OF DETAIL*/
+	//the coarsest level whose error covers at most this many pixels is drawn
+	float lodPixelError = 1.0f;
+	//level per entry of visible
+	std::vector<uint8_t> visibleLods;
+	std::vector<uint8_t> cullLods;
+	//triangles of the visible instances at full detail and as drawn
+	uint64_t fullTriangles = 0;
+	uint64_t drawnTriangles = 0;
+
+	//simplified levels of all meshs in parallel, before buildIndiceBuffer
+	void buildLods();
+	//projected pixels of one object unit at view depth 1, over lodPixelError
+	float lodScale() const;
+	//world size of an instance relative to its mesh
+	float instanceScale(uint32_t instance) const;
+	uint32_t selectLod(uint32_t instance, float lodScale) const;
+
+	/*CLUSTERS*/
+	//meshlets of a visible instance at level 0 outside the frustum or facing
+	//away are skipped, the rest are merged into index ranges. only kept when
+	//at least clusterMinSaving of its triangles go, otherwise the instance
+	//stays in its batch
+	bool clusterCulling = true;
+	float clusterMinSaving = 0.25f;
+	//ranges of visible entry i are [visibleRangeOffsets[i], visibleRangeOffsets[i + 1])
+	std::vector<IndexRange> visibleRanges;
+	std::vector<uint32_t> visibleRangeOffsets;
+	std::vector<IndexRange> cullRanges;
+	std::vector<uint32_t> cullRangeOffsets;
+	//meshlets tested and dropped in the last cull
+	uint32_t clusterTested = 0;
+	uint32_t clusterCulled = 0;
+
+	//meshlets of all meshs in parallel, reorders indices so before buildLods and buildBvh
+	void buildClusters();
+	//ranges of cullResult with cullLods chosen
+	void cullClusters();
+
+	/*OCCLUSION*/
+	//the closest large instances in the frustum are rasterized on the cpu,
+	//visible instances behind them are dropped before the instance stream
+	bool occlusionCulling = true;
+	uint32_t maxOccluders = 24;
+	OcclusionBuffer occlusionBuffer;
+	//instances hidden in the last cull
+	uint32_t occludedCount = 0;
+
+	//triangle hierarchies of all meshs in parallel, then the instance tree
+	void buildBvh();
+	//world bounds of the instances whose node changed and a refit, true if
+	//any transform changed
+	bool updateBounds();
+	//frustum from the camera's proj * view
+	void updateFrustum();
+	//hierarchical cull against proj * view and the occlusion buffer, a level
+	//per visible instance and the instance stream. true if the draw batches changed
+	bool cull();
+	//rasterizes the best occluders of cullResult and removes what they hide
+	void cullOccluded();
+	//closest triangle under a window pixel, hit.instance indexes instances
+	bool pick(float x, float y, RayHit &hit) const;
+
 	VkPipelineVertexInputStateCreateInfo vertexInputState = {};
-	std::array<VkVertexInputAttributeDescription,4> vertexInputAttrib;
-	VkVertexInputBindingDescription vertexInputBinding;
+	//binding 0 positions, binding 1 the other vertex attributes, binding 2 per instance
+	std::array<VkVertexInputAttributeDescription,9> vertexInputAttrib;
+	std::array<VkVertexInputBindingDescription,3> vertexInputBinding;
+	//positions and instances only, for passes that need no shading inputs
+	VkPipelineVertexInputStateCreateInfo positionInputState = {};
+	std::array<VkVertexInputAttributeDescription,6> positionInputAttrib;
+	std::array<VkVertexInputBindingDescription,2> positionInputBinding;
 
 	void buildVertexBuffer();
 	void buildIndiceBuffer();
@@ -57,6 +190,7 @@ public:
 inline void Scene::addElement(vkmesh_ptr mesh)
 {
 	meshs.push_back(mesh);
+	addInstance((uint32_t)meshs.size() - 1, graph.addNode(root));
 }
 
 inline void Scene::addElement(shader_ptr shader)
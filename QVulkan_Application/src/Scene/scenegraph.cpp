@@ -0,0 +1,142 @@
+#include "scenegraph.h"
+#include <threadpool.h>
+#include <vklog.h>
+
+const uint32_t SceneGraph::NONE;
+
+uint32_t SceneGraph::addNode(uint32_t parentNode, const vec3f &t, const vec3f &r, const vec3f &s)
+{
+	uint32_t node = (uint32_t)size();
+	if (parentNode != NONE && parentNode >= node)
+		LOG_ASSERT("scene graph parent has to be added before its children");
+
+	translation.push_back(t);
+	rotation.push_back(r);
+	scale.push_back(s);
+	parent.push_back(parentNode);
+	depth.push_back(parentNode == NONE ? 0 : depth[parentNode] + 1);
+
+	m_world.push_back(Matrix4x4());
+	m_firstChild.push_back(NONE);
+	m_nextSibling.push_back(NONE);
+	if (parentNode != NONE) {
+		m_nextSibling[node] = m_firstChild[parentNode];
+		m_firstChild[parentNode] = node;
+	}
+
+	m_dirty.push_back(0);
+	m_visited.push_back(0);
+	markDirty(node);
+	return node;
+}
+
+void SceneGraph::clear()
+{
+	translation.clear();
+	rotation.clear();
+	scale.clear();
+	parent.clear();
+	depth.clear();
+	m_world.clear();
+	m_firstChild.clear();
+	m_nextSibling.clear();
+	m_dirty.clear();
+	m_dirtyNodes.clear();
+	m_visited.clear();
+	m_changed.clear();
+}
+
+void SceneGraph::markDirty(uint32_t node)
+{
+	if (m_dirty[node]) return;
+	m_dirty[node] = 1;
+	m_dirtyNodes.push_back(node);
+}
+
+void SceneGraph::setTranslation(uint32_t node, const vec3f &t)
+{
+	translation[node] = t;
+	markDirty(node);
+}
+
+void SceneGraph::setRotation(uint32_t node, const vec3f &degrees)
+{
+	rotation[node] = degrees;
+	markDirty(node);
+}
+
+void SceneGraph::setScale(uint32_t node, const vec3f &s)
+{
+	scale[node] = s;
+	markDirty(node);
+}
+
+Matrix4x4 SceneGraph::local(uint32_t node) const
+{
+	Matrix4x4 M;
+	M.translate(translation[node]);
+	M.rotate(AXIS::Y, rotation[node].y);
+	M.rotate(AXIS::X, rotation[node].x);
+	M.rotate(AXIS::Z, rotation[node].z);
+	M.scale(scale[node]);
+	return M;
+}
+
+const std::vector<uint32_t>& SceneGraph::update()
+{
+	m_changed.clear();
+	if (m_dirtyNodes.empty())
+		return m_changed;
+
+	//gather every node below a dirty one into its depth level
+	++m_updateCount;
+	for (auto &level : m_levels)
+		level.clear();
+	std::vector<uint32_t> stack;
+	for (uint32_t root : m_dirtyNodes)
+	{
+		m_dirty[root] = 0;
+		if (m_visited[root] == m_updateCount) continue;
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			uint32_t node = stack.back();
+			stack.pop_back();
+			//reached through an earlier dirty ancestor
+			if (m_visited[node] == m_updateCount) continue;
+			m_visited[node] = m_updateCount;
+
+			if (m_levels.size() <= depth[node])
+				m_levels.resize(depth[node] + 1);
+			m_levels[depth[node]].push_back(node);
+			for (uint32_t child = m_firstChild[node]; child != NONE; child = m_nextSibling[child])
+				stack.push_back(child);
+		}
+	}
+	m_dirtyNodes.clear();
+
+	//a level only reads the one above it, so its nodes are independent
+	for (auto &level : m_levels)
+	{
+		if (level.empty()) continue;
+		ThreadPool::global().parallelFor((uint32_t)level.size(), 256, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				uint32_t node = level[i];
+				m_world[node] = parent[node] == NONE ? local(node) : m_world[parent[node]] * local(node);
+			}
+		});
+		m_changed.insert(m_changed.end(), level.begin(), level.end());
+	}
+	return m_changed;
+}
+
+void SceneGraph::updateAll()
+{
+	for (uint32_t node = 0; node < size(); ++node)
+		m_world[node] = parent[node] == NONE ? local(node) : m_world[parent[node]] * local(node);
+	for (uint32_t node : m_dirtyNodes)
+		m_dirty[node] = 0;
+	m_dirtyNodes.clear();
+}
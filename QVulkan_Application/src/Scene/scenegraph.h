@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <vec3f.h>
+#include <matrix4x4.h>
+
+//transform hierarchy, a node handle is its index and parents always have a
+//smaller index than their children. local transforms are stored per component,
+//world matrices are only recomputed below nodes that changed
+class SceneGraph
+{
+public:
+	static const uint32_t NONE = UINT32_MAX;
+
+	//parent has to exist already, which keeps the parent first order
+	uint32_t addNode(uint32_t parent = NONE, const vec3f &translation = vec3f(),
+		const vec3f &rotation = vec3f(), const vec3f &scale = vec3f(1.0f));
+	size_t size() const { return parent.size(); }
+	void clear();
+
+	void setTranslation(uint32_t node, const vec3f &t);
+	//degrees, applied as yaw (y), pitch (x), roll (z)
+	void setRotation(uint32_t node, const vec3f &degrees);
+	void setScale(uint32_t node, const vec3f &s);
+
+	//dirty subtrees level by level, every level split in chunks over the
+	//thread pool. returns the nodes whose world matrix changed, parents first.
+	//cost follows the changed subtrees, not the graph size
+	const std::vector<uint32_t>& update();
+	//every world matrix from scratch, the reference for update()
+	void updateAll();
+
+	const Matrix4x4& world(uint32_t node) const { return m_world[node]; }
+	Matrix4x4 local(uint32_t node) const;
+
+	/*LOCAL TRANSFORMS*/
+	std::vector<vec3f> translation;
+	std::vector<vec3f> rotation;
+	std::vector<vec3f> scale;
+	std::vector<uint32_t> parent;
+	std::vector<uint32_t> depth;
+
+private:
+	void markDirty(uint32_t node);
+
+	std::vector<Matrix4x4> m_world;
+	std::vector<uint32_t> m_firstChild;
+	std::vector<uint32_t> m_nextSibling;
+
+	std::vector<uint8_t> m_dirty;
+	std::vector<uint32_t> m_dirtyNodes;
+	//last update that reached a node, overlapping dirty subtrees are walked once
+	std::vector<uint32_t> m_visited;
+	uint32_t m_updateCount = 0;
+
+	std::vector<std::vector<uint32_t>> m_levels;
+	std::vector<uint32_t> m_changed;
+};
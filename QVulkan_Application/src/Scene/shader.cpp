@@ -31,6 +31,15 @@ void Shader::buildGLSL(const std::string &vert, const std::string &frag)
 	loadGLSL(frag, VK_SHADER_STAGE_FRAGMENT_BIT);
 }
 
+void Shader::buildCompute(const std::string &comp)
+{
+	if (shaderModules.size() != NULL) {
+		LOG_WARN("shader has module already refresh all modules");
+		release();
+	}
+	loadGLSL(comp, VK_SHADER_STAGE_COMPUTE_BIT);
+}
+
 void Shader::loadSPV(const std::string &filename, VkShaderStageFlagBits stage)
 {
 	std::ifstream file(filename, std::ios::binary | std::ios::in | std::ios::ate);
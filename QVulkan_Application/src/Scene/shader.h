@@ -18,6 +18,8 @@ public:
 
 	void buildSPV(const std::string &vert, const std::string &frag);
 	void buildGLSL(const std::string &vert, const std::string &frag);
+	//single compute stage, shaderStage[0]
+	void buildCompute(const std::string &comp);
 
 
 private:
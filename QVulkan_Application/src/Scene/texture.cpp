@@ -2,7 +2,6 @@
 #include "texture.h"
 #include <vklog.h>
 #include <vkdevice.h>
-#include <qimage.h>
 
 Texture::Texture(VulkanDevice* vulkandevice)
 	: vulkanDevice(vulkandevice)
@@ -14,6 +13,8 @@ Texture::Texture(VulkanDevice* vulkandevice)
 
 Texture::~Texture()
 {
+	if (m_mapped)
+		vkUnmapMemory(m_device, memory);
 	vkDestroyImageView(m_device, view, nullptr);
 	vkDestroyImage(m_device, image, nullptr);
 	vkDestroySampler(m_device, sampler, nullptr);
@@ -22,26 +23,15 @@ Texture::~Texture()
 
 
 
-//#include <qopengltexture.h>
-#include <mipmap.h>
+#include <texturefile.h>
+#include <vkstaging.h>
+#include <threadpool.h>
+#include <imagedecoder.h>
+#include <future>
 
 void Texture::loadTexture(const std::string &filename, VkFormat format, bool forceLinearTiling)
 {
-	QImage file(filename.c_str());
-	QImage img = file.convertToFormat(QImage::Format_RGBA8888);
-	//QImage img = file.convertToFormat(QImage::Format_RGB888);
-	
-	/*auto* pixels = img.bits();*/
-	LOG_SECTION("create mipmaps ..");
-	Mipmap mip(file.width(), file.height(), file.constBits(),3);
-	LOG << "max MipMaps : " << mip.pyramids.size() << ENDL;
-	auto* buffer = mip.mapBuffer(0);
-	auto* pixels = buffer->data();
-
-	VkDeviceSize imageSize = buffer->width * buffer->height * 4;
-	
-	width = buffer->width;
-	height = buffer->height;
+	m_filename = filename;
 	mipLevels = 1;
 
 	VkFormatProperties formatProperties;
@@ -53,133 +43,333 @@ void Texture::loadTexture(const std::string &filename, VkFormat format, bool for
 		useStaging = !(formatProperties.linearTilingFeatures & 
 			VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
-	VkMemoryAllocateInfo allocateInfo{};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocateInfo.pNext = NULL;
-	allocateInfo.allocationSize = 0;
-	allocateInfo.memoryTypeIndex = 0;
+	if (useStaging)
+	{
+		std::vector<Texture*> textures = { this };
+		std::vector<std::string> filenames = { filename };
+		loadTextures(textures, filenames);
+		if (m_format != format)
+			LOG_WARN("cooked texture format overrides requested format");
+	}
+	else
+	{
+		image_ptr img = imageDecoder::decode(filename);
+		if (!img)
+			LOG_ASSERT("failed to load texture : " + filename);
+		if (format != VK_FORMAT_R8G8B8A8_UNORM)
+			LOG_WARN("linear textures are decoded as R8G8B8A8_UNORM");
+
+		buildDynamic(img->width, img->height, VK_FORMAT_R8G8B8A8_UNORM);
+		writeTexels(img->pixels, size_t(img->width) * 4);
+	}
+}
+
+void Texture::buildDynamic(uint32_t width, uint32_t height, VkFormat format)
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProperties);
+	if (!(formatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+		LOG_ASSERT("format can not be sampled with linear tiling");
+
+	this->width = width;
+	this->height = height;
+	m_format = format;
+	mipLevels = 1;
+	layerCount = 1;
+
+	VkImageCreateInfo imageCreateInfo{};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = m_format;
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_LINEAR;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+	imageCreateInfo.extent = { width, height, 1 };
+	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	LOG_ERROR("failed to create linear image") <<
+	vkCreateImage(m_device, &imageCreateInfo, nullptr, &image);
 
 	VkMemoryRequirements memReqs{};
+	vkGetImageMemoryRequirements(m_device, image, &memReqs);
+
+	//coherent so host writes need no flush, the next submit makes them visible
+	VkMemoryAllocateInfo allocateInfo = vkInitializer::memoryAllocateInfo();
+	allocateInfo.allocationSize = memReqs.size;
+	allocateInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	m_memorySize = memReqs.size;
+	m_memoryType = allocateInfo.memoryTypeIndex;
+
+	LOG_ERROR("failed to create linear image memory") <<
+	vkAllocateMemory(m_device, &allocateInfo, nullptr, &memory);
+	vkBindImageMemory(m_device, image, memory, 0);
+
+	//the driver may pad rows, always address texels through the row pitch
+	VkImageSubresource subresource{};
+	subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	vkGetImageSubresourceLayout(m_device, image, &subresource, &m_subresourceLayout);
+
+	void* data = nullptr;
+	LOG_ERROR("failed to map linear image") <<
+	vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+	m_mapped = (uint8_t*)data;
+
+	//GENERAL keeps the image sampleable while the host keeps writing to it
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.levelCount = 1;
+	range.layerCount = 1;
+
+	VkCommandBuffer cmdBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	setImageLayout(cmdBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_GENERAL, range);
+	vulkanDevice->flushCommandBuffer(cmdBuffer, vulkanDevice->m_queue, true);
+	imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	buildSampler();
+	buildView(VK_IMAGE_VIEW_TYPE_2D);
+	LOG << "dynamic texture : " << width << "x" << height << " row pitch "
+		<< m_subresourceLayout.rowPitch << ENDL;
+}
 
-	if (useStaging)
+void Texture::writeTexels(const void* src, size_t srcRowPitch)
+{
+	assert(isDynamic());
+	const uint8_t* source = (const uint8_t*)src;
+	size_t rowSize = size_t(width) * m_texelSize;
+	ThreadPool::global().parallelFor(height, 64, [&](uint32_t begin, uint32_t end)
 	{
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		//uint32_t zulsize = sizeof(pixels);
-
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = imageSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		LOG_ERROR("failed to create stagin buffer") <<
-		vkCreateBuffer(m_device, &bufferCreateInfo, nullptr, &stagingBuffer);
-
-		vkGetBufferMemoryRequirements(m_device, stagingBuffer, &memReqs);
-		allocateInfo.allocationSize = memReqs.size;
-		allocateInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, 
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-
-		vkAllocateMemory(m_device, &allocateInfo, nullptr, &stagingMemory);
-		vkBindBufferMemory(m_device, stagingBuffer, stagingMemory, 0);
-
-		uint8_t* data;
-		//get available host memory address and  reservation memory size type of flag
-		LOG_ERROR("failed to get host memory address") <<
-		vkMapMemory(m_device, stagingMemory, 0, memReqs.size, 0, (void**)&data);
-		//memcpy(data, pixels, (size_t)imageSize);
-		memcpy(data, pixels, (size_t)imageSize);
-		vkUnmapMemory(m_device, stagingMemory);
-
-		std::vector<VkBufferImageCopy> bufferCopyRegions;
-		uint32_t offset = 0;
-
-		for (uint32_t i = 0; i < mipLevels; ++i)
+		for (uint32_t y = begin; y < end; ++y)
+			memcpy(mappedRow(y), source + y * srcRowPitch, rowSize);
+	});
+}
+
+void Texture::loadCubemap(const std::vector<std::string> &faces)
+{
+	assert(faces.size() == 6);
+	TextureRequest request = { this, faces, VK_IMAGE_VIEW_TYPE_CUBE };
+	loadTextures(std::vector<TextureRequest>{ request });
+}
+
+void Texture::loadTextures(
+	const std::vector<Texture*> &textures,
+	const std::vector<std::string> &filenames)
+{
+	assert(textures.size() == filenames.size());
+	std::vector<TextureRequest> requests;
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		TextureRequest request = { textures[i], { filenames[i] }, VK_IMAGE_VIEW_TYPE_2D };
+		requests.push_back(request);
+	}
+	loadTextures(requests);
+}
+
+void Texture::loadTextures(const std::vector<TextureRequest> &requests)
+{
+	if (requests.empty()) return;
+
+	LOG_SECTION("load textures");
+	VulkanDevice* vulkanDevice = requests[0].texture->vulkanDevice;
+	ThreadPool &pool = ThreadPool::global();
+
+	//flatten every layer of every request, each one is an independent job
+	std::vector<std::string> sources;
+	for (auto &request : requests)
+		sources.insert(sources.end(), request.layers.begin(), request.layers.end());
+	size_t count = sources.size();
+
+	//decode and mip filter stale sources, map cooked files, all on the pool
+	std::vector<std::unique_ptr<TextureFile>> files(count);
+	std::vector<std::future<bool>> prepared;
+	for (size_t i = 0; i < count; ++i)
+	{
+		files[i] = std::unique_ptr<TextureFile>(new TextureFile);
+		TextureFile* file = files[i].get();
+		std::string filename = sources[i];
+		prepared.push_back(pool.enqueue([file, filename] {
+			return textureCooker::prepare(filename, *file);
+		}));
+	}
+
+	std::vector<VkDeviceSize> offsets(count);
+	VkDeviceSize totalSize = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!prepared[i].get())
+			LOG_ASSERT("failed to load texture : " + sources[i]);
+
+		const TextureFileHeader &header = files[i]->header();
+		if (header.compressed && !vulkanDevice->m_features.textureCompressionBC)
+			LOG_ASSERT("device does not support BC compressed textures");
+
+		offsets[i] = totalSize;
+		totalSize += (header.payloadSize + 15) & ~VkDeviceSize(15);
+	}
+
+	//workers copy the mapped payloads straight into the mapped staging memory
+	VulkanStagingBuffer* staging = vulkanDevice->stagingBuffer();
+	uint8_t* mapped = staging->reserve(totalSize);
+	pool.parallelFor((uint32_t)count, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			memcpy(mapped + offsets[i], files[i]->payload(), (size_t)files[i]->header().payloadSize);
+	});
+
+	//every image in one command buffer and one submit
+	VkCommandBuffer cmdBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	size_t first = 0;
+	for (auto &request : requests)
+	{
+		Texture* texture = request.texture;
+		const TextureFileHeader &header = files[first]->header();
+		texture->m_filename = request.layers[0];
+		texture->m_layers = request.layers;
+		texture->m_viewType = request.viewType;
+		texture->m_format = (VkFormat)header.format;
+		texture->width = header.width;
+		texture->height = header.height;
+		texture->mipLevels = header.mipLevels;
+		texture->layerCount = (uint32_t)request.layers.size();
+
+		//all layers go in a single copy
+		std::vector<VkBufferImageCopy> regions;
+		for (uint32_t layer = 0; layer < texture->layerCount; ++layer)
 		{
-			VkBufferImageCopy bufferCopyRegion = {};
-			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			bufferCopyRegion.imageSubresource.mipLevel = i;
-			bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-			bufferCopyRegion.imageSubresource.layerCount = 1;
-			bufferCopyRegion.imageExtent.width = width;
-			bufferCopyRegion.imageExtent.height = height;
-			bufferCopyRegion.imageExtent.depth = 1;
-			bufferCopyRegion.bufferOffset = offset;
-
-			bufferCopyRegions.push_back(bufferCopyRegion);
-			offset += (uint32_t)imageSize;
+			const TextureFileHeader &layerHeader = files[first + layer]->header();
+			if (layerHeader.width != header.width || layerHeader.height != header.height ||
+				layerHeader.mipLevels != header.mipLevels || layerHeader.format != header.format)
+				LOG_ASSERT("texture layers must share size, format and mip count : " + request.layers[layer]);
+			appendCopyRegions(layerHeader, offsets[first + layer], layer, regions);
 		}
 
-		//create optimal tiled target image
-		VkImageCreateInfo imageCreateInfo{};
-		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-		imageCreateInfo.pNext = NULL;
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.mipLevels = mipLevels;
-		imageCreateInfo.arrayLayers = 1;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { width, height, 1 };
-		imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-		LOG_ERROR("failed ro create image") <<
-		vkCreateImage(m_device, &imageCreateInfo, nullptr, &image);
-
-		vkGetImageMemoryRequirements(m_device, image, &memReqs);
-
-		allocateInfo.allocationSize = memReqs.size;
-		allocateInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		LOG_ERROR("failed to create image memory") <<
-		vkAllocateMemory(m_device, &allocateInfo, nullptr, &memory);
-		vkBindImageMemory(m_device, image, memory, 0);
-
-		VkCommandBuffer cmdBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		VkImageSubresourceRange subresourceRange{};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.baseMipLevel = 0;
-		subresourceRange.levelCount = mipLevels;
-		subresourceRange.layerCount = 1;
-
-		setImageLayout(
-			cmdBuffer, image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		vkCmdCopyBufferToImage(
-			cmdBuffer,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			(uint32_t)bufferCopyRegions.size(), bufferCopyRegions.data());
-		
-		imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		setImageLayout(
-			cmdBuffer, image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
-
-		vulkanDevice->flushCommandBuffer(cmdBuffer, vulkanDevice->m_queue, true);
-
-		vkFreeMemory(m_device, stagingMemory, nullptr);
-		vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+		VkImageCreateFlags flags = 0;
+		if (request.viewType == VK_IMAGE_VIEW_TYPE_CUBE)
+		{
+			if (texture->layerCount != 6 || texture->width != texture->height)
+				LOG_ASSERT("cubemap needs six square faces");
+			flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+		}
+		texture->buildImage(flags);
+		texture->recordUpload(cmdBuffer, staging->buffer, regions);
+		first += request.layers.size();
 	}
-	else
+	vulkanDevice->flushCommandBuffer(cmdBuffer, vulkanDevice->m_queue, true);
+
+	for (auto &file : files)
+		file->close();
+	for (auto &request : requests)
+	{
+		//cube faces should not wrap into each other at the seams
+		request.texture->buildSampler(request.viewType == VK_IMAGE_VIEW_TYPE_CUBE ?
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT);
+		request.texture->buildView(request.viewType);
+	}
+	LOG << "uploaded textures : " << requests.size() << " (" << count << " layers, "
+		<< totalSize << " bytes)" << ENDL;
+}
+
+void Texture::appendCopyRegions(
+	const TextureFileHeader &header,
+	VkDeviceSize stagingOffset,
+	uint32_t layer,
+	std::vector<VkBufferImageCopy> &regions)
+{
+	for (uint32_t i = 0; i < header.mipLevels; ++i)
 	{
-		LOG_WARN("implented");
+		VkBufferImageCopy bufferCopyRegion = {};
+		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		bufferCopyRegion.imageSubresource.mipLevel = i;
+		bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
+		bufferCopyRegion.imageSubresource.layerCount = 1;
+		bufferCopyRegion.imageExtent.width = header.levels[i].width;
+		bufferCopyRegion.imageExtent.height = header.levels[i].height;
+		bufferCopyRegion.imageExtent.depth = 1;
+		bufferCopyRegion.bufferOffset = stagingOffset + header.levels[i].offset;
+
+		regions.push_back(bufferCopyRegion);
 	}
+}
+
+void Texture::buildImage(VkImageCreateFlags flags)
+{
+	//create optimal tiled target image
+	VkImageCreateInfo imageCreateInfo{};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext = NULL;
+	imageCreateInfo.flags = flags;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = m_format;
+	imageCreateInfo.mipLevels = mipLevels;
+	imageCreateInfo.arrayLayers = layerCount;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.extent = { width, height, 1 };
+	//transfer src so residency can copy the kept levels into a smaller image
+	imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | 
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	m_imageFlags = flags;
+
+	LOG_ERROR("failed ro create image") <<
+	vkCreateImage(m_device, &imageCreateInfo, nullptr, &image);
+
+	VkMemoryRequirements memReqs{};
+	vkGetImageMemoryRequirements(m_device, image, &memReqs);
+
+	VkMemoryAllocateInfo allocateInfo = vkInitializer::memoryAllocateInfo();
+	allocateInfo.allocationSize = memReqs.size;
+	allocateInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_memorySize = memReqs.size;
+	m_memoryType = allocateInfo.memoryTypeIndex;
+
+	LOG_ERROR("failed to create image memory") <<
+	vkAllocateMemory(m_device, &allocateInfo, nullptr, &memory);
+	vkBindImageMemory(m_device, image, memory, 0);
+}
+
+void Texture::recordUpload(
+	VkCommandBuffer cmdBuffer,
+	VkBuffer stagingBuffer,
+	const std::vector<VkBufferImageCopy> &regions)
+{
+	VkImageSubresourceRange subresourceRange{};
+	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subresourceRange.baseMipLevel = 0;
+	subresourceRange.levelCount = mipLevels;
+	subresourceRange.layerCount = layerCount;
+
+	setImageLayout(
+		cmdBuffer, image,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		subresourceRange);
+
+	vkCmdCopyBufferToImage(
+		cmdBuffer,
+		stagingBuffer,
+		image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		(uint32_t)regions.size(), regions.data());
+	
+	imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	setImageLayout(
+		cmdBuffer, image,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		imageLayout,
+		subresourceRange);
+}
 
+void Texture::buildSampler(VkSamplerAddressMode addressMode)
+{
 	//create sampler
 	VkSamplerCreateInfo samplerInfo{};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -187,14 +377,13 @@ void Texture::loadTexture(const std::string &filename, VkFormat format, bool for
 	samplerInfo.magFilter = VK_FILTER_LINEAR;
 	samplerInfo.minFilter = VK_FILTER_LINEAR;
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeU = addressMode;
+	samplerInfo.addressModeV = addressMode;
+	samplerInfo.addressModeW = addressMode;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
-	samplerInfo.maxLod = 0.0f;
-	
-	samplerInfo.maxLod = (useStaging) ? mipLevels : 0.0f;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = (float)mipLevels;
 
 	if (vulkanDevice->m_features.samplerAnisotropy)
 	{
@@ -210,13 +399,15 @@ void Texture::loadTexture(const std::string &filename, VkFormat format, bool for
 	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 	LOG_ERROR("failed to create sampler") <<
 	vkCreateSampler(m_device, &samplerInfo, nullptr, &sampler);
+}
 
+void Texture::buildView(VkImageViewType viewType)
+{
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.pNext = NULL;
-	viewInfo.image = NULL;
-	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	viewInfo.format = format;
+	viewInfo.viewType = viewType;
+	viewInfo.format = m_format;
 	viewInfo.components = {
 		VK_COMPONENT_SWIZZLE_R,VK_COMPONENT_SWIZZLE_G,
 		VK_COMPONENT_SWIZZLE_B,VK_COMPONENT_SWIZZLE_A
@@ -224,8 +415,8 @@ void Texture::loadTexture(const std::string &filename, VkFormat format, bool for
 	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	viewInfo.subresourceRange.baseMipLevel = 0;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
-	viewInfo.subresourceRange.layerCount = 1;
-	viewInfo.subresourceRange.levelCount = (useStaging) ? mipLevels : 1;
+	viewInfo.subresourceRange.layerCount = layerCount;
+	viewInfo.subresourceRange.levelCount = mipLevels;
 	viewInfo.image = image;
 
 	LOG_ERROR("failed to create image view") <<
@@ -254,6 +445,10 @@ void Texture::setImageLayout(
 	imageMemoryBarrier.image = image;
 	imageMemoryBarrier.subresourceRange = subresourceRange;
 
+	//stages that have to finish with the old layout and the ones that wait
+	//for the new one, instead of stalling everything at the top of the pipe
+	VkPipelineStageFlags srcStageFlag = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	VkPipelineStageFlags dstStageFlag = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 	switch (oldImageLayout)
 	{
 	case VK_IMAGE_LAYOUT_UNDEFINED :
@@ -261,26 +456,40 @@ void Texture::setImageLayout(
 		break;
 	case VK_IMAGE_LAYOUT_PREINITIALIZED:
 		imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+		srcStageFlag = VK_PIPELINE_STAGE_HOST_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		imageMemoryBarrier.srcAccessMask = 0;
+		srcStageFlag = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		break;
 	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
 		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		srcStageFlag = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		//reads only wait, nothing to make available
+		imageMemoryBarrier.srcAccessMask = 0;
+		srcStageFlag = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		break;
 	}
 
 	switch (newImageLayout)
 	{
 	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
 		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		dstStageFlag = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		break;
 	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
 		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		dstStageFlag = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		break;
 	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+	case VK_IMAGE_LAYOUT_GENERAL:
 		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dstStageFlag = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 		break;
 	}
 
-	VkPipelineStageFlags srcStageFlag = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-	VkPipelineStageFlags dstStageFlag = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 	vkCmdPipelineBarrier(
 		cmdBuffer,
 		srcStageFlag,
@@ -2,8 +2,19 @@
 
 #include <vulkan/vulkan.h>
 #include <string>
+#include <vector>
 
 class VulkanDevice;
+class Texture;
+struct TextureFileHeader;
+
+struct TextureRequest
+{
+	Texture* texture;
+	std::vector<std::string> layers;		//one source file per array layer
+	VkImageViewType viewType;
+};
+
 class Texture
 {
 public:
@@ -14,18 +25,66 @@ public:
 	VkDevice m_device;
 	VkPhysicalDevice m_physicalDevice;
 
-	VkSampler sampler;
-	VkImage image;
-	VkImageView view;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
 	VkImageLayout imageLayout;
-	VkDeviceMemory memory;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
 	VkDescriptorImageInfo descriptor;
+	VkFormat m_format = VK_FORMAT_UNDEFINED;
 	uint32_t width;
 	uint32_t height;
 	uint32_t mipLevels;
+	uint32_t layerCount = 1;
+	std::string m_filename;
+
+	//enough to rebuild the image from its cooked files
+	std::vector<std::string> m_layers;
+	VkImageViewType m_viewType = VK_IMAGE_VIEW_TYPE_2D;
+	VkImageCreateFlags m_imageFlags = 0;
+	VkDeviceSize m_memorySize = 0;
+	uint32_t m_memoryType = 0;
+
+	//linear tiled host visible image, mapped once for the texture lifetime
+	uint8_t* m_mapped = nullptr;
+	VkSubresourceLayout m_subresourceLayout{};
+	uint32_t m_texelSize = 4;
 
 	void loadTexture(const std::string &filename, VkFormat format, bool forceLinearTiling);
+	//faces in +x -x +y -y +z -z order
+	void loadCubemap(const std::vector<std::string> &faces);
+
+	//cook/map every file on the worker pool and upload them with one submit
+	static void loadTextures(
+		const std::vector<Texture*> &textures,
+		const std::vector<std::string> &filenames);
+	static void loadTextures(const std::vector<TextureRequest> &requests);
+
+	/*DYNAMIC TEXTURE*/
+	//no staging copy, texels are written in place through the mapped pointer.
+	//only write while the gpu is not sampling (the renderer waits idle per frame)
+	void buildDynamic(uint32_t width, uint32_t height,
+		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+	bool isDynamic() const { return m_mapped != nullptr; }
+	VkDeviceSize rowPitch() const { return m_subresourceLayout.rowPitch; }
+	uint8_t* mappedRow(uint32_t y) const;
+	//copy a tightly or loosely packed frame, rows are split over the worker pool
+	void writeTexels(const void* src, size_t srcRowPitch);
+
 	//built in
+	void buildImage(VkImageCreateFlags flags = 0);
+	void buildSampler(VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+	void buildView(VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D);
+	void recordUpload(
+		VkCommandBuffer cmdBuffer,
+		VkBuffer stagingBuffer,
+		const std::vector<VkBufferImageCopy> &regions);
+
+	static void appendCopyRegions(
+		const TextureFileHeader &header,
+		VkDeviceSize stagingOffset,
+		uint32_t layer,
+		std::vector<VkBufferImageCopy> &regions);
 	
 	void setImageLayout(
 		VkCommandBuffer cmdBuffer,
@@ -38,3 +97,7 @@ public:
 	//VkFormat covertQImageToVKFormat(QImage::Format format);
 };
 
+inline uint8_t* Texture::mappedRow(uint32_t y) const
+{
+	return m_mapped + m_subresourceLayout.offset + y * m_subresourceLayout.rowPitch;
+}
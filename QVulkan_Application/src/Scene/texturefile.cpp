@@ -0,0 +1,205 @@
+#include "texturefile.h"
+#include <vklog.h>
+#include <mipmap.h>
+#include <imagedecoder.h>
+#include <qfile.h>
+#include <qdiriterator.h>
+#include <threadpool.h>
+#include <fstream>
+
+TextureFile::TextureFile()
+{
+}
+
+TextureFile::~TextureFile()
+{
+	close();
+}
+
+bool TextureFile::open(const std::string &filename)
+{
+	close();
+	m_file = std::unique_ptr<QFile>(new QFile(QString::fromStdString(filename)));
+	if (!m_file->open(QFile::ReadOnly)) {
+		m_file.reset();
+		return false;
+	}
+
+	qint64 size = m_file->size();
+	if (size < (qint64)sizeof(TextureFileHeader)) {
+		close();
+		return false;
+	}
+	//let the os page the payload in, nothing is read until memcpy touches it
+	m_mapped = m_file->map(0, size);
+	if (!m_mapped) {
+		close();
+		return false;
+	}
+
+	const TextureFileHeader* header = (const TextureFileHeader*)m_mapped;
+	if (header->magic != QTEX_MAGIC || header->version != QTEX_VERSION ||
+		header->mipLevels == 0 || header->mipLevels > QTEX_MAX_LEVELS ||
+		sizeof(TextureFileHeader) + header->payloadSize > (uint64_t)size)
+	{
+		LOG_WARN("invalid cooked texture file");
+		close();
+		return false;
+	}
+	//every level has to lie inside the payload, levelData is not checked again
+	for (uint32_t i = 0; i < header->mipLevels; ++i)
+	{
+		const TextureFileLevel &level = header->levels[i];
+		if (level.offset > header->payloadSize || level.size > header->payloadSize - level.offset)
+		{
+			LOG_WARN("cooked texture level runs past the payload");
+			close();
+			return false;
+		}
+	}
+	m_header = header;
+	m_payload = m_mapped + sizeof(TextureFileHeader);
+	return true;
+}
+
+void TextureFile::close()
+{
+	if (m_file)
+	{
+		if (m_mapped)
+			m_file->unmap(m_mapped);
+		m_file->close();
+		m_file.reset();
+	}
+	m_mapped = nullptr;
+	m_header = nullptr;
+	m_payload = nullptr;
+}
+
+
+uint64_t textureCooker::hashFile(const std::string &filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open()) return 0;
+
+	uint64_t hash = 14695981039346656037ULL;
+	char chunk[64 * 1024];
+	while (file)
+	{
+		file.read(chunk, sizeof(chunk));
+		std::streamsize count = file.gcount();
+		for (std::streamsize i = 0; i < count; ++i)
+		{
+			hash ^= (uint8_t)chunk[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+std::string textureCooker::cookedPath(const std::string &source)
+{
+	return source + ".qtex";
+}
+
+bool textureCooker::isUpToDate(const std::string &source, const std::string &cooked)
+{
+	std::ifstream file(cooked, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	TextureFileHeader header{};
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.magic != QTEX_MAGIC || header.version != QTEX_VERSION)
+		return false;
+
+	return header.sourceHash == hashFile(source);
+}
+
+bool textureCooker::cook(const std::string &source, const std::string &cooked, int levels)
+{
+	//stb decodes straight to RGBA, no format conversion or swizzle pass
+	image_ptr img = imageDecoder::decode(source);
+	if (!img) return false;
+	Mipmap mip(img->width, img->height, img->pixels,
+		std::min(levels, QTEX_MAX_LEVELS), false);
+	img.reset();
+
+	TextureFileHeader header{};
+	header.magic = QTEX_MAGIC;
+	header.version = QTEX_VERSION;
+	header.sourceHash = hashFile(source);
+	header.format = VK_FORMAT_R8G8B8A8_UNORM;
+	header.width = mip.m_width;
+	header.height = mip.m_height;
+	header.mipLevels = mip.maxLevels();
+	header.compressed = 0;
+
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < header.mipLevels; ++i)
+	{
+		const MapBuffer* buffer = mip.mapBuffer(i);
+		TextureFileLevel &level = header.levels[i];
+		level.width = buffer->width;
+		level.height = buffer->height;
+		level.size = uint64_t(buffer->width) * buffer->height * sizeof(rgba);
+		//keep every level 16 byte aligned for bufferOffset requirements
+		level.offset = offset;
+		offset += (level.size + 15) & ~uint64_t(15);
+	}
+	header.payloadSize = offset;
+
+	std::ofstream out(cooked, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		LOG_WARN("failed to write cooked texture");
+		return false;
+	}
+	out.write((const char*)&header, sizeof(header));
+	const char padding[16] = {};
+	for (uint32_t i = 0; i < header.mipLevels; ++i)
+	{
+		const TextureFileLevel &level = header.levels[i];
+		out.write((const char*)mip.mapBuffer(i)->data(), level.size);
+		out.write(padding, ((level.size + 15) & ~uint64_t(15)) - level.size);
+	}
+	LOG << "cooked texture : " << cooked << " (" << header.width << "x" << header.height
+		<< ", " << header.mipLevels << " levels)" << ENDL;
+	return out.good();
+}
+
+bool textureCooker::prepare(const std::string &source, TextureFile &file)
+{
+	std::string cooked = cookedPath(source);
+	if (!isUpToDate(source, cooked))
+	{
+		if (!cook(source, cooked))
+			return false;
+	}
+	return file.open(cooked);
+}
+
+int textureCooker::cookDirectory(const std::string &directory)
+{
+	LOG_SECTION("cook textures");
+	std::vector<std::string> sources;
+	QDirIterator it(QString::fromStdString(directory),
+		QStringList() << "*.jpg" << "*.png", QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext())
+		sources.push_back(it.next().toStdString());
+
+	//every source decodes and filters on its own worker
+	std::vector<std::future<bool>> cooked;
+	for (auto &source : sources)
+	{
+		cooked.push_back(ThreadPool::global().enqueue([source] {
+			std::string path = cookedPath(source);
+			if (isUpToDate(source, path))
+				return false;
+			return cook(source, path);
+		}));
+	}
+	int count = 0;
+	for (auto &result : cooked)
+		count += result.get() ? 1 : 0;
+	LOG << "cooked " << count << " of " << sources.size() << " textures" << ENDL;
+	return count;
+}
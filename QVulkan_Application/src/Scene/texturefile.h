@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <string>
+#include <memory>
+
+/*COOKED TEXTURE CONTAINER (.qtex)*/
+//header | level table | payload
+//the payload is the exact bytes that go to the staging buffer so loading
+//is a single memcpy from the mapped file. levels are packed from 0 (largest)
+//to mipLevels - 1, each level offset is relative to the payload start
+
+#define QTEX_MAGIC			0x58455451		//'QTEX'
+#define QTEX_VERSION		1
+#define QTEX_MAX_LEVELS		16
+
+struct TextureFileLevel
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct TextureFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;				//hash of the source image bytes
+	uint32_t format;					//VkFormat of the payload (raw or BC)
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t compressed;				//0 raw texels, otherwise BC block bytes
+	uint32_t reserved;
+	uint64_t payloadSize;
+	TextureFileLevel levels[QTEX_MAX_LEVELS];
+};
+
+class QFile;
+class TextureFile
+{
+public:
+	TextureFile();
+	~TextureFile();
+
+	//map whole file read only, returns false if missing or invalid
+	bool open(const std::string &filename);
+	void close();
+
+	bool isOpen() const { return m_header != nullptr; }
+	const TextureFileHeader& header() const { return *m_header; }
+	const uint8_t* payload() const { return m_payload; }
+	const uint8_t* levelData(uint32_t level) const;
+
+private:
+	std::unique_ptr<QFile> m_file;
+	uint8_t* m_mapped = nullptr;
+	const TextureFileHeader* m_header = nullptr;
+	const uint8_t* m_payload = nullptr;
+};
+
+inline const uint8_t* TextureFile::levelData(uint32_t level) const
+{
+	return m_payload + m_header->levels[level].offset;
+}
+
+namespace textureCooker
+{
+	//FNV-1a over the source file bytes
+	uint64_t hashFile(const std::string &filename);
+
+	//source.jpg -> source.jpg.qtex
+	std::string cookedPath(const std::string &source);
+
+	bool isUpToDate(const std::string &source, const std::string &cooked);
+
+	//decode, pow2 resize, build mip chain and write a .qtex file
+	bool cook(const std::string &source, const std::string &cooked,
+		int levels = QTEX_MAX_LEVELS);
+
+	//cook the source if needed and map the result
+	bool prepare(const std::string &source, TextureFile &file);
+
+	//bake every *.jpg / *.png under the directory, returns cooked count
+	int cookDirectory(const std::string &directory);
+}
@@ -0,0 +1,363 @@
+#include "textureresidency.h"
+#include <vklog.h>
+#include <vkdevice.h>
+#include <vkstaging.h>
+#include <texture.h>
+#include <texturefile.h>
+#include <threadpool.h>
+#include <vkdescriptor.h>
+#include <future>
+
+//top levels read back from the cooked files on a worker
+struct TextureResidency::Reload
+{
+	std::future<bool> ready;
+	std::unique_ptr<VulkanStagingBuffer> staging;
+	uint8_t* mapped = nullptr;						//reserved on the render thread
+	VkDeviceSize size = 0;
+	std::vector<VkBufferImageCopy> regions;			//mip levels of the full chain
+};
+
+namespace
+{
+	VkDeviceSize stagingSize(VkDeviceSize size)
+	{
+		return (size + 15) & ~VkDeviceSize(15);
+	}
+}
+
+TextureResidency::TextureResidency(VulkanDevice* vulkanDevice, DescriptorCache* descriptors)
+	: vulkanDevice(vulkanDevice), descriptors(descriptors)
+{
+}
+
+VkDeviceSize TextureResidency::budget() const
+{
+	return m_budget ? m_budget : (VkDeviceSize)(m_trackedBytes * m_budgetRatio);
+}
+
+TextureResidency::~TextureResidency()
+{
+	for (auto &entry : m_entries)
+	{
+		if (entry.reload)
+			entry.reload->ready.wait();
+	}
+}
+
+void TextureResidency::track(Texture* texture)
+{
+	if (find(texture)) return;
+	//dynamic or procedural images have no cooked source to come back from
+	if (texture->isDynamic() || texture->m_layers.empty())
+	{
+		LOG_WARN("texture residency only tracks cooked textures");
+		return;
+	}
+	Entry entry;
+	entry.texture = texture;
+	entry.fullLevels = texture->mipLevels;
+	entry.fullWidth = texture->width;
+	entry.fullHeight = texture->height;
+	entry.fullBytes = texture->m_memorySize;
+	entry.lastUsed = m_frame;
+	//the staging buffer of a reload is sized from these before the worker runs
+	entry.levelBytes.resize(entry.fullLevels, 0);
+	for (auto &layer : texture->m_layers)
+	{
+		TextureFile file;
+		if (!file.open(textureCooker::cookedPath(layer)) || file.header().mipLevels < entry.fullLevels)
+		{
+			LOG_WARN("texture residency needs the cooked file of every layer : " + layer);
+			return;
+		}
+		for (uint32_t i = 0; i < entry.fullLevels; ++i)
+			entry.levelBytes[i] += stagingSize(file.header().levels[i].size);
+	}
+	m_entries.push_back(entry);
+	m_trackedBytes += entry.fullBytes;
+	account(texture, true);
+}
+
+void TextureResidency::untrack(Texture* texture)
+{
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		if (it->texture != texture) continue;
+		if (it->reload)
+			it->reload->ready.wait();
+		account(texture, false);
+		m_trackedBytes -= it->fullBytes;
+		m_entries.erase(it);
+		return;
+	}
+}
+
+void TextureResidency::touch(Texture* texture)
+{
+	Entry* entry = find(texture);
+	if (!entry) return;
+	entry->lastUsed = m_frame;
+	if (entry->droppedLevels > 0 && !entry->reload && !entry->failed)
+		requestReload(*entry);
+}
+
+bool TextureResidency::update()
+{
+	bool changed = false;
+	for (auto &entry : m_entries)
+	{
+		if (entry.reload && entry.reload->ready.wait_for(std::chrono::seconds(0)) ==
+			std::future_status::ready)
+			changed |= finishReload(entry);
+	}
+
+	//least recently sampled first, never what is bound this frame or what
+	//could not come back
+	VkDeviceSize limit = budget();
+	while (m_stats.residentBytes > limit)
+	{
+		Entry* victim = nullptr;
+		for (auto &entry : m_entries)
+		{
+			if (entry.lastUsed == m_frame || entry.reload || entry.failed ||
+				entry.droppedLevels >= maxDropped(entry))
+				continue;
+			if (!victim || entry.lastUsed < victim->lastUsed)
+				victim = &entry;
+		}
+		if (!victim) break;
+
+		uint32_t dropped = victim->droppedLevels + 1;
+		if (m_frame - victim->lastUsed > m_evictAfterFrames)
+		{
+			dropped = maxDropped(*victim);
+			m_stats.evictions++;
+		}
+		else
+			m_stats.mipDrops++;
+		rebuild(*victim, dropped, nullptr);
+		changed = true;
+	}
+	m_frame++;
+	return changed;
+}
+
+void TextureResidency::roundTrip()
+{
+	uint32_t dropped = 0;
+	for (auto &entry : m_entries)
+	{
+		if (entry.reload || entry.failed || maxDropped(entry) == 0)
+			continue;
+		rebuild(entry, maxDropped(entry), nullptr);
+		m_stats.evictions++;
+		requestReload(entry);
+		dropped++;
+	}
+	uint32_t reloaded = 0;
+	for (auto &entry : m_entries)
+	{
+		if (!entry.reload) continue;
+		entry.reload->ready.wait();
+		reloaded += finishReload(entry) ? 1 : 0;
+	}
+	LOG << "texture residency round trip : " << dropped << " dropped to their tails, " << reloaded
+		<< " reloaded in " << m_stats.totalReloadMs << " ms" << ENDL;
+}
+
+TextureResidency::Entry* TextureResidency::find(Texture* texture)
+{
+	for (auto &entry : m_entries)
+	{
+		if (entry.texture == texture)
+			return &entry;
+	}
+	return nullptr;
+}
+
+uint32_t TextureResidency::maxDropped(const Entry &entry) const
+{
+	uint32_t dropped = 0;
+	while (dropped + 1 < entry.fullLevels &&
+		std::max(entry.fullWidth >> dropped, entry.fullHeight >> dropped) > m_tailSize)
+		dropped++;
+	return dropped;
+}
+
+void TextureResidency::requestReload(Entry &entry)
+{
+	std::shared_ptr<Reload> reload = std::make_shared<Reload>();
+	reload->staging = std::unique_ptr<VulkanStagingBuffer>(new VulkanStagingBuffer(vulkanDevice));
+	//buffers are made here, the worker only reads the files and copies
+	for (uint32_t i = 0; i < entry.droppedLevels; ++i)
+		reload->size += entry.levelBytes[i];
+	reload->mapped = reload->staging->reserve(reload->size);
+	entry.reload = reload;
+	entry.requested = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::string> layers = entry.texture->m_layers;
+	uint32_t levels = entry.droppedLevels;
+	Reload* job = reload.get();
+	//the entry holds the reload alive until the future is consumed
+	reload->ready = ThreadPool::global().enqueue([job, layers, levels]
+	{
+		VkDeviceSize offset = 0;
+		for (uint32_t layer = 0; layer < (uint32_t)layers.size(); ++layer)
+		{
+			TextureFile file;
+			if (!textureCooker::prepare(layers[layer], file))
+				return false;
+			const TextureFileHeader &header = file.header();
+			for (uint32_t i = 0; i < levels; ++i)
+			{
+				//cooked again since it was tracked, the levels may not fit any more
+				if (offset + stagingSize(header.levels[i].size) > job->size)
+					return false;
+				memcpy(job->mapped + offset, file.levelData(i), (size_t)header.levels[i].size);
+
+				VkBufferImageCopy region = {};
+				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.imageSubresource.mipLevel = i;
+				region.imageSubresource.baseArrayLayer = layer;
+				region.imageSubresource.layerCount = 1;
+				region.imageExtent = { header.levels[i].width, header.levels[i].height, 1 };
+				region.bufferOffset = offset;
+				job->regions.push_back(region);
+
+				offset += stagingSize(header.levels[i].size);
+			}
+		}
+		return true;
+	});
+}
+
+bool TextureResidency::finishReload(Entry &entry)
+{
+	std::shared_ptr<Reload> reload = entry.reload;
+	entry.reload.reset();
+	//warned once, the entry is neither reloaded nor dropped again
+	if (!reload->ready.get())
+	{
+		entry.failed = true;
+		LOG_WARN("failed to reload texture, its dropped levels stay dropped : " + entry.texture->m_filename);
+		return false;
+	}
+	rebuild(entry, 0, reload.get());
+
+	double ms = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - entry.requested).count();
+	m_stats.reloads++;
+	m_stats.lastReloadMs = ms;
+	m_stats.totalReloadMs += ms;
+	return true;
+}
+
+void TextureResidency::rebuild(Entry &entry, uint32_t droppedLevels, const Reload* reload)
+{
+	Texture* texture = entry.texture;
+	VkDevice device = vulkanDevice->m_device;
+	VkImage oldImage = texture->image;
+	VkDeviceMemory oldMemory = texture->memory;
+	VkImageView oldView = texture->view;
+	uint32_t oldDropped = entry.droppedLevels;
+
+	account(texture, false);
+	texture->mipLevels = entry.fullLevels - droppedLevels;
+	texture->width = std::max(1U, entry.fullWidth >> droppedLevels);
+	texture->height = std::max(1U, entry.fullHeight >> droppedLevels);
+	texture->buildImage(texture->m_imageFlags);
+
+	VkImageSubresourceRange newRange{};
+	newRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	newRange.levelCount = texture->mipLevels;
+	newRange.layerCount = texture->layerCount;
+
+	VkImageSubresourceRange oldRange = newRange;
+	oldRange.levelCount = entry.fullLevels - oldDropped;
+
+	VkCommandBuffer cmdBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	texture->setImageLayout(cmdBuffer, texture->image, VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, newRange);
+	texture->setImageLayout(cmdBuffer, oldImage, VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, oldRange);
+
+	//levels both images share move on the gpu, nothing is read back
+	std::vector<VkImageCopy> copies;
+	for (uint32_t level = std::max(droppedLevels, oldDropped); level < entry.fullLevels; ++level)
+	{
+		VkImageCopy copy = {};
+		copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copy.srcSubresource.mipLevel = level - oldDropped;
+		copy.srcSubresource.layerCount = texture->layerCount;
+		copy.dstSubresource = copy.srcSubresource;
+		copy.dstSubresource.mipLevel = level - droppedLevels;
+		copy.extent.width = std::max(1U, entry.fullWidth >> level);
+		copy.extent.height = std::max(1U, entry.fullHeight >> level);
+		copy.extent.depth = 1;
+		copies.push_back(copy);
+	}
+	vkCmdCopyImage(cmdBuffer,
+		oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		(uint32_t)copies.size(), copies.data());
+
+	//levels above the old image come from the reload staging buffer
+	if (reload)
+	{
+		std::vector<VkBufferImageCopy> regions = reload->regions;
+		for (auto &region : regions)
+			region.imageSubresource.mipLevel -= droppedLevels;
+		vkCmdCopyBufferToImage(cmdBuffer,
+			reload->staging->buffer,
+			texture->image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			(uint32_t)regions.size(), regions.data());
+	}
+
+	texture->setImageLayout(cmdBuffer, texture->image, VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, newRange);
+	vulkanDevice->flushCommandBuffer(cmdBuffer, vulkanDevice->m_queue, true);
+
+	//the new view may come back with the old handle, sets written with it must not be found again
+	if (descriptors)
+		descriptors->forget(oldView);
+	vkDestroyImageView(device, oldView, nullptr);
+	vkDestroyImage(device, oldImage, nullptr);
+	vkFreeMemory(device, oldMemory, nullptr);
+
+	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	texture->buildView(texture->m_viewType);
+	entry.droppedLevels = droppedLevels;
+	account(texture, true);
+}
+
+void TextureResidency::account(const Texture* texture, bool add)
+{
+	uint32_t heap = vulkanDevice->m_memoryProperties.memoryTypes[texture->m_memoryType].heapIndex;
+	if (add)
+	{
+		m_stats.residentBytes += texture->m_memorySize;
+		m_stats.heapBytes[heap] += texture->m_memorySize;
+	}
+	else
+	{
+		m_stats.residentBytes -= texture->m_memorySize;
+		m_stats.heapBytes[heap] -= texture->m_memorySize;
+	}
+}
+
+void TextureResidency::report() const
+{
+	LOG_SECTION("texture residency");
+	LOG << "resident bytes : " << m_stats.residentBytes << " / budget " << budget() << ENDL;
+	const VkPhysicalDeviceMemoryProperties &memory = vulkanDevice->m_memoryProperties;
+	for (uint32_t i = 0; i < memory.memoryHeapCount; ++i)
+	{
+		LOG << "heap " << i << " : " << m_stats.heapBytes[i] << " of "
+			<< memory.memoryHeaps[i].size << ENDL;
+	}
+	LOG << "evictions : " << m_stats.evictions << " mip drops : " << m_stats.mipDrops << ENDL;
+	LOG << "reloads : " << m_stats.reloads << " last " << m_stats.lastReloadMs << " ms, avg "
+		<< (m_stats.reloads ? m_stats.totalReloadMs / m_stats.reloads : 0.0) << " ms" << ENDL;
+}
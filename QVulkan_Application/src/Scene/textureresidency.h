@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+class VulkanDevice;
+class Texture;
+class DescriptorCache;
+
+struct ResidencyStats
+{
+	VkDeviceSize residentBytes = 0;
+	VkDeviceSize heapBytes[VK_MAX_MEMORY_HEAPS] = {};
+	uint32_t evictions = 0;				//textures dropped down to their mip tail
+	uint32_t mipDrops = 0;				//single top level drops
+	uint32_t reloads = 0;
+	double lastReloadMs = 0.0;
+	double totalReloadMs = 0.0;
+};
+
+//keeps device local texture memory under a budget. textures that were not
+//sampled recently lose their top mips (or everything above the mip tail) and
+//get the full chain back from their cooked files on the worker pool.
+//the tail always stays resident so descriptors never point at nothing
+class TextureResidency
+{
+public:
+	//descriptors forgets the views that are replaced
+	TextureResidency(VulkanDevice* vulkanDevice, DescriptorCache* descriptors = NULL);
+	~TextureResidency();
+
+	VulkanDevice* vulkanDevice;
+	DescriptorCache* descriptors;
+
+	//without a budget of its own it keeps m_budgetRatio of the full chains tracked
+	void setBudget(VkDeviceSize bytes) { m_budget = bytes; }
+	VkDeviceSize budget() const;
+	float m_budgetRatio = 0.75f;
+
+	//dropped after this many frames unused go straight to the tail
+	uint32_t m_evictAfterFrames = 120;
+	//largest level edge that is never dropped
+	uint32_t m_tailSize = 64;
+
+	void track(Texture* texture);
+	void untrack(Texture* texture);
+
+	//mark as sampled this frame, schedules a reload if mips were dropped
+	void touch(Texture* texture);
+
+	//render thread with the gpu idle, finishes reloads and enforces the budget.
+	//returns true if any image view changed so descriptors must be rewritten
+	bool update();
+	//drops every texture to its tail and waits for the reloads. runs the whole
+	//path once, a cooked file that cannot come back shows up here
+	void roundTrip();
+
+	const ResidencyStats& stats() const { return m_stats; }
+	void report() const;
+
+private:
+	struct Reload;
+	struct Entry
+	{
+		Texture* texture;
+		uint32_t fullLevels;
+		uint32_t fullWidth;
+		uint32_t fullHeight;
+		VkDeviceSize fullBytes;
+		//staging bytes of each level over all layers, from the cooked headers
+		std::vector<VkDeviceSize> levelBytes;
+		uint32_t droppedLevels = 0;
+		uint64_t lastUsed = 0;
+		std::shared_ptr<Reload> reload;
+		//a reload failed, the dropped levels stay dropped
+		bool failed = false;
+		std::chrono::high_resolution_clock::time_point requested;
+	};
+
+	Entry* find(Texture* texture);
+	uint32_t maxDropped(const Entry &entry) const;
+	void requestReload(Entry &entry);
+	bool finishReload(Entry &entry);
+	void rebuild(Entry &entry, uint32_t droppedLevels, const Reload* reload);
+	void account(const Texture* texture, bool add);
+
+	std::vector<Entry> m_entries;
+	VkDeviceSize m_budget = 0;
+	VkDeviceSize m_trackedBytes = 0;
+	uint64_t m_frame = 0;
+	ResidencyStats m_stats;
+};
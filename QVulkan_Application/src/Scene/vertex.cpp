@@ -10,12 +10,18 @@
 //uvec4 : VK_FORMAT_R32G32B32A32_UINT, a 4 - component vector of 32 - bit unsigned integers
 //double : VK_FORMAT_R64_SFLOAT, a double - precision(64 - bit) float
 
-VkVertexInputBindingDescription Vertex::getBindingDescribtion()
+std::array<VkVertexInputBindingDescription, 2> Vertex::getBindingDescribtions()
 {
-	VkVertexInputBindingDescription bindingDescribtion = {};
-	bindingDescribtion.binding = 0;
-	bindingDescribtion.stride = sizeof(Vertex);
-	bindingDescribtion.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	std::array<VkVertexInputBindingDescription, 2> bindingDescribtion = {};
+	//pos
+	bindingDescribtion[0].binding = 0;
+	bindingDescribtion[0].stride = sizeof(vec3f);
+	bindingDescribtion[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	//normal, color, st
+	bindingDescribtion[1].binding = 1;
+	bindingDescribtion[1].stride = sizeof(VertexAttributes);
+	bindingDescribtion[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 	
 	return bindingDescribtion;
 }
@@ -27,25 +33,54 @@ std::array<VkVertexInputAttributeDescription, 4> Vertex::getAttributeDescribtion
 	attrib[0].binding = 0;
 	attrib[0].location = 0;
 	attrib[0].format = VK_FORMAT_R32G32B32_SFLOAT;		
-	attrib[0].offset = offsetof(Vertex, pos);
+	attrib[0].offset = 0;
 
 	//normal
-	attrib[1].binding = 0;
+	attrib[1].binding = 1;
 	attrib[1].location = 1;							
 	attrib[1].format = VK_FORMAT_R32G32B32_SFLOAT;		
-	attrib[1].offset = offsetof(Vertex, normal);
+	attrib[1].offset = offsetof(VertexAttributes, normal);
 
 	//color
-	attrib[2].binding = 0;
+	attrib[2].binding = 1;
 	attrib[2].location = 2;							
 	attrib[2].format = VK_FORMAT_R32G32B32_SFLOAT;		
-	attrib[2].offset = offsetof(Vertex, color);
+	attrib[2].offset = offsetof(VertexAttributes, color);
 
 	//st(uv)
-	attrib[3].binding = 0;
+	attrib[3].binding = 1;
 	attrib[3].location = 3;
 	attrib[3].format = VK_FORMAT_R32G32_SFLOAT;
-	attrib[3].offset = offsetof(Vertex, st);
+	attrib[3].offset = offsetof(VertexAttributes, st);
 	return attrib;
 }
 
+VkVertexInputBindingDescription InstanceVertex::getBindingDescribtion()
+{
+	VkVertexInputBindingDescription bindingDescribtion = {};
+	bindingDescribtion.binding = 2;
+	bindingDescribtion.stride = sizeof(InstanceVertex);
+	bindingDescribtion.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	return bindingDescribtion;
+}
+
+std::array<VkVertexInputAttributeDescription, 5> InstanceVertex::getAttributeDescribtions()
+{
+	std::array<VkVertexInputAttributeDescription, 5> attrib = {};
+	//model, one vec4 column per location
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		attrib[i].binding = 2;
+		attrib[i].location = 4 + i;
+		attrib[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attrib[i].offset = offsetof(InstanceVertex, model) + i * 4 * sizeof(float);
+	}
+
+	//color
+	attrib[4].binding = 2;
+	attrib[4].location = 8;
+	attrib[4].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attrib[4].offset = offsetof(InstanceVertex, color);
+	return attrib;
+}
@@ -6,6 +6,7 @@
 #include <vec2f.h>
 #include <vec3f.h>
 #include <color.h>
+#include <matrix4x4.h>
 
 class Vertex
 {
@@ -19,7 +20,9 @@ public:
 	vec3f color;
 	vec2f st;
 
-	static VkVertexInputBindingDescription getBindingDescribtion();
+	//uploaded as two streams, positions alone at binding 0 and
+	//VertexAttributes at binding 1, so position only passes fetch 12 bytes
+	static std::array<VkVertexInputBindingDescription, 2> getBindingDescribtions();
 
 	static std::array<VkVertexInputAttributeDescription, 4>
 		getAttributeDescribtions();
@@ -31,6 +34,28 @@ public:
 	}
 };
 
+//everything of a Vertex but its position, the gpu stream at binding 1
+struct VertexAttributes
+{
+	vec3f normal;
+	vec3f color;
+	vec2f st;
+};
+
+//per instance stream at binding 2, advanced once per instance
+class InstanceVertex
+{
+public:
+	//transposed so the four columns land in locations 4 - 7 as a mat4
+	Matrix4x4 model;
+	vec3f color;
+	float pad;
+
+	static VkVertexInputBindingDescription getBindingDescribtion();
+
+	static std::array<VkVertexInputAttributeDescription, 5>
+		getAttributeDescribtions();
+};
 
 inline void hash_combine(size_t &seed, size_t hash)
 {
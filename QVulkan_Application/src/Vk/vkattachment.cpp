@@ -0,0 +1,282 @@
+#include "vkattachment.h"
+#include <vkdevice.h>
+#include <vklog.h>
+#include <algorithm>
+
+namespace
+{
+	const VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+	}
+
+	bool overlaps(const AttachmentDesc &a, const AttachmentDesc &b)
+	{
+		return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+	}
+
+	double megabytes(VkDeviceSize bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+}
+
+uint32_t attachmentTexelSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+		return 2;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+		return 3;
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return 5;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return 8;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16;
+	default:
+		//8 bit rgba, packed 10 and 11 bit color, x8_d24, d24_s8 and d32
+		return 4;
+	}
+}
+
+VkImageAspectFlags attachmentAspect(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+AttachmentPool::AttachmentPool(VulkanDevice* vulkanDevice)
+	: m_vulkanDevice(vulkanDevice), m_device(vulkanDevice->m_device)
+{
+}
+
+AttachmentPool::~AttachmentPool()
+{
+	release();
+}
+
+uint32_t AttachmentPool::add(const AttachmentDesc &desc)
+{
+	m_descs.push_back(desc);
+	return (uint32_t)m_descs.size() - 1;
+}
+
+bool AttachmentPool::isTransient(const AttachmentDesc &desc)
+{
+	return !desc.acrossFrames && (desc.usage & ~ATTACHMENT_USAGE) == 0;
+}
+
+/*PLAN*/
+AttachmentPlan AttachmentPool::plan(const std::vector<AttachmentDesc> &descs,
+	const std::vector<AttachmentMemory> &memory, bool transient, bool aliasing)
+{
+	AttachmentPlan plan;
+	plan.placements.resize(descs.size());
+	std::vector<uint32_t> shared;
+	for (uint32_t i = 0; i < descs.size(); ++i)
+	{
+		AttachmentPlan::Placement &placement = plan.placements[i];
+		placement = { transient && isTransient(descs[i]), false, 0, 0 };
+		plan.dedicated += memory[i].size;
+		//tile memory on tilers, nothing is committed unless the driver spills
+		if (placement.transient && memory[i].lazy)
+		{
+			placement.lazy = true;
+			plan.lazy += memory[i].size;
+		}
+		else if (aliasing && !descs[i].acrossFrames)
+			shared.push_back(i);
+		else
+		{
+			placement.heap = (uint32_t)plan.heaps.size();
+			plan.heaps.push_back(memory[i].size);
+			plan.heapTypeBits.push_back(memory[i].typeBits);
+		}
+	}
+
+	//largest first, each at the lowest offset clear of everything placed in
+	//its heap whose passes overlap its own
+	std::stable_sort(shared.begin(), shared.end(), [&](uint32_t a, uint32_t b)
+	{
+		return memory[a].size > memory[b].size;
+	});
+	std::vector<uint32_t> placed;
+	for (uint32_t i : shared)
+	{
+		uint32_t heap = (uint32_t)plan.heaps.size();
+		for (uint32_t h = 0; h < plan.heaps.size(); ++h)
+			if (plan.heapTypeBits[h] & memory[i].typeBits)
+			{
+				heap = h;
+				break;
+			}
+		if (heap == plan.heaps.size())
+		{
+			plan.heaps.push_back(0);
+			plan.heapTypeBits.push_back(memory[i].typeBits);
+		}
+
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> taken;
+		for (uint32_t j : placed)
+			if (plan.placements[j].heap == heap && overlaps(descs[i], descs[j]))
+				taken.push_back(std::make_pair(plan.placements[j].offset, plan.placements[j].offset + memory[j].size));
+		std::sort(taken.begin(), taken.end());
+		VkDeviceSize offset = 0;
+		for (const auto &range : taken)
+		{
+			if (alignUp(offset, memory[i].alignment) + memory[i].size <= range.first)
+				break;
+			offset = std::max(offset, range.second);
+		}
+		offset = alignUp(offset, memory[i].alignment);
+
+		plan.placements[i].heap = heap;
+		plan.placements[i].offset = offset;
+		plan.heaps[heap] = std::max(plan.heaps[heap], offset + memory[i].size);
+		plan.heapTypeBits[heap] &= memory[i].typeBits;
+		placed.push_back(i);
+	}
+
+	for (VkDeviceSize heap : plan.heaps)
+		plan.allocated += heap;
+	return plan;
+}
+
+uint32_t AttachmentPool::aliasOf(const std::vector<AttachmentDesc> &descs, const AttachmentPlan &plan, uint32_t attachment)
+{
+	//the latest one before it in the same memory
+	const AttachmentPlan::Placement &placement = plan.placements[attachment];
+	if (placement.lazy)
+		return NO_ALIAS;
+	uint32_t alias = NO_ALIAS;
+	for (uint32_t i = 0; i < descs.size(); ++i)
+	{
+		const AttachmentPlan::Placement &other = plan.placements[i];
+		if (i == attachment || other.lazy || other.heap != placement.heap ||
+			descs[i].lastPass >= descs[attachment].firstPass)
+			continue;
+		if (alias == NO_ALIAS || descs[i].lastPass > descs[alias].lastPass)
+			alias = i;
+	}
+	return alias;
+}
+
+uint32_t AttachmentPool::aliasOf(uint32_t attachment) const
+{
+	return aliasOf(m_descs, m_plan, attachment);
+}
+
+/*BUILD*/
+void AttachmentPool::build()
+{
+	m_images.resize(m_descs.size());
+	std::vector<AttachmentMemory> memory(m_descs.size());
+	for (uint32_t i = 0; i < m_descs.size(); ++i)
+	{
+		const AttachmentDesc &desc = m_descs[i];
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = desc.format;
+		imageInfo.extent = { desc.extent.width, desc.extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = desc.usage;
+		if (transient && isTransient(desc))
+			imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		LOG_ERROR("failed to create attachment image : " + desc.name) <<
+			vkCreateImage(m_device, &imageInfo, nullptr, &m_images[i]);
+
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(m_device, m_images[i], &memReqs);
+		VkBool32 lazy = false;
+		m_vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &lazy);
+		memory[i] = { memReqs.size, memReqs.alignment, memReqs.memoryTypeBits, lazy == VK_TRUE };
+	}
+	m_plan = plan(m_descs, memory, transient, aliasing);
+
+	//a lazily allocated attachment gets an allocation of its own, the heaps are shared
+	m_memory.assign(m_plan.heaps.size(), VK_NULL_HANDLE);
+	for (uint32_t h = 0; h < m_plan.heaps.size(); ++h)
+	{
+		VkMemoryAllocateInfo memAllocInfo{};
+		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memAllocInfo.allocationSize = m_plan.heaps[h];
+		memAllocInfo.memoryTypeIndex = m_vulkanDevice->getMemoryType(m_plan.heapTypeBits[h],
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		LOG_ERROR("failed to allocate attachment memory") <<
+			vkAllocateMemory(m_device, &memAllocInfo, nullptr, &m_memory[h]);
+	}
+	for (uint32_t i = 0; i < m_descs.size(); ++i)
+	{
+		const AttachmentPlan::Placement &placement = m_plan.placements[i];
+		if (!placement.lazy)
+		{
+			LOG_ERROR("failed to bind attachment memory : " + m_descs[i].name) <<
+				vkBindImageMemory(m_device, m_images[i], m_memory[placement.heap], placement.offset);
+			continue;
+		}
+		VkDeviceMemory lazyMemory = VK_NULL_HANDLE;
+		VkMemoryAllocateInfo memAllocInfo{};
+		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memAllocInfo.allocationSize = memory[i].size;
+		memAllocInfo.memoryTypeIndex = m_vulkanDevice->getMemoryType(memory[i].typeBits,
+			VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		LOG_ERROR("failed to allocate lazy attachment memory") <<
+			vkAllocateMemory(m_device, &memAllocInfo, nullptr, &lazyMemory);
+		LOG_ERROR("failed to bind attachment memory : " + m_descs[i].name) <<
+			vkBindImageMemory(m_device, m_images[i], lazyMemory, 0);
+		m_memory.push_back(lazyMemory);
+	}
+}
+
+void AttachmentPool::release()
+{
+	for (VkImage image : m_images)
+		vkDestroyImage(m_device, image, nullptr);
+	for (VkDeviceMemory memory : m_memory)
+		vkFreeMemory(m_device, memory, nullptr);
+	m_images.clear();
+	m_memory.clear();
+}
+
+void AttachmentPool::report() const
+{
+	for (uint32_t i = 0; i < m_descs.size(); ++i)
+	{
+		const AttachmentPlan::Placement &placement = m_plan.placements[i];
+		LOG << "attachment " << m_descs[i].name << " : " << m_descs[i].extent.width << "x" << m_descs[i].extent.height
+			<< ", " << attachmentTexelSize(m_descs[i].format) << " bytes per texel";
+		if (placement.lazy)
+			LOG << ", transient in lazily allocated memory";
+		else
+		{
+			LOG << (placement.transient ? ", transient" : "") << " at " << placement.offset << " of heap " << placement.heap;
+			uint32_t alias = aliasOf(i);
+			if (alias != NO_ALIAS)
+				LOG << " after " << m_descs[alias].name;
+		}
+		LOG << ENDL;
+	}
+	LOG << "attachment memory : " << megabytes(m_plan.allocated) << " MB allocated, " << megabytes(m_plan.lazy)
+		<< " MB lazily, of " << megabytes(m_plan.dedicated) << " MB in dedicated allocations" << ENDL;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+class VulkanDevice;
+
+//bytes a texel of an attachment format takes, depth and stencil planes together
+uint32_t attachmentTexelSize(VkFormat format);
+//depth and stencil for combined formats, what barriers and views cover
+VkImageAspectFlags attachmentAspect(VkFormat format);
+
+//a render target and the passes of the frame that use it, in recording order
+struct AttachmentDesc
+{
+	std::string name;
+	VkFormat format;
+	VkExtent2D extent;
+	VkImageUsageFlags usage;
+	uint32_t firstPass;
+	uint32_t lastPass;
+	//read by a later frame, keeps its own memory and contents
+	bool acrossFrames;
+};
+
+//what the memory of one attachment needs, from vkGetImageMemoryRequirements
+struct AttachmentMemory
+{
+	VkDeviceSize size;
+	VkDeviceSize alignment;
+	uint32_t typeBits;
+	//a lazily allocated type fits the image
+	bool lazy;
+};
+
+//where every attachment's memory comes from
+struct AttachmentPlan
+{
+	struct Placement
+	{
+		bool transient;
+		bool lazy;
+		uint32_t heap;
+		VkDeviceSize offset;
+	};
+	std::vector<Placement> placements;
+	//one allocation each, shared by the attachments placed in it
+	std::vector<VkDeviceSize> heaps;
+	std::vector<uint32_t> heapTypeBits;
+	//one allocation per attachment, what the pool saves against
+	VkDeviceSize dedicated = 0;
+	VkDeviceSize allocated = 0;
+	//left to lazily allocated memory, tile memory on tilers
+	VkDeviceSize lazy = 0;
+};
+
+//images of the render targets the renderer owns. attachments only used
+//within the frame are TRANSIENT and go to lazily allocated memory where the
+//device has it, otherwise targets whose passes do not overlap share memory.
+//the render graph has to know about shared memory, see RenderGraph::aliases
+class AttachmentPool
+{
+public:
+	AttachmentPool(VulkanDevice* vulkanDevice);
+	~AttachmentPool();
+
+	//aliasOf of an attachment with memory of its own
+	static const uint32_t NO_ALIAS = ~0U;
+
+	bool transient = true;
+	bool aliasing = true;
+
+	uint32_t add(const AttachmentDesc &desc);
+	AttachmentDesc& desc(uint32_t attachment) { return m_descs[attachment]; }
+	//images and memory of every attachment, after release again with new extents
+	void build();
+	void release();
+	VkImage image(uint32_t attachment) const { return m_images[attachment]; }
+	//the attachment shares memory with one that is done before it starts
+	uint32_t aliasOf(uint32_t attachment) const;
+	const AttachmentPlan& plan() const { return m_plan; }
+	//memory of the last build against one allocation per attachment
+	void report() const;
+
+	//attachment usage only and never kept for another frame
+	static bool isTransient(const AttachmentDesc &desc);
+	static AttachmentPlan plan(const std::vector<AttachmentDesc> &descs, const std::vector<AttachmentMemory> &memory,
+		bool transient, bool aliasing);
+	static uint32_t aliasOf(const std::vector<AttachmentDesc> &descs, const AttachmentPlan &plan, uint32_t attachment);
+
+private:
+	VulkanDevice* m_vulkanDevice;
+	VkDevice m_device;
+	std::vector<AttachmentDesc> m_descs;
+	std::vector<VkImage> m_images;
+	std::vector<VkDeviceMemory> m_memory;
+	AttachmentPlan m_plan;
+};
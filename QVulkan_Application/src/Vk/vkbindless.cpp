@@ -0,0 +1,100 @@
+#include "vkbindless.h"
+#include <vkdevice.h>
+#include <vkextensions.h>
+#include <algorithm>
+
+BindlessTable::BindlessTable(VulkanDevice* vulkanDevice, uint32_t reserved)
+	: m_device(vulkanDevice->m_device)
+{
+	const VkPhysicalDeviceLimits &limits = vulkanDevice->m_properties.limits;
+	uint32_t limit = std::min(std::min(limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages),
+		std::min(limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages));
+	m_capacity = std::min(MAX_SLOTS, limit > reserved ? limit - reserved : 1U);
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = m_capacity;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	//empty slots are never read, slots can change under recorded command buffers
+	VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	flagsInfo.bindingCount = 1;
+	flagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	LOG_ERROR("failed to create bindless descriptor set layout") <<
+		vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout);
+
+	//a pool of its own, update after bind sets need the flag on their pool
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_capacity };
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = 1;
+	LOG_ERROR("failed to create bindless descriptor pool") <<
+		vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool);
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_pool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &layout;
+	LOG_ERROR("failed to allocate bindless descriptor set") <<
+		vkAllocateDescriptorSets(m_device, &allocateInfo, &set);
+
+	LOG << "bindless texture table : " << m_capacity << " slots" << ENDL;
+}
+
+BindlessTable::~BindlessTable()
+{
+	vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, layout, nullptr);
+}
+
+uint32_t BindlessTable::add(const VkDescriptorImageInfo &image)
+{
+	uint32_t slot;
+	if (!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else if (m_next < m_capacity)
+		slot = m_next++;
+	else
+	{
+		LOG_WARN("bindless texture table is full");
+		return m_capacity;
+	}
+	write(slot, image);
+	return slot;
+}
+
+void BindlessTable::write(uint32_t slot, const VkDescriptorImageInfo &image)
+{
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 0;
+	write.dstArrayElement = slot;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &image;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+void BindlessTable::remove(uint32_t slot)
+{
+	m_freeSlots.push_back(slot);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <stdint.h>
+
+class VulkanDevice;
+
+//one set holding a large partially bound, update after bind array of
+//combined image samplers at binding 0. textures take a slot and draws
+//pick theirs with a push constant, so draws with different textures
+//share every bind. needs VulkanDevice::m_descriptorIndexing
+class BindlessTable
+{
+public:
+	static const uint32_t MAX_SLOTS = 4096;
+
+	//slots are capped by the device's sampler limits, minus reserved
+	//samplers other sets of the same pipeline layout use
+	BindlessTable(VulkanDevice* vulkanDevice, uint32_t reserved = 0);
+	~BindlessTable();
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	//a free slot written with image, or capacity when the table is full
+	uint32_t add(const VkDescriptorImageInfo &image);
+	//valid while recorded command buffers use the set, not while they run
+	void write(uint32_t slot, const VkDescriptorImageInfo &image);
+	//the slot is left as it is, partially bound lets draws skip it
+	void remove(uint32_t slot);
+
+	uint32_t capacity() const { return m_capacity; }
+	uint32_t count() const { return m_next - (uint32_t)m_freeSlots.size(); }
+
+private:
+	VkDevice m_device;
+	VkDescriptorPool m_pool = VK_NULL_HANDLE;
+	uint32_t m_capacity = 0;
+	uint32_t m_next = 0;
+	std::vector<uint32_t> m_freeSlots;
+};
@@ -0,0 +1,337 @@
+#include "vkdescriptor.h"
+#include <vkextensions.h>
+#include <vklog.h>
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	//descriptors of each type a page holds per set
+	const struct { VkDescriptorType type; float perSet; } POOL_RATIOS[] = {
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f },
+	};
+
+	bool isImage(VkDescriptorType type)
+	{
+		return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+			type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+			type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	}
+
+	void sortBindings(std::vector<VkDescriptorSetLayoutBinding> &bindings)
+	{
+		std::sort(bindings.begin(), bindings.end(),
+			[](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b)
+		{
+			return a.binding < b.binding;
+		});
+	}
+}
+
+size_t DescriptorKeyHash::operator()(const DescriptorKey &key) const
+{
+	//fnv-1a over the words
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint64_t word : key)
+	{
+		hash ^= word;
+		hash *= 1099511628211ULL;
+	}
+	return (size_t)hash;
+}
+
+/*LAYOUT CACHE*/
+DescriptorLayoutCache::DescriptorLayoutCache(VkDevice device)
+	: m_device(device)
+{
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache()
+{
+	for (auto &layout : m_layouts)
+		vkDestroyDescriptorSetLayout(m_device, layout.second, nullptr);
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::get(const VkDescriptorSetLayoutBinding *bindings, uint32_t count)
+{
+	std::vector<VkDescriptorSetLayoutBinding> sorted(bindings, bindings + count);
+	sortBindings(sorted);
+
+	DescriptorKey key;
+	key.reserve(count * 4);
+	for (const VkDescriptorSetLayoutBinding &binding : sorted)
+	{
+		key.push_back(binding.binding);
+		key.push_back(binding.descriptorType);
+		key.push_back(binding.descriptorCount);
+		key.push_back(binding.stageFlags);
+		//immutable samplers are part of the layout
+		if (binding.pImmutableSamplers)
+			for (uint32_t i = 0; i < binding.descriptorCount; ++i)
+				key.push_back((uint64_t)binding.pImmutableSamplers[i]);
+	}
+
+	auto found = m_layouts.find(key);
+	if (found != m_layouts.end())
+		return found->second;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = count;
+	layoutInfo.pBindings = sorted.data();
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	LOG_ERROR("failed to create descriptor set layout") <<
+		vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout);
+	m_layouts[key] = layout;
+	return layout;
+}
+
+/*ALLOCATOR*/
+DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t pageSets)
+	: m_device(device), m_pageSets(std::max(pageSets, 1U))
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+	for (Page &page : m_pages)
+		vkDestroyDescriptorPool(m_device, page.pool, nullptr);
+}
+
+void DescriptorAllocator::nextPage()
+{
+	if (!m_pages.empty())
+		++m_current;
+	if (m_current < m_pages.size())
+		return;
+
+	uint32_t capacity = m_pages.empty() ? m_pageSets : std::min(m_pages.back().capacity * 2, MAX_PAGE_SETS);
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto &ratio : POOL_RATIOS)
+	{
+		VkDescriptorPoolSize poolSize;
+		poolSize.type = ratio.type;
+		poolSize.descriptorCount = std::max((uint32_t)ceilf(ratio.perSet * capacity), 1U);
+		poolSizes.push_back(poolSize);
+	}
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = capacity;
+
+	Page page = { VK_NULL_HANDLE, capacity, 0 };
+	LOG_ERROR("failed to create descriptor pool") <<
+		vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &page.pool);
+	m_pages.push_back(page);
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	if (m_pages.empty() || m_pages[m_current].sets == m_pages[m_current].capacity)
+		nextPage();
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	allocateInfo.descriptorPool = m_pages[m_current].pool;
+	VkResult result = vkAllocateDescriptorSets(m_device, &allocateInfo, &set);
+	//the page is out of one descriptor type, a fresh one has room
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		nextPage();
+		allocateInfo.descriptorPool = m_pages[m_current].pool;
+		result = vkAllocateDescriptorSets(m_device, &allocateInfo, &set);
+	}
+	LOG_ERROR("failed to allocate descriptor set") << result;
+
+	m_pages[m_current].sets++;
+	m_sets++;
+	return set;
+}
+
+void DescriptorAllocator::reset()
+{
+	for (uint32_t i = 0; i < m_pages.size() && i <= m_current; ++i)
+	{
+		LOG_ERROR("failed to reset descriptor pool") <<
+			vkResetDescriptorPool(m_device, m_pages[i].pool, 0);
+		m_pages[i].sets = 0;
+	}
+	m_current = 0;
+	m_sets = 0;
+}
+
+/*SET CACHE*/
+DescriptorResource DescriptorResource::ofBuffer(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages,
+	VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	DescriptorResource resource = {};
+	resource.binding = binding;
+	resource.type = type;
+	resource.stages = stages;
+	resource.buffer.buffer = buffer;
+	resource.buffer.offset = offset;
+	resource.buffer.range = range;
+	return resource;
+}
+
+DescriptorResource DescriptorResource::ofImage(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages,
+	const VkDescriptorImageInfo &image)
+{
+	DescriptorResource resource = {};
+	resource.binding = binding;
+	resource.type = type;
+	resource.stages = stages;
+	resource.image = image;
+	return resource;
+}
+
+DescriptorCache::DescriptorCache(VkDevice device, DescriptorLayoutCache &layouts, DescriptorAllocator &allocator)
+	: m_device(device), m_layouts(layouts), m_allocator(allocator)
+{
+}
+
+VkDescriptorSetLayout DescriptorCache::layout(const DescriptorResource *resources, uint32_t count)
+{
+	std::vector<VkDescriptorSetLayoutBinding> bindings(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		bindings[i] = {};
+		bindings[i].binding = resources[i].binding;
+		bindings[i].descriptorType = resources[i].type;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = resources[i].stages;
+	}
+	return m_layouts.get(bindings.data(), count);
+}
+
+VkDescriptorSet DescriptorCache::get(const DescriptorResource *resources, uint32_t count)
+{
+	VkDescriptorSetLayout setLayout = layout(resources, count);
+
+	DescriptorKey key;
+	key.reserve(1 + count * 5);
+	key.push_back((uint64_t)setLayout);
+	std::vector<const DescriptorResource*> sorted(count);
+	for (uint32_t i = 0; i < count; ++i)
+		sorted[i] = &resources[i];
+	std::sort(sorted.begin(), sorted.end(), [](const DescriptorResource *a, const DescriptorResource *b)
+	{
+		return a->binding < b->binding;
+	});
+	for (const DescriptorResource *resource : sorted)
+	{
+		key.push_back(resource->binding);
+		if (isImage(resource->type))
+		{
+			key.push_back((uint64_t)resource->image.sampler);
+			key.push_back((uint64_t)resource->image.imageView);
+			key.push_back(resource->image.imageLayout);
+		}
+		else
+		{
+			key.push_back((uint64_t)resource->buffer.buffer);
+			key.push_back(resource->buffer.offset);
+			key.push_back(resource->buffer.range);
+		}
+	}
+
+	auto found = m_sets.find(key);
+	if (found != m_sets.end())
+	{
+		hits++;
+		found->second.references++;
+		return found->second.set;
+	}
+	misses++;
+
+	//a released set of the layout is cheaper than a new one
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> &free = m_free[(uint64_t)setLayout];
+	if (!free.empty())
+	{
+		set = free.back();
+		free.pop_back();
+	}
+	else
+		set = m_allocator.allocate(setLayout);
+
+	std::vector<VkWriteDescriptorSet> writes(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		writes[i] = {};
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = set;
+		writes[i].dstBinding = resources[i].binding;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = resources[i].type;
+		if (isImage(resources[i].type))
+			writes[i].pImageInfo = &resources[i].image;
+		else
+			writes[i].pBufferInfo = &resources[i].buffer;
+	}
+	vkUpdateDescriptorSets(m_device, count, writes.data(), 0, nullptr);
+
+	Entry entry = { set, 1 };
+	m_sets[key] = entry;
+	m_keys[(uint64_t)set] = key;
+	return set;
+}
+
+void DescriptorCache::release(VkDescriptorSet set)
+{
+	auto key = m_keys.find((uint64_t)set);
+	if (key == m_keys.end())
+		return;
+	auto forgotten = m_forgotten.find((uint64_t)set);
+	if (forgotten != m_forgotten.end())
+	{
+		if (--forgotten->second)
+			return;
+		m_forgotten.erase(forgotten);
+	}
+	else
+	{
+		auto found = m_sets.find(key->second);
+		if (--found->second.references)
+			return;
+		m_sets.erase(found);
+	}
+	//the layout leads the key
+	m_free[key->second[0]].push_back(set);
+	m_keys.erase(key);
+}
+
+void DescriptorCache::forget(VkImageView view)
+{
+	//binding, sampler or buffer, view or offset, layout or range after the layout.
+	//a buffer offset equal to the handle only costs a miss
+	for (auto it = m_sets.begin(); it != m_sets.end();)
+	{
+		const DescriptorKey &key = it->first;
+		bool uses = false;
+		for (size_t i = 3; i < key.size() && !uses; i += 4)
+			uses = key[i] == (uint64_t)view;
+		if (uses)
+		{
+			m_forgotten[(uint64_t)it->second.set] = it->second.references;
+			it = m_sets.erase(it);
+		}
+		else
+			++it;
+	}
+}
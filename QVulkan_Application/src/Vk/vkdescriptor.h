@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+//flattened bindings or resources, compared whole after the hash matched
+typedef std::vector<uint64_t> DescriptorKey;
+struct DescriptorKeyHash
+{
+	size_t operator()(const DescriptorKey &key) const;
+};
+
+//descriptor set layouts by their bindings, destroyed with the cache
+class DescriptorLayoutCache
+{
+public:
+	DescriptorLayoutCache(VkDevice device);
+	~DescriptorLayoutCache();
+
+	//order of the bindings does not matter, equal bindings share one layout
+	VkDescriptorSetLayout get(const VkDescriptorSetLayoutBinding *bindings, uint32_t count);
+	size_t size() const { return m_layouts.size(); }
+
+private:
+	VkDevice m_device;
+	std::unordered_map<DescriptorKey, VkDescriptorSetLayout, DescriptorKeyHash> m_layouts;
+};
+
+//sets from pools taken in pages. a page that runs out is left behind and
+//the next one, twice as large up to MAX_PAGE_SETS, takes over. reset
+//returns every set at once and keeps the pages, what a per frame or per
+//resize allocator does instead of freeing sets one by one
+class DescriptorAllocator
+{
+public:
+	static const uint32_t MAX_PAGE_SETS = 4096;
+
+	DescriptorAllocator(VkDevice device, uint32_t pageSets = 64);
+	~DescriptorAllocator();
+
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+	//every set allocated so far is invalid afterwards
+	void reset();
+
+	uint32_t pageCount() const { return (uint32_t)m_pages.size(); }
+	uint32_t setCount() const { return m_sets; }
+
+private:
+	struct Page
+	{
+		VkDescriptorPool pool;
+		uint32_t capacity;
+		uint32_t sets;
+	};
+	//the page after m_current, a reset one or a new larger one
+	void nextPage();
+
+	VkDevice m_device;
+	uint32_t m_pageSets;
+	//pages past m_current are reset and wait for reuse
+	std::vector<Page> m_pages;
+	uint32_t m_current = 0;
+	uint32_t m_sets = 0;
+};
+
+//one binding of a set and what it points at
+struct DescriptorResource
+{
+	uint32_t binding;
+	VkDescriptorType type;
+	VkShaderStageFlags stages;
+	VkDescriptorBufferInfo buffer;
+	VkDescriptorImageInfo image;
+
+	static DescriptorResource ofBuffer(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages,
+		VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	static DescriptorResource ofImage(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages,
+		const VkDescriptorImageInfo &image);
+};
+
+//sets written once and looked up by their layout and resources, materials
+//with the same textures share one set. a set whose resources go away is
+//released and written again by the next miss with the same layout
+class DescriptorCache
+{
+public:
+	DescriptorCache(VkDevice device, DescriptorLayoutCache &layouts, DescriptorAllocator &allocator);
+
+	VkDescriptorSetLayout layout(const DescriptorResource *resources, uint32_t count);
+	VkDescriptorSet get(const DescriptorResource *resources, uint32_t count);
+	//one get less of the set, at none it is free for reuse
+	void release(VkDescriptorSet set);
+	//no later get returns a set written with view, call before destroying
+	//it. a new view may get the old handle back. the sets stay valid until
+	//released
+	void forget(VkImageView view);
+
+	size_t size() const { return m_sets.size(); }
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+
+private:
+	struct Entry
+	{
+		VkDescriptorSet set;
+		uint32_t references;
+	};
+
+	VkDevice m_device;
+	DescriptorLayoutCache &m_layouts;
+	DescriptorAllocator &m_allocator;
+	std::unordered_map<DescriptorKey, Entry, DescriptorKeyHash> m_sets;
+	//set handle to its key, for release
+	std::unordered_map<uint64_t, DescriptorKey> m_keys;
+	//released sets by layout handle
+	std::unordered_map<uint64_t, std::vector<VkDescriptorSet>> m_free;
+	//forgotten sets still held, references by set handle
+	std::unordered_map<uint64_t, uint32_t> m_forgotten;
+};
@@ -1,4 +1,5 @@
 #include <vkdevice.h>
+#include <vkstaging.h>
 
 
 
@@ -11,6 +12,7 @@ VulkanDevice::VulkanDevice(VkInstance &instance, VkDevice &device, VkPhysicalDev
 
 VulkanDevice::~VulkanDevice()
 {
+	SAFE_DELETE(m_stagingBuffer);
 	if (m_commandPool) {
 		vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 	}
@@ -62,6 +64,25 @@ void VulkanDevice::buildPhysicalDevice()
 		}
 	}
 
+	/*DESCRIPTOR INDEXING*/
+	//the features can only be asked for through VK_KHR_get_physical_device_properties2
+	auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)
+		vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR");
+	if (getFeatures2 && extensionSupported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+		extensionSupported(VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing{};
+		indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2KHR features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		features.pNext = &indexing;
+		getFeatures2(m_physicalDevice, &features);
+		m_descriptorIndexing = indexing.descriptorBindingPartiallyBound &&
+			indexing.descriptorBindingSampledImageUpdateAfterBind && indexing.runtimeDescriptorArray &&
+			m_features.shaderSampledImageArrayDynamicIndexing;
+	}
+	LOG << "descriptor indexing : " << (m_descriptorIndexing ? "supported" : "not supported") << ENDL;
+
 }
 
 void VulkanDevice::buildLogicalDevice(
@@ -146,8 +167,23 @@ void VulkanDevice::buildLogicalDevice(
 		deviceExtensions.push_back(VK_NV_GLSL_SHADER_EXTENSION_NAME);
 	}
 
+	//only what the bindless texture table uses
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (m_descriptorIndexing)
+	{
+		deviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+		indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+		//draws index the table with a push constant, dynamically uniform
+		enabledFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+	}
+
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.pNext = m_descriptorIndexing ? &indexingFeatures : NULL;
 	deviceCreateInfo.queueCreateInfoCount =
 		static_cast<uint32_t>(queueCreateInfos.size());;
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -183,34 +219,48 @@ void VulkanDevice::getGraphicsQueue(VkQueue *queue)
 	vkGetDeviceQueue(m_device, m_queueFamilyIndices.graphics, 0, &m_queue);
 }
 
-VkBool32 VulkanDevice::getSupportedDepthFormat(VkFormat *depthFormat)
+VkBool32 VulkanDevice::getSupportedDepthFormat(VkFormat *depthFormat, uint32_t depthBits, bool stencil, bool sampled)
 {
-	// Since all depth formats may be optional, we need to find a suitable depth format to use
-	// Start with the highest precision packed format
-	std::vector<VkFormat> depthFormats = {
-		VK_FORMAT_D32_SFLOAT_S8_UINT,
-		VK_FORMAT_D32_SFLOAT,
-		VK_FORMAT_D24_UNORM_S8_UINT,
-		VK_FORMAT_D16_UNORM_S8_UINT,
-		VK_FORMAT_D16_UNORM
+	//smallest texel first, the more precise format of two the same size first.
+	//stencil planes only cost bandwidth when nothing tests against them
+	struct Candidate { VkFormat format; uint32_t bits; bool stencil; };
+	const Candidate candidates[] = {
+		{ VK_FORMAT_D16_UNORM, 16, false },
+		{ VK_FORMAT_D16_UNORM_S8_UINT, 16, true },
+		{ VK_FORMAT_D32_SFLOAT, 32, false },
+		{ VK_FORMAT_X8_D24_UNORM_PACK32, 24, false },
+		{ VK_FORMAT_D24_UNORM_S8_UINT, 24, true },
+		{ VK_FORMAT_D32_SFLOAT_S8_UINT, 32, true },
 	};
 
-	for (auto& format : depthFormats)
-	{
-		VkFormatProperties formatProps;
-		vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProps);
-		// Format must support depth stencil attachment for optimal tiling
-		if (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+	//a format that can not be sampled is still better than none, the caller checks
+	for (int pass = sampled ? 0 : 1; pass < 2; ++pass)
+		for (const Candidate &candidate : candidates)
 		{
-			*depthFormat = format;
-			return true;
+			if (candidate.bits < depthBits || (stencil && !candidate.stencil))
+				continue;
+			VkFormatProperties formatProps;
+			vkGetPhysicalDeviceFormatProperties(m_physicalDevice, candidate.format, &formatProps);
+			VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+				(pass == 0 ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0);
+			if ((formatProps.optimalTilingFeatures & needed) == needed)
+			{
+				*depthFormat = candidate.format;
+				return true;
+			}
 		}
-	}
 
 	return false;
 }
 
 
+VulkanStagingBuffer* VulkanDevice::stagingBuffer()
+{
+	if (!m_stagingBuffer)
+		m_stagingBuffer = new VulkanStagingBuffer(this);
+	return m_stagingBuffer;
+}
+
 void VulkanDevice::createBuffer(
 	VkBufferUsageFlags usage,
 	VkMemoryPropertyFlags properties,
@@ -4,7 +4,9 @@
 #include <vector>
 #include <vktools.h>
 #include <vkinitializer.h>
+#include <vkextensions.h>
 
+class VulkanStagingBuffer;
 struct QueueFamilyIndice
 {
 	uint32_t graphics;
@@ -27,6 +29,9 @@ public:
 	VkPhysicalDeviceMemoryProperties m_memoryProperties;
 	std::vector<VkQueueFamilyProperties> m_queueFamilyProperties;
 	std::vector<std::string> m_supportedExtensions;
+	//partially bound, update after bind sampled image arrays of any size,
+	//found by buildPhysicalDevice and enabled by buildLogicalDevice
+	bool m_descriptorIndexing = false;
 
 	//instance queue for logical device
 	VkQueue m_queue;
@@ -35,6 +40,10 @@ public:
 	QueueFamilyIndice m_queueFamilyIndices;
 	VkCommandPool m_commandPool;
 
+	//shared persistently mapped upload buffer
+	VulkanStagingBuffer* m_stagingBuffer = NULL;
+	VulkanStagingBuffer* stagingBuffer();
+
 
 	void buildPhysicalDevice();
 	void buildLogicalDevice(
@@ -44,7 +53,10 @@ public:
 
 	bool extensionSupported(std::string extension);
 	void getGraphicsQueue(VkQueue *queue);
-	VkBool32 getSupportedDepthFormat(VkFormat *depthFormat);
+	//the smallest format with depthBits of precision, a stencil plane only when
+	//asked for, sampled for depth that is read back in a shader
+	VkBool32 getSupportedDepthFormat(VkFormat *depthFormat, uint32_t depthBits = 24,
+		bool stencil = false, bool sampled = false);
 
 	/*BUILT IN*/
 	uint32_t getQueueFamilyIndex(VkQueueFlagBits queueFlags);
@@ -1,4 +1,6 @@
 #include <vkinstance.h>
+#include <vkextensions.h>
+#include <string.h>
 #include <iostream>
 #include <qwindow.h>
 
@@ -35,6 +37,15 @@ void VulkanInstance::buildLayers()
 	if (enableValidation)
 		m_extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 
+	//device features beyond 1.0, VulkanDevice looks for descriptor indexing with it
+	uint32_t extCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extCount, extensions.data());
+	for (auto &ext : extensions)
+		if (!strcmp(ext.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+			m_extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
 }
 
 void VulkanInstance::buildInstance()
@@ -0,0 +1,45 @@
+#include "vkstaging.h"
+#include <vkdevice.h>
+
+VulkanStagingBuffer::VulkanStagingBuffer(VulkanDevice* vulkanDevice)
+	: vulkanDevice(vulkanDevice)
+{
+}
+
+VulkanStagingBuffer::~VulkanStagingBuffer()
+{
+	release();
+}
+
+uint8_t* VulkanStagingBuffer::reserve(VkDeviceSize size)
+{
+	if (size <= capacity)
+		return mapped;
+
+	release();
+	//round up to 1MB so small uploads dont reallocate every time
+	capacity = (size + 0xFFFFF) & ~VkDeviceSize(0xFFFFF);
+
+	vulkanDevice->createBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		buffer,
+		memory,
+		capacity);
+
+	LOG_ERROR("failed to map staging buffer") <<
+	vkMapMemory(vulkanDevice->m_device, memory, 0, VK_WHOLE_SIZE, 0, (void**)&mapped);
+	LOG << "staging buffer size : " << capacity << ENDL;
+	return mapped;
+}
+
+void VulkanStagingBuffer::release()
+{
+	if (!buffer) return;
+	vkUnmapMemory(vulkanDevice->m_device, memory);
+	vulkanDevice->destroyBuffer(buffer, memory);
+	buffer = VK_NULL_HANDLE;
+	memory = VK_NULL_HANDLE;
+	mapped = nullptr;
+	capacity = 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+
+class VulkanDevice;
+
+//host visible upload buffer that stays mapped for its whole lifetime
+//so loader threads can write into it directly
+class VulkanStagingBuffer
+{
+public:
+	VulkanStagingBuffer(VulkanDevice* vulkanDevice);
+	~VulkanStagingBuffer();
+
+	VulkanDevice* vulkanDevice;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize capacity = 0;
+	uint8_t* mapped = nullptr;
+
+	//grow only, previous contents are discarded when it grows
+	uint8_t* reserve(VkDeviceSize size);
+	void release();
+};
@@ -226,7 +226,11 @@ void VulkanSwapchain::buildSwapchain(uint32_t *width, uint32_t *height, bool vsy
 	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, m_colorFormat, &formatProps);
 	if (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) {
 		swapchainCI.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		// and into them, the dynamic resolution of VkRenderer upscales with a blit
+		if (surfCaps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+			swapchainCI.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 	}
+	m_imageUsage = swapchainCI.imageUsage;
 
 	err = vkCreateSwapchainKHR(m_device, &swapchainCI, nullptr, &m_swapchain);
 	assert(!err);
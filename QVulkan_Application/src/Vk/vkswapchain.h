@@ -27,6 +27,8 @@ public:
 	VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
 
 	uint32_t m_imageCount;
+	//what the images were created for, transfers only where the format allows blits
+	VkImageUsageFlags m_imageUsage = 0;
 
 	std::vector<VkImage> m_images;
 	std::vector<SwapChainBuffer> m_buffers;
@@ -0,0 +1,1510 @@
+#include "benchmark.h"
+#include <vklog.h>
+#include <matrix4x4.h>
+#include <vec3soa.h>
+#include <frustum.h>
+#include <bvh.h>
+#include <scenegraph.h>
+#include <occlusionbuffer.h>
+#include <simplify.h>
+#include <meshlet.h>
+#include <renderqueue.h>
+#include <rendergraph.h>
+#include <vkattachment.h>
+#include <dynamicresolution.h>
+#include <threadpool.h>
+#include <simd.h>
+#include <tiny_obj_loader.h>
+#include <vector>
+#include <random>
+#include <map>
+#include <tuple>
+#include <iomanip>
+#include <string.h>
+
+namespace benchmark
+{
+namespace
+{
+	const char* simdName()
+	{
+#if VML_SIMD == VML_SIMD_AVX
+		return "AVX";
+#elif VML_SIMD == VML_SIMD_SSE
+		return "SSE";
+#elif VML_SIMD == VML_SIMD_NEON
+		return "NEON";
+#else
+		return "scalar";
+#endif
+	}
+
+	int simdWidth()
+	{
+#if VML_SIMD == VML_SIMD_NONE
+		return 1;
+#else
+		return sizeof(simd::floatN) / sizeof(float);
+#endif
+	}
+
+	Matrix4x4 randomMatrix(std::mt19937 &rng, bool affine)
+	{
+		std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+		Matrix4x4 M;
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				M[i][j] = dist(rng);
+		if (affine) {
+			M[3][0] = M[3][1] = M[3][2] = 0.0f;
+			M[3][3] = 1.0f;
+		}
+		return M;
+	}
+
+	//relative to the reference magnitude, absolute below one
+	double maxError(const Matrix4x4 &a, const Matrix4x4 &b)
+	{
+		double error = 0.0;
+		for (int i = 0; i < 16; ++i)
+		{
+			double ref = b.constData()[i];
+			double e = fabs(a.constData()[i] - ref) / std::max(1.0, fabs(ref));
+			error = std::max(error, e);
+		}
+		return error;
+	}
+
+	bool isZero(const Matrix4x4 &m)
+	{
+		for (int i = 0; i < 16; ++i)
+			if (m.constData()[i] != 0.0f) return false;
+		return true;
+	}
+
+	/*MATRIX KERNELS*/
+	bool benchMatrix()
+	{
+		LOG_SECTION("matrix4x4 kernels");
+		LOG << "instruction set : " << simdName() << ENDL;
+
+		const uint32_t count = 4096;
+		std::mt19937 rng(7);
+		std::vector<Matrix4x4> a(count), b(count), affine(count), out(count);
+		std::vector<vec3f> points(count);
+		std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			a[i] = randomMatrix(rng, false);
+			b[i] = randomMatrix(rng, false);
+			affine[i] = randomMatrix(rng, true);
+			points[i] = vec3f(dist(rng), dist(rng), dist(rng));
+		}
+
+		//multiply, transpose and transform are the same operations in the same
+		//order so they must match bit for bit. the inverses only need to agree
+		//to float precision, ill conditioned inputs that either side rejects are skipped
+		double mulError = 0.0, transposeError = 0.0, vecError = 0.0;
+		double inverseError = 0.0, affineError = 0.0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			mulError = std::max(mulError, maxError(a[i] * b[i], vml::scalar::multiply(a[i], b[i])));
+			transposeError = std::max(transposeError, maxError(a[i].transposed(), vml::scalar::transposed(a[i])));
+			vec3f p = a[i] * points[i];
+			vec3f q = vml::scalar::transform(a[i], points[i]);
+			vecError = std::max(vecError, (double)(p - q).length());
+
+			Matrix4x4 inv = a[i].inverted();
+			Matrix4x4 ref = vml::scalar::inverted(a[i]);
+			if (!isZero(inv) && !isZero(ref) && fabs(ref[0][0]) < 1e3f)
+				inverseError = std::max(inverseError, maxError(inv, ref));
+
+			//affine inverse against the general one
+			Matrix4x4 affineInv = affine[i].invertedAffine();
+			Matrix4x4 affineRef = vml::scalar::inverted(affine[i]);
+			if (!isZero(affineInv) && !isZero(affineRef) && fabs(affineRef[0][0]) < 1e3f)
+				affineError = std::max(affineError, maxError(affineInv, affineRef));
+		}
+		bool passed = true;
+		passed &= check("multiply", mulError, 0.0);
+		passed &= check("transpose", transposeError, 0.0);
+		passed &= check("matrix * vec3f", vecError, 0.0);
+		passed &= check("inverse", inverseError, 1e-3);
+		passed &= check("affine inverse", affineError, 1e-3);
+
+		const uint32_t repeat = 200;
+		report("multiply",
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = vml::scalar::multiply(a[i], b[i]); }) / count,
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = a[i] * b[i]; }) / count);
+		consume(out.data(), sizeof(Matrix4x4) * count);
+
+		report("transpose",
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = vml::scalar::transposed(a[i]); }) / count,
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = a[i].transposed(); }) / count);
+		consume(out.data(), sizeof(Matrix4x4) * count);
+
+		report("inverse",
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = vml::scalar::inverted(a[i]); }) / count,
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = a[i].inverted(); }) / count);
+		consume(out.data(), sizeof(Matrix4x4) * count);
+
+		report("affine inverse",
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = vml::scalar::invertedAffine(affine[i]); }) / count,
+			measure(repeat, [&] { for (uint32_t i = 0; i < count; ++i) out[i] = affine[i].invertedAffine(); }) / count);
+		consume(out.data(), sizeof(Matrix4x4) * count);
+
+		return passed;
+	}
+
+	double maxError(const vec3soa &a, const vec3soa &b)
+	{
+		double error = 0.0;
+		for (size_t i = 0; i < a.size(); ++i)
+			error = std::max(error, (double)(a.get(i) - b.get(i)).length());
+		return error;
+	}
+
+	/*BATCH TRANSFORMS*/
+	bool benchTransform()
+	{
+		LOG_SECTION("batch vec3 transforms");
+		LOG << "instruction set : " << simdName() << " (" << simdWidth() << " wide)" << ENDL;
+
+		//the sphinx is the largest model that ships with the app
+		vec3soa positions, normals;
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string err;
+		if (tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "./model/sphinx.obj"))
+		{
+			positions.assign((const vec3f*)attrib.vertices.data(), attrib.vertices.size() / 3);
+			normals.assign((const vec3f*)attrib.normals.data(), attrib.normals.size() / 3);
+		}
+		else
+		{
+			LOG_WARN("sphinx.obj not found, using random points");
+			std::mt19937 rng(3);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			positions.resize(20814);
+			normals.resize(18107);
+			for (size_t i = 0; i < positions.size(); ++i)
+				positions.set(i, vec3f(dist(rng), dist(rng), dist(rng)));
+			for (size_t i = 0; i < normals.size(); ++i)
+				normals.set(i, vec3f(dist(rng), dist(rng), dist(rng)).normalized());
+		}
+		LOG << "positions : " << positions.size() << " normals : " << normals.size() << ENDL;
+
+		std::mt19937 rng(11);
+		Matrix4x4 M;
+		M.translate(vec3f(1.0f, -2.0f, 3.0f));
+		M.rotate(AXIS::Y, 35.0f);
+		M.scale(vec3f(0.5f, 1.5f, 2.0f));
+		Matrix4x4 N = M.invertedAffine().transposed();
+		std::vector<Matrix4x4> instances(positions.size());
+		for (auto &instance : instances)
+			instance = randomMatrix(rng, true);
+
+		vec3soa out, ref;
+		vec3f bmin, bmax, rmin, rmax;
+		bool passed = true;
+		vml::transformPoints(M, positions, out);
+		vml::scalar::transformPoints(M, positions, ref);
+		passed &= check("points", maxError(out, ref), 0.0);
+		vml::transformNormals(N, normals, out);
+		vml::scalar::transformNormals(N, normals, ref);
+		passed &= check("normals", maxError(out, ref), 0.0);
+		vml::transformInstances(instances.data(), positions, out);
+		vml::scalar::transformInstances(instances.data(), positions, ref);
+		passed &= check("instances", maxError(out, ref), 0.0);
+		vml::bounds(positions, bmin, bmax);
+		vml::scalar::bounds(positions, rmin, rmax);
+		passed &= check("bounds", std::max((bmin - rmin).length(), (bmax - rmax).length()), 0.0);
+
+		//ns per element
+		const uint32_t repeat = 100;
+		double count = (double)positions.size();
+		report("points",
+			measure(repeat, [&] { vml::scalar::transformPoints(M, positions, out); }) / count,
+			measure(repeat, [&] { vml::transformPoints(M, positions, out); }) / count);
+		consume(out.x.data(), out.size() * sizeof(float));
+
+		report("normals",
+			measure(repeat, [&] { vml::scalar::transformNormals(N, normals, out); }) / normals.size(),
+			measure(repeat, [&] { vml::transformNormals(N, normals, out); }) / normals.size());
+		consume(out.x.data(), out.size() * sizeof(float));
+
+		report("instances",
+			measure(repeat, [&] { vml::scalar::transformInstances(instances.data(), positions, out); }) / count,
+			measure(repeat, [&] { vml::transformInstances(instances.data(), positions, out); }) / count);
+		consume(out.x.data(), out.size() * sizeof(float));
+
+		report("bounds",
+			measure(repeat, [&] { vml::scalar::bounds(positions, bmin, bmax); }) / count,
+			measure(repeat, [&] { vml::bounds(positions, bmin, bmax); }) / count);
+		consume(&bmin, sizeof(bmin));
+
+		return passed;
+	}
+
+	//thousands of copies of one mesh scattered around the camera, each with
+	//its own rotation and scale, in world space the way Scene keeps them
+	std::vector<Bounds> scatterInstances(uint32_t count)
+	{
+		Bounds local(vec3f(-1.0f, -0.5f, -1.5f), vec3f(1.0f, 1.5f, 1.5f));
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 3.0f);
+		std::vector<Bounds> world(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			Matrix4x4 M;
+			M.translate(vec3f(position(rng), position(rng), position(rng)));
+			M.rotate(AXIS::Y, angle(rng));
+			M.scale(vec3f(scale(rng)));
+			world[i] = local.transformed(M);
+		}
+		return world;
+	}
+
+	Matrix4x4 benchViewProj()
+	{
+		Matrix4x4 proj = vml::perspective<vml::VulkanConvention>(45.0f, 16.0f / 9.0f, 0.1f, 300.0f);
+		Matrix4x4 view = vml::lookAt<vml::VulkanConvention>(vec3f(0.0f, 10.0f, 0.0f), vec3f(30.0f, 0.0f, -100.0f), vec3f(0.0f, 1.0f, 0.0f));
+		return proj * view;
+	}
+
+	Frustum benchFrustum()
+	{
+		Frustum frustum;
+		frustum.extract<vml::VulkanConvention>(benchViewProj());
+		return frustum;
+	}
+
+	/*FRUSTUM CULLING*/
+	bool benchCull()
+	{
+		LOG_SECTION("frustum culling");
+		LOG << "instruction set : " << simdName() << " (" << simdWidth() << " wide)" << ENDL;
+
+		const uint32_t count = 16384;
+		std::vector<Bounds> world = scatterInstances(count);
+		vec3soa centers(count);
+		std::vector<float> radii(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			centers.set(i, world[i].center);
+			radii[i] = world[i].radius;
+		}
+		Frustum frustum = benchFrustum();
+
+		std::vector<uint32_t> visible, reference;
+		vml::cull(frustum, centers, radii, visible);
+		vml::scalar::cull(frustum, centers, radii, reference);
+		bool passed = check("visible list", visible == reference ? 0.0 : 1.0, 0.0);
+
+		//the sphere test has to be conservative, nothing a corner test keeps may go
+		size_t boxVisible = 0, missed = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			bool inBox = frustum.contains(world[i]);
+			boxVisible += inBox;
+			missed += inBox && !std::binary_search(visible.begin(), visible.end(), i);
+		}
+		passed &= check("conservative", (double)missed, 0.0);
+
+		LOG << "meshes : " << count << " visible : " << visible.size()
+			<< " culled : " << std::fixed << std::setprecision(1)
+			<< 100.0 * (count - visible.size()) / count << "%"
+			<< " (box refine keeps " << boxVisible << ")" << ENDL;
+		LOG.unsetf(std::ios::floatfield);
+
+		const uint32_t repeat = 200;
+		report("cull ns / mesh",
+			measure(repeat, [&] { vml::scalar::cull(frustum, centers, radii, reference); }) / count,
+			measure(repeat, [&] { vml::cull(frustum, centers, radii, visible); }) / count);
+		consume(visible.data(), visible.size() * sizeof(uint32_t));
+		LOG << "whole scene : " << std::fixed << std::setprecision(1)
+			<< measure(repeat, [&] { vml::cull(frustum, centers, radii, visible); }) / 1000.0 << " us" << ENDL;
+		LOG.unsetf(std::ios::floatfield);
+
+		return passed;
+	}
+
+	/*BVH*/
+	struct BenchModel
+	{
+		std::string name;
+		std::vector<vec3f> positions;
+		std::vector<uint32_t> indices;
+		//per index, -1 without texture coordinates
+		std::vector<int> texcoordIndices;
+		std::vector<float> texcoords;
+		TriangleBvh bvh;
+	};
+
+	//every bundled model, positions only
+	std::vector<BenchModel> loadModels()
+	{
+		const char* names[] = { "box", "knot", "knot_s", "sphinx", "stone", "stone_f", "teapot" };
+		std::vector<BenchModel> models;
+		for (const char* name : names)
+		{
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			std::string err;
+			if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, (std::string("./model/") + name + ".obj").c_str()))
+				continue;
+			BenchModel model;
+			model.name = name;
+			model.positions.assign((const vec3f*)attrib.vertices.data(), (const vec3f*)attrib.vertices.data() + attrib.vertices.size() / 3);
+			model.texcoords = attrib.texcoords;
+			for (auto &shape : shapes)
+				for (auto &index : shape.mesh.indices)
+				{
+					model.indices.push_back(index.vertex_index);
+					model.texcoordIndices.push_back(index.texcoord_index);
+				}
+			models.push_back(std::move(model));
+		}
+		if (models.empty())
+			LOG_WARN("no models found, run from the application directory");
+		return models;
+	}
+
+	bool benchBvh()
+	{
+		LOG_SECTION("bvh");
+
+		std::vector<BenchModel> models = loadModels();
+
+		//the same builds one after another and spread over the pool
+		auto buildAll = [&](bool parallel) {
+			auto build = [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i)
+					models[i].bvh.build(models[i].positions.data(), sizeof(vec3f), models[i].indices.data(), models[i].indices.size());
+			};
+			if (parallel)
+				ThreadPool::global().parallelFor((uint32_t)models.size(), 1, build);
+			else
+				build(0, (uint32_t)models.size());
+		};
+		double serialMs = measure(3, [&] { buildAll(false); }) * 1e-6;
+		double parallelMs = measure(3, [&] { buildAll(true); }) * 1e-6;
+		//a build is one task, with a thread per model the largest one is the whole frame
+		double largestMs = 0.0;
+		for (auto &model : models)
+			largestMs = std::max(largestMs, measure(3, [&] {
+				model.bvh.build(model.positions.data(), sizeof(vec3f), model.indices.data(), model.indices.size());
+			}) * 1e-6);
+		LOG << "triangle bvh builds : serial " << serialMs << " ms, parallel " << parallelMs
+			<< " ms on " << ThreadPool::global().size() + 1 << " threads, x" << serialMs / parallelMs
+			<< ". largest build " << largestMs << " ms, at most x" << serialMs / largestMs
+			<< " with a thread per model" << ENDL;
+
+		//rays from a sphere around the model through random points of its box,
+		//the closest hit has to match the brute force one exactly
+		bool passed = true;
+		std::mt19937 rng(17);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const uint32_t rayCount = 512;
+		for (auto &model : models)
+		{
+			Bounds bounds = Bounds::fromPoints(model.positions.data(), model.positions.size());
+			std::vector<Ray> rays(rayCount);
+			for (auto &ray : rays)
+			{
+				vec3f dir = vec3f(unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f).normalized();
+				vec3f origin = bounds.center + dir * (bounds.radius * 2.0f);
+				vec3f target = bounds.min + (bounds.max - bounds.min) * vec3f(unit(rng), unit(rng), unit(rng));
+				ray = Ray(origin, target - origin);
+			}
+
+			uint32_t mismatches = 0, hits = 0;
+			for (auto &ray : rays)
+			{
+				Ray a = ray, b = ray;
+				RayHit fast, brute;
+				bool hitFast = model.bvh.intersect(a, fast);
+				bool hitBrute = model.bvh.intersectLinear(b, brute);
+				hits += hitBrute;
+				mismatches += hitFast != hitBrute || fast.t != brute.t;
+			}
+			passed &= check(model.name + " rays", mismatches, 0.0);
+
+			RayHit sink;
+			double linearNs = measure(4, [&] { for (auto ray : rays) model.bvh.intersectLinear(ray, sink); }) / rayCount;
+			double bvhNs = measure(4, [&] { for (auto ray : rays) model.bvh.intersect(ray, sink); }) / rayCount;
+			LOG << model.name << " : " << model.bvh.triangleCount() << " triangles, " << model.bvh.bvh.nodes.size()
+				<< " nodes, depth " << model.bvh.bvh.depth() << ", " << hits << " / " << rayCount << " rays hit" << ENDL;
+			report("ray ns", linearNs, bvhNs, "linear", "bvh");
+			consume(&sink, sizeof(sink));
+		}
+
+		//instance tree over the culling scene
+		const uint32_t count = 16384;
+		std::vector<Bounds> world = scatterInstances(count);
+		Frustum frustum = benchFrustum();
+		Bvh instances;
+		double buildUs = measure(5, [&] { instances.build(world, 2); }) * 1e-3;
+		double refitUs = measure(20, [&] { instances.refit(world); }) * 1e-3;
+		LOG << "instance bvh : " << count << " instances, " << instances.nodes.size() << " nodes, depth "
+			<< instances.depth() << ", build " << buildUs << " us, refit " << refitUs << " us" << ENDL;
+
+		std::vector<uint32_t> visible, brute;
+		auto bruteForce = [&] {
+			brute.clear();
+			for (uint32_t i = 0; i < count; ++i)
+				if (frustum.contains(world[i]))
+					brute.push_back(i);
+		};
+		bruteForce();
+		instances.cull(frustum, world, visible);
+		std::sort(visible.begin(), visible.end());
+		passed &= check("hierarchical cull", visible == brute ? 0.0 : 1.0, 0.0);
+
+		//moved instances, refit has to keep the result exact
+		for (auto &b : world)
+			b = b.transformed(Matrix4x4(1, 0, 0, 20.0f, 0, 1, 0, 0, 0, 0, 1, -15.0f, 0, 0, 0, 1));
+		instances.refit(world);
+		bruteForce();
+		instances.cull(frustum, world, visible);
+		std::sort(visible.begin(), visible.end());
+		passed &= check("cull after refit", visible == brute ? 0.0 : 1.0, 0.0);
+		LOG << "visible : " << visible.size() << " / " << count << ENDL;
+
+		const uint32_t repeat = 100;
+		report("cull ns / instance",
+			measure(repeat, bruteForce) / count,
+			measure(repeat, [&] { instances.cull(frustum, world, visible); }) / count, "linear", "bvh");
+		consume(visible.data(), visible.size() * sizeof(uint32_t));
+
+		return passed;
+	}
+
+	bool benchGraph()
+	{
+		LOG_SECTION("transform hierarchy");
+		bool passed = true;
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		auto random = [&](float scale) {
+			return vec3f(unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f) * scale;
+		};
+
+		//a few roots, every other node hangs below a random earlier one
+		const uint32_t count = 100000;
+		SceneGraph graph;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t parent = i < 16 ? SceneGraph::NONE : rng() % i;
+			graph.addNode(parent, random(10.0f), random(360.0f), vec3f(0.5f + unit(rng)));
+		}
+		uint32_t deepest = 0;
+		for (uint32_t d : graph.depth)
+			deepest = std::max(deepest, d);
+		graph.update();
+
+		//one percent of the nodes move per frame
+		const uint32_t moved = count / 100;
+		std::vector<uint32_t> nodes(moved);
+		auto animate = [&] {
+			for (auto &node : nodes)
+			{
+				node = rng() % count;
+				graph.setRotation(node, random(360.0f));
+			}
+		};
+
+		uint32_t changed = 0, mismatches = 0;
+		SceneGraph reference = graph;
+		for (int frame = 0; frame < 8; ++frame)
+		{
+			animate();
+			for (uint32_t node : nodes)
+				reference.setRotation(node, graph.rotation[node]);
+			changed += (uint32_t)graph.update().size();
+			reference.updateAll();
+			for (uint32_t i = 0; i < count; ++i)
+				mismatches += memcmp(&graph.world(i), &reference.world(i), sizeof(Matrix4x4)) != 0;
+		}
+		passed &= check("incremental update", mismatches, 0.0);
+		LOG << count << " nodes, depth " << deepest + 1 << ", " << moved << " moved, "
+			<< changed / 8 << " world matrices recomputed per frame" << ENDL;
+
+		const uint32_t repeat = 20;
+		double fullNs = measure(repeat, [&] { animate(); graph.updateAll(); });
+		double dirtyNs = measure(repeat, [&] { animate(); graph.update(); });
+		report("update / frame", fullNs, dirtyNs, "full", "dirty");
+		consume(&graph.world(0), sizeof(Matrix4x4));
+		return passed;
+	}
+
+	/*OCCLUSION*/
+	bool benchOcclusion()
+	{
+		LOG_SECTION("software occlusion");
+		LOG << "instruction set : " << simdName() << " (" << simdWidth() << " wide)" << ENDL;
+		bool passed = true;
+
+		//a wall across the view, boxes behind it are hidden and the rest not
+		{
+			const vec3f wall[] = { vec3f(-20, -20, -30), vec3f(20, -20, -30), vec3f(20, 20, -30), vec3f(-20, 20, -30) };
+			const uint32_t quad[] = { 0, 1, 2, 0, 2, 3 };
+			Occluder occluder;
+			occluder.build(wall, sizeof(vec3f), quad, 6);
+			OcclusionBuffer buffer;
+			Matrix4x4 proj = vml::perspective<vml::VulkanConvention>(45.0f, 2.0f, 0.1f, 300.0f);
+			buffer.begin(proj * vml::lookAt<vml::VulkanConvention>(vec3f(), vec3f(0, 0, -1), vec3f(0, 1, 0)));
+			buffer.add(&occluder, Matrix4x4());
+			buffer.rasterize();
+			uint32_t wrong = 0;
+			wrong += !buffer.occluded(vec3f(-2, -2, -40), vec3f(2, 2, -38));
+			wrong += buffer.occluded(vec3f(-2, -2, -22), vec3f(2, 2, -20));
+			wrong += buffer.occluded(vec3f(68, -2, -102), vec3f(72, 2, -98));
+			wrong += buffer.occluded(vec3f(-2, -2, -40), vec3f(2, 2, 5));
+			passed &= check("wall", wrong, 0.0);
+		}
+
+		//bundled models as occluders ahead of the culling camera
+		std::vector<BenchModel> models = loadModels();
+		if (models.empty())
+			return passed;
+		std::vector<Occluder> occluders(models.size());
+		uint32_t sourceTriangles = 0, occluderTriangles = 0;
+		for (size_t i = 0; i < models.size(); ++i)
+		{
+			occluders[i].build(models[i].positions.data(), sizeof(vec3f), models[i].indices.data(), models[i].indices.size());
+			sourceTriangles += (uint32_t)models[i].indices.size() / 3;
+			occluderTriangles += occluders[i].triangleCount();
+		}
+		LOG << models.size() << " models, " << sourceTriangles << " triangles, "
+			<< occluderTriangles << " kept as occluders" << ENDL;
+
+		OcclusionBuffer buffer;
+		buffer.begin(benchViewProj());
+		std::mt19937 rng(23);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Matrix4x4> worlds(32);
+		for (size_t i = 0; i < worlds.size(); ++i)
+		{
+			const BenchModel &model = models[i % models.size()];
+			Bounds bounds = Bounds::fromPoints(model.positions.data(), model.positions.size());
+			Matrix4x4 &M = worlds[i];
+			M.translate(vec3f(unit(rng) * 40.0f - 10.0f, unit(rng) * 10.0f, -20.0f - unit(rng) * 50.0f));
+			M.rotate(AXIS::Y, unit(rng) * 360.0f);
+			M.scale(vec3f(8.0f / bounds.radius));
+			M.translate(-bounds.center);
+			buffer.add(&occluders[i % models.size()], M);
+		}
+
+		//the same triangles one pixel at a time have to give the same bits
+		const uint32_t count = 16384;
+		std::vector<Bounds> world = scatterInstances(count);
+		Frustum frustum = benchFrustum();
+		auto countOccluded = [&] {
+			uint32_t hidden = 0;
+			for (auto &b : world)
+				hidden += frustum.contains(b) && buffer.occluded(b);
+			return hidden;
+		};
+		buffer.rasterizeReference();
+		std::vector<float> reference(buffer.depth(), buffer.depth() + buffer.width() * buffer.height());
+		uint32_t referenceHidden = countOccluded();
+		buffer.rasterize();
+		uint32_t differing = 0;
+		for (size_t i = 0; i < reference.size(); ++i)
+			differing += reference[i] != buffer.depth()[i];
+		passed &= check("simd raster", differing, 0.0);
+		uint32_t hidden = countOccluded();
+		passed &= check("occluded boxes", (double)hidden - referenceHidden, 0.0);
+
+		uint32_t inFrustum = 0, covered = 0;
+		for (auto &b : world)
+			inFrustum += frustum.contains(b);
+		for (size_t i = 0; i < reference.size(); ++i)
+			covered += reference[i] < 1.0f;
+		LOG << buffer.width() << " x " << buffer.height() << ", " << worlds.size() << " occluders, "
+			<< buffer.triangleCount() << " triangles after clipping, " << covered * 100 / reference.size()
+			<< " % covered" << ENDL;
+		LOG << "occluded : " << hidden << " / " << inFrustum << " boxes in the frustum" << ENDL;
+
+		const uint32_t repeat = 50;
+		report("raster", measure(repeat, [&] { buffer.rasterizeReference(); }),
+			measure(repeat, [&] { buffer.rasterize(); }), "scalar", "simd + threads");
+		double testNs = measure(repeat, [&] {
+			uint32_t hiddenNow = 0;
+			for (auto &b : world)
+				hiddenNow += buffer.occluded(b);
+			consume(&hiddenNow, sizeof(hiddenNow));
+		}) / count;
+		LOG << "box test : " << testNs << " ns" << ENDL;
+		consume(buffer.depth(), buffer.width() * sizeof(float));
+		return passed;
+	}
+
+	/*LEVELS OF DETAIL*/
+	//position and texture coordinate, split at uv seams like meshTool::LoadModel
+	struct LodVertex
+	{
+		vec3f pos;
+		float st[2];
+	};
+
+	bool benchLod()
+	{
+		LOG_SECTION("levels of detail");
+		std::vector<BenchModel> models = loadModels();
+		if (models.empty())
+			return true;
+
+		std::vector<std::vector<LodVertex>> vertices(models.size());
+		std::vector<std::vector<uint32_t>> indices(models.size());
+		for (size_t m = 0; m < models.size(); ++m)
+		{
+			const BenchModel &model = models[m];
+			std::map<std::pair<int, int>, uint32_t> unique;
+			for (size_t i = 0; i < model.indices.size(); ++i)
+			{
+				std::pair<int, int> key(model.indices[i], model.texcoordIndices[i]);
+				auto found = unique.find(key);
+				if (found == unique.end())
+				{
+					LodVertex v = { model.positions[key.first], { 0.0f, 0.0f } };
+					if (key.second >= 0)
+					{
+						v.st[0] = model.texcoords[key.second * 2];
+						v.st[1] = model.texcoords[key.second * 2 + 1];
+					}
+					found = unique.insert(std::make_pair(key, (uint32_t)vertices[m].size())).first;
+					vertices[m].push_back(v);
+				}
+				indices[m].push_back(found->second);
+			}
+		}
+
+		std::vector<std::vector<MeshLod>> lods(models.size());
+		std::vector<std::vector<uint32_t>> lodIndices(models.size());
+		const float weights[2] = { 1.0f, 1.0f };
+		auto buildAll = [&](bool parallel) {
+			auto build = [&](uint32_t begin, uint32_t end) {
+				for (uint32_t m = begin; m < end; ++m)
+				{
+					SimplifyAttributes attributes;
+					attributes.data = vertices[m][0].st;
+					attributes.stride = sizeof(LodVertex);
+					attributes.count = 2;
+					attributes.weights = weights;
+					lods[m] = vml::buildLods(indices[m].data(), indices[m].size(), &vertices[m][0].pos,
+						vertices[m].size(), sizeof(LodVertex), &attributes, 5, lodIndices[m]);
+				}
+			};
+			if (parallel)
+				ThreadPool::global().parallelFor((uint32_t)models.size(), 1, build);
+			else
+				build(0, (uint32_t)models.size());
+		};
+		double serialMs = measure(1, [&] { buildAll(false); }) * 1e-6;
+		double parallelMs = measure(1, [&] { buildAll(true); }) * 1e-6;
+		LOG << "lod chains : serial " << serialMs << " ms, parallel " << parallelMs
+			<< " ms on " << ThreadPool::global().size() + 1 << " threads" << ENDL;
+
+		//every level has fewer triangles, a larger error, no degenerate
+		//triangle and the same open border as the full mesh
+		bool passed = true;
+		uint32_t wrong = 0, borderChanged = 0;
+		for (size_t m = 0; m < models.size(); ++m)
+		{
+			//edges with one triangle, over welded positions so seams are not borders
+			std::map<std::tuple<float, float, float>, uint32_t> weld;
+			std::vector<uint32_t> welded(vertices[m].size());
+			for (size_t v = 0; v < vertices[m].size(); ++v)
+			{
+				const vec3f &p = vertices[m][v].pos;
+				welded[v] = weld.insert(std::make_pair(std::make_tuple(p.x, p.y, p.z), (uint32_t)weld.size())).first->second;
+			}
+			auto border = [&](const MeshLod &lod) {
+				const uint32_t* levelIndices = lod.firstIndex ? &lodIndices[m][lod.firstIndex - indices[m].size()] : indices[m].data();
+				std::map<uint64_t, int> counts;
+				for (uint32_t t = 0; t + 2 < lod.indexCount; t += 3)
+					for (int k = 0; k < 3; ++k)
+					{
+						//the source meshs have triangles with two corners on one position
+						wrong += lod.firstIndex && levelIndices[t + k] == levelIndices[t + (k + 1) % 3];
+						uint32_t a = welded[levelIndices[t + k]], b = welded[levelIndices[t + (k + 1) % 3]];
+						if (a != b)
+							counts[a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a]++;
+					}
+				std::vector<uint64_t> open;
+				for (auto &edge : counts)
+					if (edge.second == 1)
+						open.push_back(edge.first);
+				return open;
+			};
+
+			const std::vector<MeshLod> &chain = lods[m];
+			std::vector<uint64_t> fullBorder = border(chain[0]);
+			LOG << models[m].name << " : " << vertices[m].size() << " vertices, " << fullBorder.size() << " border edges" << ENDL;
+			for (size_t l = 0; l < chain.size(); ++l)
+			{
+				if (l > 0)
+				{
+					wrong += chain[l].indexCount >= chain[l - 1].indexCount || chain[l].error < chain[l - 1].error;
+					borderChanged += border(chain[l]) != fullBorder;
+				}
+				LOG << "   lod " << l << " : " << std::setw(7) << chain[l].indexCount / 3 << " triangles, error "
+					<< chain[l].error << ENDL;
+			}
+		}
+		passed &= check("lod chains", wrong, 0.0);
+		passed &= check("borders kept", borderChanged, 0.0);
+
+		uint32_t full = 0, levels = 0;
+		for (size_t m = 0; m < models.size(); ++m)
+		{
+			full += lods[m][0].indexCount / 3;
+			for (size_t l = 1; l < lods[m].size(); ++l)
+				levels += lods[m][l].indexCount / 3;
+		}
+		LOG << "index buffers grow by " << levels * 100 / std::max(full, 1U) << " % for the coarser levels" << ENDL;
+		return passed;
+	}
+
+	/*MESHLETS*/
+	bool benchMeshlet()
+	{
+		LOG_SECTION("meshlets");
+		std::vector<BenchModel> models = loadModels();
+		bool passed = true;
+		std::mt19937 rng(31);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		uint32_t oversized = 0, lost = 0, outside = 0, wrongCone = 0, wrongBack = 0;
+		for (auto &model : models)
+		{
+			std::vector<uint32_t> indices = model.indices;
+			std::vector<Meshlet> meshlets;
+			double buildMs = measure(1, [&] {
+				indices = model.indices;
+				meshlets = vml::buildMeshlets(indices.data(), indices.size(), model.positions.data(),
+					model.positions.size(), sizeof(vec3f));
+			}) * 1e-6;
+
+			//the same triangles, each once with its winding
+			auto sorted = [](const std::vector<uint32_t> &list) {
+				std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> triangles;
+				for (size_t t = 0; t + 2 < list.size(); t += 3)
+				{
+					uint32_t a = list[t], b = list[t + 1], c = list[t + 2];
+					//rotate the smallest first, keeps the winding
+					while (a > b || a > c) { uint32_t x = a; a = b; b = c; c = x; }
+					triangles.push_back(std::make_tuple(a, b, c));
+				}
+				std::sort(triangles.begin(), triangles.end());
+				return triangles;
+			};
+			lost += sorted(indices) != sorted(model.indices);
+
+			uint32_t covered = 0, vertexSum = 0;
+			for (const Meshlet &m : meshlets)
+			{
+				covered += m.indexCount;
+				vertexSum += m.vertexCount;
+				oversized += m.vertexCount > 64 || m.indexCount > 124 * 3;
+				for (uint32_t i = 0; i < m.indexCount; i += 3)
+				{
+					const uint32_t* t = &indices[m.firstIndex + i];
+					const vec3f &p0 = model.positions[t[0]], &p1 = model.positions[t[1]], &p2 = model.positions[t[2]];
+					for (const vec3f* p : { &p0, &p1, &p2 })
+						outside += (*p - m.center).length() > m.radius * 1.0001f + 1e-6f;
+					vec3f n = (p1 - p0).cross(p2 - p0);
+					if (n.length() > 0.0f && m.coneCos > 0.0f)
+						wrongCone += n.normalized().dot(m.coneAxis) < m.coneCos - 1e-4f;
+				}
+			}
+			lost += covered != indices.size();
+
+			//random eyes around the model, a meshlet called back facing has to
+			//have every triangle facing away
+			Bounds bounds = Bounds::fromPoints(model.positions.data(), model.positions.size());
+			uint32_t tests = 0, back = 0;
+			uint64_t backTriangles = 0, allTriangles = 0;
+			for (int e = 0; e < 64; ++e)
+			{
+				vec3f dir = vec3f(unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f).normalized();
+				vec3f eye = bounds.center + dir * (bounds.radius * (1.5f + 4.0f * unit(rng)));
+				for (const Meshlet &m : meshlets)
+				{
+					++tests;
+					allTriangles += m.indexCount / 3;
+					if (!vml::backFacing(m, eye))
+						continue;
+					++back;
+					backTriangles += m.indexCount / 3;
+					for (uint32_t i = 0; i < m.indexCount; i += 3)
+					{
+						const uint32_t* t = &indices[m.firstIndex + i];
+						const vec3f &p0 = model.positions[t[0]];
+						vec3f n = (model.positions[t[1]] - p0).cross(model.positions[t[2]] - p0);
+						wrongBack += n.dot(p0 - eye) < 0.0f;
+					}
+				}
+			}
+			LOG << model.name << " : " << meshlets.size() << " meshlets, " << std::fixed << std::setprecision(1)
+				<< vertexSum / (float)std::max<size_t>(meshlets.size(), 1) << " vertices and "
+				<< covered / 3 / (float)std::max<size_t>(meshlets.size(), 1) << " triangles each, "
+				<< back * 100.0f / std::max(tests, 1U) << " % back facing (" << backTriangles * 100.0f / std::max<uint64_t>(allTriangles, 1)
+				<< " % of the triangles), build " << buildMs << " ms" << ENDL;
+			LOG.unsetf(std::ios::floatfield);
+		}
+		passed &= check("triangles kept", lost, 0.0);
+		passed &= check("meshlet limits", oversized, 0.0);
+		passed &= check("bounding spheres", outside, 0.0);
+		passed &= check("normal cones", wrongCone, 0.0);
+		passed &= check("back facing", wrongBack, 0.0);
+		return passed;
+	}
+
+	/*RENDER QUEUE*/
+	//stand in for a vulkan handle, never dereferenced
+	template<typename T>
+	T fakeHandle(uint64_t id)
+	{
+		return (T)(uintptr_t)id;
+	}
+
+	bool benchQueue()
+	{
+		LOG_SECTION("render queue");
+		//a mixed material scene, draws arrive in scene order
+		const uint32_t drawCount = 4096, meshCount = 64, pipelineCount = 8, setCount = 4;
+		std::mt19937 rng(17);
+		std::uniform_int_distribution<uint32_t> pick(0, 1U << 30);
+		std::uniform_real_distribution<float> depth(0.1f, 500.0f);
+
+		RenderQueue queue;
+		queue.clear(VK_NULL_HANDLE);
+		std::vector<RenderDraw> draws(drawCount);
+		std::vector<uint32_t> passes(drawCount);
+		std::vector<float> depths(drawCount);
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			RenderDraw &draw = draws[i];
+			uint32_t mesh = pick(rng) % meshCount;
+			//materials follow the mesh mostly, every 8th draw overrides it
+			uint32_t material = i % 8 ? mesh % pipelineCount : pick(rng) % pipelineCount;
+			draw.pipeline = fakeHandle<VkPipeline>(1 + material);
+			draw.descriptorSet = fakeHandle<VkDescriptorSet>(1 + (material + mesh) % setCount);
+			draw.vertexBuffer = fakeHandle<VkBuffer>(100 + mesh);
+			draw.indexBuffer = fakeHandle<VkBuffer>(200 + mesh);
+			draw.attributeOffset = 1024;
+			draw.instanceBuffer = fakeHandle<VkBuffer>(300);
+			draw.indexCount = 3 * (1 + mesh);
+			draw.firstInstance = i;
+			draw.constants.material = material % 2;
+			passes[i] = pick(rng) % 4 ? 0 : 1;
+			depths[i] = depth(rng);
+			queue.submit(passes[i], draw, depths[i]);
+		}
+		RenderQueueStats before = queue.unsorted();
+		RenderQueueStats unsortedSkipped = queue.count();
+		queue.sort();
+		RenderQueueStats after = queue.count();
+
+		//keys ascend, every draw is there once, equal keys keep submission order
+		uint32_t misordered = 0, lost = 0, wrongPass = 0;
+		std::vector<uint8_t> seen(drawCount, 0);
+		for (size_t i = 0; i < queue.size(); ++i)
+		{
+			uint32_t index = queue.draw(i).firstInstance;
+			lost += index >= drawCount || seen[index]++;
+			if (i == 0) continue;
+			misordered += queue.key(i) < queue.key(i - 1) ||
+				(queue.key(i) == queue.key(i - 1) && index < queue.draw(i - 1).firstInstance);
+			wrongPass += passes[index] < passes[queue.draw(i - 1).firstInstance];
+		}
+
+		//the sort alone, against std::sort of the same pairs
+		std::vector<std::pair<uint64_t, uint32_t>> pairs(drawCount);
+		for (size_t i = 0; i < queue.size(); ++i)
+			pairs[i] = std::make_pair(queue.key(i), (uint32_t)i);
+		std::shuffle(pairs.begin(), pairs.end(), rng);
+		double radixNs = measure(16, [&] {
+			queue.clear(VK_NULL_HANDLE);
+			for (uint32_t i = 0; i < drawCount; ++i)
+				queue.submit(passes[i], draws[i], depths[i]);
+			queue.sort();
+			consume(&draws[0], 1);
+		}) / drawCount;
+		double submitNs = measure(16, [&] {
+			queue.clear(VK_NULL_HANDLE);
+			for (uint32_t i = 0; i < drawCount; ++i)
+				queue.submit(passes[i], draws[i], depths[i]);
+			consume(&draws[0], 1);
+		}) / drawCount;
+		double stdNs = measure(16, [&] {
+			std::vector<std::pair<uint64_t, uint32_t>> copy = pairs;
+			std::sort(copy.begin(), copy.end());
+			consume(copy.data(), sizeof(copy[0]));
+		}) / drawCount;
+		report("sort per draw", stdNs, std::max(radixNs - submitNs, 0.0), "std::sort", "radix");
+
+		LOG << drawCount << " draws, " << meshCount << " meshs, " << pipelineCount << " pipelines, " << setCount << " descriptor sets" << ENDL;
+		auto line = [](const char* label, const RenderQueueStats &stats) {
+			LOG << label << " : " << stats.binds() << " binds (pipelines " << stats.pipelineBinds
+				<< ", descriptor sets " << stats.descriptorBinds << ", vertex buffers " << stats.vertexBinds
+				<< ", index buffers " << stats.indexBinds << "), " << stats.pushes << " pushes" << ENDL;
+		};
+		line("every draw binds", before);
+		line("redundant skipped", unsortedSkipped);
+		line("sorted and skipped", after);
+
+		bool passed = true;
+		passed &= check("sorted keys", misordered, 0.0);
+		passed &= check("draws kept", lost + (queue.size() != drawCount), 0.0);
+		passed &= check("passes in order", wrongPass, 0.0);
+		passed &= check("fewer binds", after.binds() > unsortedSkipped.binds(), 0.0);
+		return passed;
+	}
+
+	/*RENDER GRAPH*/
+	//the frame TextureRenderer records with occlusion culling, on fake handles
+	struct CullFrame
+	{
+		uint32_t color, depth, commands, stream, counters, readback, hiz;
+		uint32_t draws[2];
+		uint32_t debug;
+	};
+
+	CullFrame declareCullFrame(RenderGraph &graph, uint32_t hizLevels)
+	{
+		auto none = [](VkCommandBuffer) {};
+		CullFrame frame;
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange depthRange = { VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange hizRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, hizLevels, 0, 1 };
+		frame.color = graph.importImage("swapchain", fakeHandle<VkImage>(1), VK_FORMAT_B8G8R8A8_UNORM, colorRange,
+			GraphAccess::ACQUIRED);
+		graph.output(frame.color, GraphAccess::PRESENT);
+		frame.depth = graph.importImage("depth", fakeHandle<VkImage>(2), VK_FORMAT_D32_SFLOAT_S8_UINT, depthRange,
+			GraphAccess::DEPTH_ATTACHMENT);
+		graph.output(frame.depth, GraphAccess::DEPTH_ATTACHMENT);
+		uint32_t instances = graph.importBuffer("instances", fakeHandle<VkBuffer>(10));
+		frame.stream = graph.importBuffer("stream", fakeHandle<VkBuffer>(11));
+		frame.commands = graph.importBuffer("commands", fakeHandle<VkBuffer>(12));
+		uint32_t resetCommands = graph.importBuffer("reset commands", fakeHandle<VkBuffer>(13));
+		uint32_t cullData = graph.importBuffer("cull data", fakeHandle<VkBuffer>(14));
+		frame.counters = graph.importBuffer("counters", fakeHandle<VkBuffer>(15));
+		frame.readback = graph.importBuffer("readback", fakeHandle<VkBuffer>(16));
+		frame.hiz = graph.importImage("hi-z", fakeHandle<VkImage>(3), VK_FORMAT_R32_SFLOAT, hizRange,
+			GraphAccess::STORAGE_COMPUTE, VK_IMAGE_LAYOUT_GENERAL);
+
+		uint32_t reset = graph.addPass("cull reset", false, none);
+		graph.use(reset, resetCommands, GraphAccess::TRANSFER_READ);
+		graph.use(reset, frame.commands, GraphAccess::TRANSFER_WRITE);
+		graph.use(reset, frame.counters, GraphAccess::TRANSFER_WRITE);
+		//written and never read, the graph has to drop it
+		uint32_t debugBuffer = graph.importBuffer("debug", fakeHandle<VkBuffer>(17));
+		frame.debug = graph.addPass("debug", false, none);
+		graph.use(frame.debug, frame.counters, GraphAccess::STORAGE_READ_COMPUTE);
+		graph.use(frame.debug, debugBuffer, GraphAccess::STORAGE_COMPUTE);
+		for (uint32_t phase = 0; phase < 2; ++phase)
+		{
+			uint32_t pyramid = graph.addPass("hi-z", false, none);
+			graph.use(pyramid, frame.depth, GraphAccess::SAMPLED_COMPUTE);
+			graph.use(pyramid, frame.hiz, GraphAccess::STORAGE_COMPUTE);
+			uint32_t cull = graph.addPass("cull", false, none);
+			graph.use(cull, instances, GraphAccess::STORAGE_READ_COMPUTE);
+			graph.use(cull, cullData, GraphAccess::UNIFORM_COMPUTE);
+			graph.use(cull, frame.hiz, GraphAccess::SAMPLED_COMPUTE);
+			graph.use(cull, frame.commands, GraphAccess::STORAGE_COMPUTE);
+			graph.use(cull, frame.stream, GraphAccess::STORAGE_COMPUTE);
+			graph.use(cull, frame.counters, GraphAccess::STORAGE_COMPUTE);
+			uint32_t draw = graph.addPass("draw", true, none);
+			graph.use(draw, frame.color, GraphAccess::COLOR_ATTACHMENT);
+			graph.use(draw, frame.depth, GraphAccess::DEPTH_ATTACHMENT);
+			graph.target(draw, fakeHandle<VkFramebuffer>(1), { 1280, 720 });
+			if (phase == 0)
+			{
+				VkClearValue clear = {};
+				graph.clearAttachment(draw, frame.color, clear);
+				clear.depthStencil = { 1.0f, 0 };
+				graph.clearAttachment(draw, frame.depth, clear);
+			}
+			graph.use(draw, frame.commands, GraphAccess::INDIRECT);
+			graph.use(draw, frame.stream, GraphAccess::VERTEX);
+			frame.draws[phase] = draw;
+		}
+		uint32_t copy = graph.addPass("cull readback", false, none);
+		graph.use(copy, frame.counters, GraphAccess::TRANSFER_READ);
+		graph.use(copy, frame.readback, GraphAccess::TRANSFER_WRITE);
+		graph.output(frame.readback, GraphAccess::HOST_READ);
+		return frame;
+	}
+
+	bool benchRenderGraph()
+	{
+		LOG_SECTION("render graph");
+		const uint32_t hizLevels = 11;
+		RenderGraph graph(VK_NULL_HANDLE);
+		CullFrame frame = declareCullFrame(graph, hizLevels);
+		graph.compile();
+		RenderGraph::Stats stats = graph.stats();
+
+		//the compute passes between the draws keep them in render passes of their own
+		const std::vector<VkAttachmentDescription> &first = graph.attachments(graph.group(frame.draws[0]));
+		const std::vector<VkAttachmentDescription> &second = graph.attachments(graph.group(frame.draws[1]));
+		uint32_t wrongOps = 0;
+		wrongOps += first[0].loadOp != VK_ATTACHMENT_LOAD_OP_CLEAR || first[0].initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+		wrongOps += first[1].loadOp != VK_ATTACHMENT_LOAD_OP_CLEAR || first[1].initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+		wrongOps += first[0].finalLayout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		wrongOps += second[0].loadOp != VK_ATTACHMENT_LOAD_OP_LOAD || second[0].storeOp != VK_ATTACHMENT_STORE_OP_STORE;
+		//phase 1 takes the depth over from the pyramid's read only layout
+		wrongOps += second[1].loadOp != VK_ATTACHMENT_LOAD_OP_LOAD ||
+			second[1].initialLayout != VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		wrongOps += second[0].finalLayout != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		uint32_t wrongFinal = (graph.finalLayout(frame.color) != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) +
+			(graph.finalLayout(frame.depth) != VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) +
+			(graph.finalLayout(frame.hiz) != VK_IMAGE_LAYOUT_GENERAL);
+
+		//what the recording did by hand: the reset, per phase both depth
+		//transitions, a barrier per pyramid level and one after the cull,
+		//then one before the readback
+		uint32_t handWritten = 1 + 2 * (2 + hizLevels + 1) + 1;
+		//the graph's plus the level barriers recordPyramid keeps between levels
+		uint32_t graphTotal = stats.barriers + 2 * (hizLevels - 1);
+		LOG << stats.passes - stats.culled << " of " << stats.passes << " passes, " << stats.renderPasses
+			<< " render passes, " << stats.barriers << " barriers (" << stats.imageBarriers << " image, "
+			<< stats.bufferBarriers << " buffer), per frame " << graphTotal << " of " << handWritten
+			<< " hand-written" << ENDL;
+
+		//two passes on one frame buffer merge, a pass sampling their color does not
+		RenderGraph merged(VK_NULL_HANDLE);
+		auto none = [](VkCommandBuffer) {};
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange depthRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		uint32_t hdr = merged.importImage("hdr", fakeHandle<VkImage>(1), VK_FORMAT_R16G16B16A16_SFLOAT, colorRange);
+		uint32_t depth = merged.importImage("depth", fakeHandle<VkImage>(2), VK_FORMAT_D32_SFLOAT, depthRange);
+		uint32_t swapchain = merged.importImage("swapchain", fakeHandle<VkImage>(3), VK_FORMAT_B8G8R8A8_UNORM,
+			colorRange, GraphAccess::ACQUIRED);
+		merged.output(swapchain, GraphAccess::PRESENT);
+		uint32_t opaque = merged.addPass("opaque", true, none);
+		merged.use(opaque, hdr, GraphAccess::COLOR_ATTACHMENT);
+		merged.use(opaque, depth, GraphAccess::DEPTH_ATTACHMENT);
+		merged.target(opaque, fakeHandle<VkFramebuffer>(1), { 1280, 720 });
+		merged.clearAttachment(opaque, hdr, VkClearValue());
+		merged.clearAttachment(opaque, depth, VkClearValue());
+		uint32_t blend = merged.addPass("transparent", true, none);
+		merged.use(blend, hdr, GraphAccess::COLOR_ATTACHMENT);
+		merged.use(blend, depth, GraphAccess::DEPTH_ATTACHMENT);
+		merged.target(blend, fakeHandle<VkFramebuffer>(1), { 1280, 720 });
+		uint32_t tonemap = merged.addPass("tonemap", true, none);
+		merged.use(tonemap, swapchain, GraphAccess::COLOR_ATTACHMENT);
+		merged.use(tonemap, hdr, GraphAccess::SAMPLED_FRAGMENT);
+		merged.target(tonemap, fakeHandle<VkFramebuffer>(2), { 1280, 720 });
+		merged.compile();
+		const std::vector<VkAttachmentDescription> &scene = merged.attachments(merged.group(opaque));
+		uint32_t wrongMerge = (merged.group(opaque) != merged.group(blend)) + (merged.subpass(blend) != 1) +
+			(merged.group(tonemap) == merged.group(opaque)) + (merged.stats().renderPasses != 2);
+		//depth ends with the scene, hdr is sampled afterwards
+		wrongMerge += scene[1].storeOp != VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		wrongMerge += scene[0].storeOp != VK_ATTACHMENT_STORE_OP_STORE;
+		wrongMerge += merged.finalLayout(hdr) != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		//depth skips the middle subpass, which has to preserve it
+		RenderGraph gap(VK_NULL_HANDLE);
+		uint32_t gapColor = gap.importImage("color", fakeHandle<VkImage>(1), VK_FORMAT_R16G16B16A16_SFLOAT, colorRange);
+		uint32_t gapDepth = gap.importImage("depth", fakeHandle<VkImage>(2), VK_FORMAT_D32_SFLOAT, depthRange);
+		gap.output(gapColor, GraphAccess::SAMPLED_FRAGMENT);
+		uint32_t gapPasses[3];
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			gapPasses[k] = gap.addPass("gap", true, none);
+			gap.use(gapPasses[k], gapColor, GraphAccess::COLOR_ATTACHMENT);
+			if (k != 1)
+				gap.use(gapPasses[k], gapDepth, GraphAccess::DEPTH_ATTACHMENT);
+			gap.target(gapPasses[k], fakeHandle<VkFramebuffer>(1), { 1280, 720 });
+		}
+		gap.compile();
+		uint32_t gapGroup = gap.group(gapPasses[0]);
+		wrongMerge += gap.stats().renderPasses != 1;
+		wrongMerge += gap.preserved(gapGroup, 1) != std::vector<uint32_t>(1, 1U);
+		wrongMerge += !gap.preserved(gapGroup, 0).empty() + !gap.preserved(gapGroup, 2).empty();
+		LOG << "merged : " << merged.stats().subpasses << " subpasses in " << merged.stats().renderPasses
+			<< " render passes, " << merged.stats().barriers << " barriers" << ENDL;
+
+		double compileNs = measure(64, [&] {
+			RenderGraph timed(VK_NULL_HANDLE);
+			declareCullFrame(timed, hizLevels);
+			timed.compile();
+			consume(&timed.stats(), sizeof(RenderGraph::Stats));
+		});
+		LOG << "declare and compile per frame : " << compileNs / 1000.0 << " us" << ENDL;
+
+		bool passed = true;
+		passed &= check("unused pass culled", !graph.culled(frame.debug) + (stats.culled != 1), 0.0);
+		passed &= check("render passes", stats.renderPasses != 2, 0.0);
+		passed &= check("attachment ops", wrongOps, 0.0);
+		passed &= check("final layouts", wrongFinal, 0.0);
+		passed &= check("fewer barriers", graphTotal >= handWritten, 0.0);
+		passed &= check("subpass merge", wrongMerge, 0.0);
+		return passed;
+	}
+
+	/*ATTACHMENTS*/
+	//what vkGetImageMemoryRequirements reports for an optimal tiled image, roughly
+	AttachmentMemory attachmentMemory(const AttachmentDesc &desc, bool lazy)
+	{
+		const VkDeviceSize page = 64 * 1024;
+		VkDeviceSize size = (VkDeviceSize)desc.extent.width * desc.extent.height * attachmentTexelSize(desc.format);
+		return { (size + page - 1) / page * page, page, 1, lazy };
+	}
+
+	//attachments whose memory overlaps while their passes do
+	uint32_t aliasingConflicts(const std::vector<AttachmentDesc> &descs, const std::vector<AttachmentMemory> &memory,
+		const AttachmentPlan &plan)
+	{
+		uint32_t conflicts = 0;
+		for (uint32_t i = 0; i < descs.size(); ++i)
+			for (uint32_t j = i + 1; j < descs.size(); ++j)
+			{
+				const AttachmentPlan::Placement &a = plan.placements[i];
+				const AttachmentPlan::Placement &b = plan.placements[j];
+				if (a.lazy || b.lazy || a.heap != b.heap)
+					continue;
+				bool sharesBytes = a.offset < b.offset + memory[j].size && b.offset < a.offset + memory[i].size;
+				bool sharesPasses = descs[i].firstPass <= descs[j].lastPass && descs[j].firstPass <= descs[i].lastPass;
+				conflicts += sharesBytes && sharesPasses;
+			}
+		return conflicts;
+	}
+
+	//swapchain and depth in one render pass, the frame without occlusion culling
+	RenderGraph::Stats drawFrameStats(VkFormat depthFormat, bool keepDepth)
+	{
+		RenderGraph graph(VK_NULL_HANDLE);
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange depthRange = { attachmentAspect(depthFormat), 0, 1, 0, 1 };
+		uint32_t color = graph.importImage("swapchain", fakeHandle<VkImage>(1), VK_FORMAT_B8G8R8A8_UNORM, colorRange,
+			GraphAccess::ACQUIRED);
+		graph.output(color, GraphAccess::PRESENT);
+		uint32_t depth = graph.importImage("depth", fakeHandle<VkImage>(2), depthFormat, depthRange,
+			keepDepth ? GraphAccess::DEPTH_ATTACHMENT : GraphAccess::NONE);
+		uint32_t draw = graph.addPass("draw", true, [](VkCommandBuffer) {});
+		graph.use(draw, color, GraphAccess::COLOR_ATTACHMENT);
+		graph.use(draw, depth, GraphAccess::DEPTH_ATTACHMENT);
+		graph.target(draw, fakeHandle<VkFramebuffer>(1), { 1280, 720 });
+		graph.clearAttachment(draw, color, VkClearValue());
+		graph.clearAttachment(draw, depth, VkClearValue());
+		graph.compile();
+		return graph.stats();
+	}
+
+	bool benchAttachments()
+	{
+		LOG_SECTION("attachments");
+		const VkExtent2D extent = { 1280, 720 };
+		const VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		const VkImageUsageFlags historyUsage = depthUsage | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+		//the depth of VkRenderer per configuration. it used to be D32_S8 with
+		//its own allocation, stored every frame
+		struct Config
+		{
+			const char* name;
+			VkFormat format;
+			bool history;
+			bool transient;
+			bool lazy;
+		};
+		const Config configs[] = {
+			{ "legacy d32s8", VK_FORMAT_D32_SFLOAT_S8_UINT, true, false, false },
+			{ "occlusion", VK_FORMAT_D32_SFLOAT, true, true, false },
+			{ "no occlusion", VK_FORMAT_X8_D24_UNORM_PACK32, false, true, false },
+			{ "no occlusion lazy", VK_FORMAT_X8_D24_UNORM_PACK32, false, true, true },
+			{ "d16 lazy", VK_FORMAT_D16_UNORM, false, true, true },
+		};
+		VkDeviceSize legacyMemory = 0;
+		uint64_t legacyStore = 0;
+		uint32_t wrongDepth = 0;
+		for (const Config &config : configs)
+		{
+			std::vector<AttachmentDesc> descs = { { "depth", config.format, extent,
+				config.history ? historyUsage : depthUsage, 0, 0, config.history } };
+			std::vector<AttachmentMemory> memory = { attachmentMemory(descs[0], config.lazy) };
+			AttachmentPlan plan = AttachmentPool::plan(descs, memory, config.transient, true);
+			RenderGraph::Stats stats = drawFrameStats(config.format, config.history);
+			if (!legacyMemory)
+			{
+				legacyMemory = plan.allocated;
+				legacyStore = stats.storeBytes;
+			}
+			//depth kept for the next frame is stored, transient depth never leaves the tile
+			uint64_t colorBytes = (uint64_t)extent.width * extent.height * 4;
+			wrongDepth += (stats.storeBytes > colorBytes) != config.history;
+			wrongDepth += plan.placements[0].lazy != (!config.history && config.lazy);
+			LOG << std::left << std::setw(20) << config.name << std::right << " memory " << std::fixed
+				<< std::setprecision(2) << plan.allocated / (1024.0 * 1024.0) << " MB (" << plan.lazy / (1024.0 * 1024.0)
+				<< " MB lazy), stores " << stats.storeBytes / (1024.0 * 1024.0) << " MB per frame, saves "
+				<< (legacyMemory - plan.allocated) / (1024.0 * 1024.0) << " MB and "
+				<< (legacyStore - stats.storeBytes) / (1024.0 * 1024.0) << " MB per frame" << ENDL;
+			LOG.unsetf(std::ios::floatfield);
+		}
+
+		//a post chain: the scene in hdr, bloom at half resolution in three
+		//steps, tonemapped to the swapchain. depth and the bloom targets whose
+		//steps do not overlap share memory
+		enum { SCENE, BRIGHT, BLUR_X, BLUR_Y, TONEMAP };
+		const VkExtent2D half = { extent.width / 2, extent.height / 2 };
+		const VkImageUsageFlags colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		std::vector<AttachmentDesc> post = {
+			{ "hdr", VK_FORMAT_R16G16B16A16_SFLOAT, extent, colorUsage, SCENE, TONEMAP, false },
+			{ "depth", VK_FORMAT_D32_SFLOAT, extent, depthUsage, SCENE, SCENE, false },
+			{ "bright", VK_FORMAT_R16G16B16A16_SFLOAT, half, colorUsage, BRIGHT, BLUR_X, false },
+			{ "blur x", VK_FORMAT_R16G16B16A16_SFLOAT, half, colorUsage, BLUR_X, BLUR_Y, false },
+			{ "blur y", VK_FORMAT_R16G16B16A16_SFLOAT, half, colorUsage, BLUR_Y, TONEMAP, false },
+		};
+		uint32_t conflicts = 0;
+		AttachmentPlan aliased;
+		//sampled color targets are not transient, only depth goes to lazy memory
+		for (int lazy = 0; lazy < 2; ++lazy)
+			for (int aliasing = 0; aliasing < 2; ++aliasing)
+			{
+				std::vector<AttachmentMemory> memory;
+				for (const AttachmentDesc &desc : post)
+					memory.push_back(attachmentMemory(desc, lazy != 0));
+				AttachmentPlan plan = AttachmentPool::plan(post, memory, true, aliasing != 0);
+				conflicts += aliasingConflicts(post, memory, plan);
+				if (!lazy && aliasing)
+					aliased = plan;
+				LOG << "post chain" << (lazy ? " lazy" : "") << (aliasing ? " aliased" : "") << " : " << std::fixed
+					<< std::setprecision(2) << plan.allocated / (1024.0 * 1024.0) << " MB in " << plan.heaps.size()
+					<< " allocations of " << plan.dedicated / (1024.0 * 1024.0) << " MB" << ENDL;
+				LOG.unsetf(std::ios::floatfield);
+			}
+		uint32_t wrongAlias = (aliased.allocated >= aliased.dedicated) + (aliased.heaps.size() != 1);
+		for (uint32_t i = 0; i < post.size(); ++i)
+		{
+			uint32_t alias = AttachmentPool::aliasOf(post, aliased, i);
+			if (alias != AttachmentPool::NO_ALIAS)
+				LOG << post[i].name << " at " << aliased.placements[i].offset << " after " << post[alias].name << ENDL;
+			wrongAlias += alias != AttachmentPool::NO_ALIAS && post[alias].lastPass >= post[i].firstPass;
+		}
+
+		//the graph waits for the earlier image before the first use of its alias
+		RenderGraph graph(VK_NULL_HANDLE);
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImageSubresourceRange depthRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		std::vector<uint32_t> images;
+		for (uint32_t i = 0; i < post.size(); ++i)
+			images.push_back(graph.importImage(post[i].name.c_str(), fakeHandle<VkImage>(i + 1), post[i].format,
+				i == 1 ? depthRange : colorRange));
+		uint32_t swapchain = graph.importImage("swapchain", fakeHandle<VkImage>(8), VK_FORMAT_B8G8R8A8_UNORM,
+			colorRange, GraphAccess::ACQUIRED);
+		graph.output(swapchain, GraphAccess::PRESENT);
+		auto none = [](VkCommandBuffer) {};
+		auto step = [&](const char* name, uint32_t target, uint32_t source, VkExtent2D size, uint32_t framebuffer)
+		{
+			uint32_t pass = graph.addPass(name, true, none);
+			graph.use(pass, target, GraphAccess::COLOR_ATTACHMENT);
+			graph.use(pass, source, GraphAccess::SAMPLED_FRAGMENT);
+			graph.target(pass, fakeHandle<VkFramebuffer>(framebuffer), size);
+			graph.clearAttachment(pass, target, VkClearValue());
+			return pass;
+		};
+		uint32_t scene = graph.addPass("scene", true, none);
+		graph.use(scene, images[0], GraphAccess::COLOR_ATTACHMENT);
+		graph.use(scene, images[1], GraphAccess::DEPTH_ATTACHMENT);
+		graph.target(scene, fakeHandle<VkFramebuffer>(1), extent);
+		graph.clearAttachment(scene, images[0], VkClearValue());
+		graph.clearAttachment(scene, images[1], VkClearValue());
+		step("bright", images[2], images[0], half, 2);
+		step("blur x", images[3], images[2], half, 3);
+		step("blur y", images[4], images[3], half, 4);
+		uint32_t tonemap = step("tonemap", swapchain, images[4], extent, 5);
+		graph.use(tonemap, images[0], GraphAccess::SAMPLED_FRAGMENT);
+		graph.compile();
+		uint32_t plainBarriers = graph.stats().barriers;
+		for (uint32_t i = 0; i < post.size(); ++i)
+		{
+			uint32_t alias = AttachmentPool::aliasOf(post, aliased, i);
+			if (alias != AttachmentPool::NO_ALIAS)
+				graph.aliases(images[i], images[alias]);
+		}
+		graph.compile();
+		const RenderGraph::Stats &stats = graph.stats();
+		//the waits go into the render pass dependencies, no barrier is added
+		wrongAlias += stats.barriers != plainBarriers;
+		wrongAlias += graph.attachments(graph.group(scene))[1].storeOp != VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		LOG << "post chain graph : " << stats.renderPasses << " render passes, " << stats.barriers << " barriers, load "
+			<< stats.loadBytes / 1024 << " KB store " << stats.storeBytes / 1024 << " KB" << ENDL;
+
+		double planNs = measure(256, [&] {
+			std::vector<AttachmentMemory> memory;
+			for (const AttachmentDesc &desc : post)
+				memory.push_back(attachmentMemory(desc, false));
+			AttachmentPlan plan = AttachmentPool::plan(post, memory, true, true);
+			consume(&plan.allocated, sizeof(plan.allocated));
+		});
+		LOG << "plan per build : " << planNs / 1000.0 << " us" << ENDL;
+
+		bool passed = true;
+		passed &= check("depth placement", wrongDepth, 0.0);
+		passed &= check("no live overlap", conflicts, 0.0);
+		passed &= check("aliasing", wrongAlias, 0.0);
+		return passed;
+	}
+
+	/*DYNAMIC RESOLUTION*/
+	//a 4k frame whose gpu time is a fixed part plus a part per pixel, under a
+	//load that changes while it runs
+	bool benchResolution()
+	{
+		LOG_SECTION("dynamic resolution");
+		const VkExtent2D full = { 3840, 2160 };
+		const double targetMs = 16.6;
+		const double fixedMs = 2.0;
+		std::mt19937 rng(7);
+		std::normal_distribution<double> noise(0.0, 0.03);
+
+		struct Phase
+		{
+			const char* name;
+			double fullMs;			//at scale 1
+			uint32_t frames;
+		};
+		const Phase phases[] = {
+			{ "heavy", 30.0, 600 },
+			{ "light", 10.0, 600 },
+			{ "too heavy", 90.0, 600 },
+			{ "heavy again", 30.0, 600 },
+		};
+		DynamicResolution resolution(targetMs);
+		uint32_t outOfBounds = 0, lateChanges = 0, overBudget = 0;
+		float endScale[4] = {};
+		for (uint32_t p = 0; p < 4; ++p)
+		{
+			const Phase &phase = phases[p];
+			uint32_t changes = resolution.changes();
+			double settledMs = 0.0, pixels = 0.0;
+			uint32_t settled = 0;
+			for (uint32_t frame = 0; frame < phase.frames; ++frame)
+			{
+				VkExtent2D extent = resolution.extent(full);
+				double share = (double)extent.width * extent.height / ((double)full.width * full.height);
+				double ms = (fixedMs + (phase.fullMs - fixedMs) * share) * (1.0 + noise(rng));
+				outOfBounds += resolution.scale() < 0.5f || resolution.scale() > 1.0f;
+				pixels += share;
+				//the last third has to hold still and fit
+				if (frame >= phase.frames * 2 / 3)
+				{
+					settledMs += ms;
+					++settled;
+					if (resolution.update(ms))
+						++lateChanges;
+				}
+				else
+					resolution.update(ms);
+			}
+			endScale[p] = resolution.scale();
+			settledMs /= settled;
+			//the smallest scale is allowed to miss the target
+			overBudget += settledMs > targetMs && endScale[p] > 0.5f;
+			VkExtent2D extent = resolution.extent(full);
+			LOG << std::left << std::setw(12) << phase.name << std::right << " " << phase.fullMs << " ms at full size : scale "
+				<< endScale[p] << " (" << extent.width << " x " << extent.height << "), " << settledMs
+				<< " ms settled, " << 100.0 * pixels / phase.frames << "% of the pixels, "
+				<< resolution.changes() - changes << " rebuilds in " << phase.frames << " frames" << ENDL;
+		}
+
+		//rebuilds against a target sized to every frame's scale
+		LOG << "render target rebuilds : " << resolution.changes() << " in 2400 frames" << ENDL;
+		double updateNs = measure(1 << 16, [&] {
+			bool changed = resolution.update(targetMs);
+			consume(&changed, sizeof(changed));
+		});
+		LOG << "update per frame : " << updateNs << " ns" << ENDL;
+
+		bool passed = true;
+		passed &= check("scale in bounds", outOfBounds, 0.0);
+		passed &= check("settled", lateChanges, 0.0);
+		passed &= check("within budget", overBudget, 0.0);
+		passed &= check("scale follows load", (endScale[0] >= 1.0f) + (endScale[1] < 1.0f) + (endScale[2] > 0.5f) +
+			(endScale[3] != endScale[0]), 0.0);
+		passed &= check("few rebuilds", resolution.changes() > 24, 0.0);
+		return passed;
+	}
+
+	struct Entry
+	{
+		const char* name;
+		bool(*fn)();
+	};
+
+	const Entry entries[] = {
+		{ "matrix", benchMatrix },
+		{ "transform", benchTransform },
+		{ "cull", benchCull },
+		{ "bvh", benchBvh },
+		{ "graph", benchGraph },
+		{ "occlusion", benchOcclusion },
+		{ "lod", benchLod },
+		{ "meshlet", benchMeshlet },
+		{ "queue", benchQueue },
+		{ "rendergraph", benchRenderGraph },
+		{ "attachments", benchAttachments },
+		{ "resolution", benchResolution },
+	};
+}
+}
+
+bool benchmark::run(const std::string &name)
+{
+	bool found = false;
+	bool passed = true;
+	for (auto &entry : entries)
+	{
+		if (name != "all" && name != entry.name)
+			continue;
+		found = true;
+		passed &= entry.fn();
+	}
+	if (!found)
+	{
+		LOG << "unknown benchmark : " << name << ", available :";
+		for (auto &entry : entries)
+			LOG << " " << entry.name;
+		LOG << ENDL;
+		return false;
+	}
+	return passed;
+}
+
+void benchmark::consume(const void* data, size_t size)
+{
+	static volatile uint8_t sink;
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint8_t sum = 0;
+	for (size_t i = 0; i < size; i += 64)
+		sum ^= bytes[i];
+	sink = sum;
+}
+
+void benchmark::report(const std::string &label, double scalarNs, double simdNs,
+	const char* scalarLabel, const char* simdLabel)
+{
+	LOG << std::left << std::setw(20) << label << std::right << std::fixed << std::setprecision(2)
+		<< " " << scalarLabel << " " << std::setw(9) << scalarNs << " ns"
+		<< "   " << simdLabel << " " << std::setw(9) << simdNs << " ns"
+		<< "   x" << std::setprecision(2) << scalarNs / std::max(simdNs, 1e-6) << ENDL;
+	LOG.unsetf(std::ios::floatfield);
+}
+
+bool benchmark::check(const std::string &label, double error, double tolerance)
+{
+	bool passed = error <= tolerance;
+	LOG << std::left << std::setw(20) << label << std::right << " max error " << error
+		<< (passed ? "  ok" : "  FAILED") << ENDL;
+	return passed;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <stdint.h>
+
+//command line kernel checks and micro benchmarks
+//QVulkan_Application --bench <name>, or --bench all
+namespace benchmark
+{
+	//returns false if nothing matched or a kernel check failed
+	bool run(const std::string &name);
+
+	//average nanoseconds per call of fn() over count calls
+	template<typename F>
+	double measure(uint32_t count, F &&fn);
+
+	//keeps the optimizer from dropping the timed work
+	void consume(const void* data, size_t size);
+
+	//one line per kernel: reference time, fast time and speed up
+	void report(const std::string &label, double scalarNs, double simdNs,
+		const char* scalarLabel = "scalar", const char* simdLabel = "simd");
+	//max error of a kernel against its reference, false if over tolerance
+	bool check(const std::string &label, double error, double tolerance);
+}
+
+template<typename F>
+inline double benchmark::measure(uint32_t count, F &&fn)
+{
+	//one warm up pass so caches and clocks settle
+	fn();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < count; ++i)
+		fn();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / count;
+}
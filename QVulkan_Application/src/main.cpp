@@ -10,6 +10,9 @@
 #include <Mipmap.h>
 #include <qlabel.h>
 #include <mathutil.h>
+#include <texturefile.h>
+#include <benchmark.h>
+#include <texturerenderer.h>
 
 //#define CHECK_LEAK
 #ifdef CHECK_LEAK
@@ -21,6 +24,29 @@ int main(int argc, char *argv[])
 
 	QApplication a(argc, argv);
 
+	//bake ./image into .qtex containers and quit
+	if (a.arguments().contains("--cook-textures"))
+	{
+		textureCooker::cookDirectory("./image");
+		return 0;
+	}
+
+	//kernel checks and timings, --bench <name> or --bench all
+	int bench = a.arguments().indexOf("--bench");
+	if (bench >= 0)
+		return benchmark::run(a.arguments().value(bench + 1, "all").toStdString()) ? 0 : 1;
+
+	//instancing stress test, --knots <count>
+	int knots = a.arguments().indexOf("--knots");
+	if (knots >= 0)
+		TextureRenderer::stressInstances = a.arguments().value(knots + 1, "100000").toUInt();
+	TextureRenderer::cpuCulling = a.arguments().contains("--cpu-culling");
+	TextureRenderer::bindlessTextures = !a.arguments().contains("--no-bindless");
+	//dynamic resolution, --frame-ms <target gpu ms>
+	int frameMs = a.arguments().indexOf("--frame-ms");
+	if (frameMs >= 0)
+		TextureRenderer::targetFrameMs = a.arguments().value(frameMs + 1, "16.6").toDouble();
+
 	MainWindow mw;
 	mw.setGeometry(810, 300, 1024, 620);
 	mw.show();
@@ -3,11 +3,14 @@
 #include <mathutil.h>
 #include <color.h>
 
-Mipmap::Mipmap(uint32_t width, uint32_t height, const uint8_t *pixels, int setlevels)
+Mipmap::Mipmap(uint32_t width, uint32_t height, const uint8_t *pixels, int setlevels, bool bgra)
 	: m_width(width), m_height(height)
 {
 	/*BUILD A PRIMARY MIPMAP*/
 	rgba_ptr primary = rgba_ptr(new rgba[width * height]);			//we dont need to mutiply 4
+	//red and blue byte index
+	const uint32_t r = bgra ? 2 : 0;
+	const uint32_t b = bgra ? 0 : 2;
 	for (uint32_t y = 0; y < height; ++y)
 	{
 		for (uint32_t x = 0; x < width; ++x)
@@ -16,9 +19,9 @@ Mipmap::Mipmap(uint32_t width, uint32_t height, const uint8_t *pixels, int setle
 			uint32_t index = y* width + x;
 			rgba p = {
 				//vulkan ABGR8888 so we need to inverse that
-				pixels[bitIndex + 2],
+				pixels[bitIndex + r],
 				pixels[bitIndex + 1],
-				pixels[bitIndex + 0],
+				pixels[bitIndex + b],
 				pixels[bitIndex + 3]
 			};
 
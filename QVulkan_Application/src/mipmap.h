@@ -17,7 +17,8 @@ struct MapBuffer
 class Mipmap
 {
 public:
-	Mipmap(uint32_t width, uint32_t height, const uint8_t *pixels, int setlevels = 1);
+	//pixels are BGRA (QImage RGB32) unless bgra is false, then RGBA (stb_image)
+	Mipmap(uint32_t width, uint32_t height, const uint8_t *pixels, int setlevels = 1, bool bgra = true);
 	~Mipmap();
 
 	uint32_t m_width, m_height;
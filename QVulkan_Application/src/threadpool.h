@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <algorithm>
+
+//fixed size worker pool shared by loaders and per frame jobs
+//tasks must not block on other tasks of the same pool
+class ThreadPool
+{
+public:
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	static ThreadPool& global();
+
+	uint32_t size() const { return (uint32_t)m_workers.size(); }
+
+	template<typename F>
+	auto enqueue(F &&task)->std::future<decltype(task())>;
+
+	//split [0, count) in chunks and run fn(begin, end) on the pool and caller
+	template<typename F>
+	void parallelFor(uint32_t count, uint32_t minChunk, F &&fn);
+
+private:
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop = false;
+};
+
+inline ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	//leave one core for the render thread
+	if (threadCount == 0)
+		threadCount = std::max(2U, std::thread::hardware_concurrency()) - 1;
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		m_workers.emplace_back([this]
+		{
+			for (;;)
+			{
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+					if (m_stop && m_tasks.empty())
+						return;
+					task = std::move(m_tasks.front());
+					m_tasks.pop();
+				}
+				task();
+			}
+		});
+	}
+}
+
+inline ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	for (auto &worker : m_workers)
+		worker.join();
+}
+
+inline ThreadPool& ThreadPool::global()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+template<typename F>
+inline auto ThreadPool::enqueue(F &&task)->std::future<decltype(task())>
+{
+	typedef decltype(task()) return_type;
+	auto packaged = std::make_shared<std::packaged_task<return_type()>>(std::forward<F>(task));
+	std::future<return_type> result = packaged->get_future();
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_tasks.emplace([packaged] { (*packaged)(); });
+	}
+	m_condition.notify_one();
+	return result;
+}
+
+template<typename F>
+inline void ThreadPool::parallelFor(uint32_t count, uint32_t minChunk, F &&fn)
+{
+	if (count == 0) return;
+	uint32_t chunks = std::min(size() + 1, (count + minChunk - 1) / std::max(1U, minChunk));
+	if (chunks <= 1) {
+		fn(0U, count);
+		return;
+	}
+	uint32_t chunkSize = (count + chunks - 1) / chunks;
+
+	std::vector<std::future<void>> pending;
+	for (uint32_t begin = chunkSize; begin < count; begin += chunkSize)
+	{
+		uint32_t end = std::min(count, begin + chunkSize);
+		pending.push_back(enqueue([&fn, begin, end] { fn(begin, end); }));
+	}
+	//first chunk on the calling thread
+	fn(0U, std::min(count, chunkSize));
+	for (auto &job : pending)
+		job.get();
+}
@@ -0,0 +1,305 @@
+#include "bvh.h"
+#include <algorithm>
+#include <math.h>
+
+Ray::Ray(const vec3f &origin, const vec3f &direction, float tmax)
+	: origin(origin), direction(direction), tmax(tmax)
+{
+	//a zero component would give 0 * inf = nan in the slab test
+	for (int i = 0; i < 3; ++i)
+		inverse[i] = direction[i] != 0.0f ? 1.0f / direction[i] : FLT_MAX;
+}
+
+float Ray::intersect(const vec3f &min, const vec3f &max) const
+{
+	float tx0 = (min.x - origin.x) * inverse.x, tx1 = (max.x - origin.x) * inverse.x;
+	float ty0 = (min.y - origin.y) * inverse.y, ty1 = (max.y - origin.y) * inverse.y;
+	float tz0 = (min.z - origin.z) * inverse.z, tz1 = (max.z - origin.z) * inverse.z;
+	float enter = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::min(tz0, tz1));
+	float exit = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+	enter = std::max(enter, 0.0f);
+	return (enter <= exit && enter < tmax) ? enter : FLT_MAX;
+}
+
+/*BUILD*/
+namespace
+{
+	const int BIN_COUNT = 12;
+
+	//vec3f::dot / cross live in vec3f.cpp, the hot loops here want them inlined
+	inline float dot3(const vec3f &a, const vec3f &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline vec3f cross3(const vec3f &a, const vec3f &b)
+	{
+		return vec3f(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	struct Box
+	{
+		vec3f min = vec3f(FLT_MAX);
+		vec3f max = vec3f(-FLT_MAX);
+
+		void grow(const vec3f &p)
+		{
+			min.x = std::min(min.x, p.x); min.y = std::min(min.y, p.y); min.z = std::min(min.z, p.z);
+			max.x = std::max(max.x, p.x); max.y = std::max(max.y, p.y); max.z = std::max(max.z, p.z);
+		}
+		void grow(const vec3f &a, const vec3f &b) { grow(a); grow(b); }
+		void grow(const Box &b) { grow(b.min, b.max); }
+		float area() const
+		{
+			if (min.x > max.x) return 0.0f;
+			vec3f e = max - min;
+			return e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+	};
+}
+
+struct Bvh::Builder
+{
+	const std::vector<Bounds> &primitives;
+	std::vector<BvhNode> &nodes;
+	std::vector<uint32_t> &indices;
+	uint32_t maxLeafSize;
+
+	void split(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+	{
+		Box box, centroids;
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const Bounds &b = primitives[indices[i]];
+			box.grow(b.min, b.max);
+			centroids.grow(b.center);
+		}
+		nodes[nodeIndex].min = box.min;
+		nodes[nodeIndex].max = box.max;
+		nodes[nodeIndex].first = begin;
+		nodes[nodeIndex].count = end - begin;
+
+		uint32_t count = end - begin;
+		if (count <= maxLeafSize || depth >= maxDepth)
+			return;
+
+		//cheapest bin boundary over all three axes
+		float bestCost = FLT_MAX;
+		int bestAxis = -1, bestBin = 0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float lo = centroids.min[axis], extent = centroids.max[axis] - lo;
+			if (extent <= 0.0f) continue;
+			float scale = BIN_COUNT / extent;
+
+			Box bins[BIN_COUNT];
+			uint32_t counts[BIN_COUNT] = {};
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const Bounds &b = primitives[indices[i]];
+				int bin = std::min(BIN_COUNT - 1, int(((&b.center.x)[axis] - lo) * scale));
+				bins[bin].grow(b.min, b.max);
+				counts[bin]++;
+			}
+
+			//right to left sweep first, then left to right evaluates each boundary
+			float rightArea[BIN_COUNT];
+			uint32_t rightCount[BIN_COUNT];
+			Box right;
+			uint32_t n = 0;
+			for (int i = BIN_COUNT - 1; i > 0; --i)
+			{
+				right.grow(bins[i]);
+				n += counts[i];
+				rightArea[i] = right.area();
+				rightCount[i] = n;
+			}
+			Box left;
+			n = 0;
+			for (int i = 0; i < BIN_COUNT - 1; ++i)
+			{
+				left.grow(bins[i]);
+				n += counts[i];
+				float cost = n * left.area() + rightCount[i + 1] * rightArea[i + 1];
+				if (n && rightCount[i + 1] && cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = i;
+				}
+			}
+		}
+
+		//splitting has to beat intersecting everything here, huge leaves are
+		//split anyway so a query never walks thousands of primitives
+		float leafCost = count * box.area();
+		if (bestAxis >= 0 && bestCost >= leafCost && count <= maxLeafSize * 4)
+			return;
+
+		uint32_t mid;
+		if (bestAxis >= 0)
+		{
+			float lo = centroids.min[bestAxis];
+			float scale = BIN_COUNT / (centroids.max[bestAxis] - lo);
+			mid = uint32_t(std::partition(indices.begin() + begin, indices.begin() + end, [&](uint32_t id) {
+				return std::min(BIN_COUNT - 1, int(((&primitives[id].center.x)[bestAxis] - lo) * scale)) <= bestBin;
+			}) - indices.begin());
+		}
+		else
+		{
+			//every centroid in one spot, halve the list
+			mid = begin + count / 2;
+		}
+
+		uint32_t left = (uint32_t)nodes.size();
+		nodes.push_back(BvhNode());
+		nodes.push_back(BvhNode());
+		nodes[nodeIndex].first = left;
+		nodes[nodeIndex].count = 0;
+		split(left, begin, mid, depth + 1);
+		split(left + 1, mid, end, depth + 1);
+	}
+};
+
+void Bvh::build(const std::vector<Bounds> &primitives, uint32_t maxLeafSize)
+{
+	clear();
+	if (primitives.empty()) return;
+
+	indices.resize(primitives.size());
+	for (uint32_t i = 0; i < indices.size(); ++i)
+		indices[i] = i;
+	nodes.reserve(primitives.size() * 2);
+	nodes.push_back(BvhNode());
+
+	Builder builder = { primitives, nodes, indices, std::max(1U, maxLeafSize) };
+	builder.split(0, 0, (uint32_t)primitives.size(), 0);
+}
+
+void Bvh::refit(const std::vector<Bounds> &primitives)
+{
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		BvhNode &node = nodes[i];
+		Box box;
+		if (node.leaf()) {
+			for (uint32_t j = node.first; j < node.first + node.count; ++j)
+				box.grow(primitives[indices[j]].min, primitives[indices[j]].max);
+		}
+		else {
+			box.grow(nodes[node.first].min, nodes[node.first].max);
+			box.grow(nodes[node.first + 1].min, nodes[node.first + 1].max);
+		}
+		node.min = box.min;
+		node.max = box.max;
+	}
+}
+
+/*QUERIES*/
+void Bvh::cull(const Frustum &frustum, const std::vector<Bounds> &primitives,
+	std::vector<uint32_t> &visible) const
+{
+	visible.clear();
+	if (nodes.empty()) return;
+
+	//second stack entry says the subtree is known to be inside
+	std::pair<uint32_t, bool> stack[maxDepth * 2 + 2];
+	uint32_t top = 0;
+	stack[top++] = std::make_pair(0U, false);
+	while (top)
+	{
+		uint32_t index = stack[top - 1].first;
+		bool inside = stack[top - 1].second;
+		--top;
+		const BvhNode &node = nodes[index];
+		if (!inside)
+		{
+			Containment c = frustum.classify(node.min, node.max);
+			if (c == Containment::OUTSIDE) continue;
+			inside = c == Containment::INSIDE;
+		}
+		if (node.leaf())
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+				if (inside || frustum.contains(primitives[indices[i]]))
+					visible.push_back(indices[i]);
+			continue;
+		}
+		stack[top++] = std::make_pair(node.first + 1, inside);
+		stack[top++] = std::make_pair(node.first, inside);
+	}
+}
+
+uint32_t Bvh::depth() const
+{
+	if (nodes.empty()) return 0;
+	std::vector<uint32_t> level(nodes.size(), 0);
+	uint32_t deepest = 1;
+	level[0] = 1;
+	//parents come first
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		deepest = std::max(deepest, level[i]);
+		if (!nodes[i].leaf())
+			level[nodes[i].first] = level[nodes[i].first + 1] = level[i] + 1;
+	}
+	return deepest;
+}
+
+/*TRIANGLES*/
+void TriangleBvh::build(const vec3f* positions, size_t stride, const uint32_t* triangleIndices, size_t indexCount)
+{
+	size_t count = indexCount / 3;
+	corners.resize(count * 3);
+	std::vector<Bounds> bounds(count);
+	const char* base = (const char*)positions;
+	for (size_t t = 0; t < count; ++t)
+	{
+		Box box;
+		for (int k = 0; k < 3; ++k)
+		{
+			corners[t * 3 + k] = *(const vec3f*)(base + triangleIndices[t * 3 + k] * stride);
+			box.grow(corners[t * 3 + k]);
+		}
+		bounds[t].min = box.min;
+		bounds[t].max = box.max;
+		bounds[t].center = (box.min + box.max) * 0.5f;
+	}
+	bvh.build(bounds, 4);
+}
+
+bool TriangleBvh::intersectTriangle(uint32_t triangle, Ray &ray, RayHit &hit) const
+{
+	//Moller / Trumbore, both faces
+	const vec3f &a = corners[triangle * 3 + 0];
+	vec3f e1 = corners[triangle * 3 + 1] - a;
+	vec3f e2 = corners[triangle * 3 + 2] - a;
+	vec3f p = cross3(ray.direction, e2);
+	float det = dot3(e1, p);
+	if (fabsf(det) < 1e-12f) return false;
+
+	float inv = 1.0f / det;
+	vec3f s = ray.origin - a;
+	float u = dot3(s, p) * inv;
+	if (u < 0.0f || u > 1.0f) return false;
+	vec3f q = cross3(s, e1);
+	float v = dot3(ray.direction, q) * inv;
+	if (v < 0.0f || u + v > 1.0f) return false;
+	float t = dot3(e2, q) * inv;
+	if (t <= 0.0f || t >= ray.tmax) return false;
+
+	ray.tmax = t;
+	hit.t = t;
+	hit.triangle = triangle;
+	hit.u = u;
+	hit.v = v;
+	return true;
+}
+
+bool TriangleBvh::intersect(Ray &ray, RayHit &hit) const
+{
+	return bvh.intersect(ray, [&](uint32_t triangle, Ray &r) { return intersectTriangle(triangle, r, hit); });
+}
+
+bool TriangleBvh::intersectLinear(Ray &ray, RayHit &hit) const
+{
+	bool found = false;
+	for (uint32_t t = 0; t < triangleCount(); ++t)
+		found |= intersectTriangle(t, ray, hit);
+	return found;
+}
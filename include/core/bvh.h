@@ -0,0 +1,136 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <stdint.h>
+#include <float.h>
+#include <vec3f.h>
+#include <frustum.h>
+
+struct Ray
+{
+	Ray() : tmax(FLT_MAX) {}
+	//direction does not have to be unit length, t is in its units
+	Ray(const vec3f &origin, const vec3f &direction, float tmax = FLT_MAX);
+
+	vec3f origin;
+	vec3f direction;
+	vec3f inverse;
+	float tmax;
+
+	//entry distance into the box, FLT_MAX when missed or beyond tmax
+	float intersect(const vec3f &min, const vec3f &max) const;
+};
+
+//32 bytes, leaves have count > 0 and index primitives [first, first + count)
+//of Bvh::indices, inner nodes have their children at first and first + 1
+struct BvhNode
+{
+	vec3f min;
+	uint32_t first;
+	vec3f max;
+	uint32_t count;
+
+	bool leaf() const { return count != 0; }
+};
+
+//binned surface area heuristic hierarchy over any boxed primitives.
+//children always come after their parent, refit walks the array backwards
+class Bvh
+{
+public:
+	std::vector<BvhNode> nodes;
+	std::vector<uint32_t> indices;
+
+	void build(const std::vector<Bounds> &primitives, uint32_t maxLeafSize = 4);
+	//same topology, boxes refreshed from moved primitives. quality drops with
+	//large motion, rebuild then
+	void refit(const std::vector<Bounds> &primitives);
+	void clear() { nodes.clear(); indices.clear(); }
+	bool empty() const { return nodes.empty(); }
+
+	//same result as testing Frustum::contains(Bounds) on every primitive,
+	//subtrees fully inside are taken without tests. visible is not sorted
+	void cull(const Frustum &frustum, const std::vector<Bounds> &primitives,
+		std::vector<uint32_t> &visible) const;
+
+	//near child first. hit(primitive, ray) tests one primitive and shortens
+	//ray.tmax on a hit, returns true if anything was hit
+	template<typename F>
+	bool intersect(Ray &ray, F &&hit) const;
+
+	uint32_t depth() const;
+
+	//deeper splits become leaves, keeps the traversal stacks bounded
+	static const uint32_t maxDepth = 48;
+
+private:
+	struct Builder;
+};
+
+template<typename F>
+inline bool Bvh::intersect(Ray &ray, F &&hit) const
+{
+	if (nodes.empty() || ray.intersect(nodes[0].min, nodes[0].max) == FLT_MAX)
+		return false;
+
+	bool found = false;
+	uint32_t stack[64];
+	uint32_t top = 0;
+	stack[top++] = 0;
+	while (top)
+	{
+		const BvhNode &node = nodes[stack[--top]];
+		if (node.leaf())
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+				found |= hit(indices[i], ray);
+			continue;
+		}
+		//near / far are macros on win32
+		uint32_t closer = node.first, farther = node.first + 1;
+		float tCloser = ray.intersect(nodes[closer].min, nodes[closer].max);
+		float tFarther = ray.intersect(nodes[farther].min, nodes[farther].max);
+		if (tFarther < tCloser) {
+			std::swap(closer, farther);
+			std::swap(tCloser, tFarther);
+		}
+		//pushed last, popped first
+		if (tFarther != FLT_MAX) stack[top++] = farther;
+		if (tCloser != FLT_MAX) stack[top++] = closer;
+	}
+	return found;
+}
+
+struct RayHit
+{
+	float t = FLT_MAX;
+	uint32_t instance = UINT32_MAX;
+	uint32_t triangle = UINT32_MAX;
+	float u = 0.0f, v = 0.0f;
+
+	bool valid() const { return triangle != UINT32_MAX; }
+};
+
+//triangle soup of one mesh with its own hierarchy, object space
+class TriangleBvh
+{
+public:
+	Bvh bvh;
+	//three corners per triangle, in index buffer order
+	std::vector<vec3f> corners;
+
+	//stride in bytes so interleaved vertices work
+	void build(const vec3f* positions, size_t stride, const uint32_t* indices, size_t indexCount);
+	size_t triangleCount() const { return corners.size() / 3; }
+
+	//closest hit, fills t / triangle / u / v and shortens ray.tmax
+	bool intersect(Ray &ray, RayHit &hit) const;
+	//every triangle, the brute force reference
+	bool intersectLinear(Ray &ray, RayHit &hit) const;
+
+private:
+	bool intersectTriangle(uint32_t triangle, Ray &ray, RayHit &hit) const;
+};
+
+#endif // BVH_H
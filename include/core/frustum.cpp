@@ -0,0 +1,197 @@
+#include "frustum.h"
+#include <vec3soa.h>
+#include <simd.h>
+#include <math.h>
+
+Bounds::Bounds(const vec3f &min, const vec3f &max)
+	: min(min), max(max), center((min + max) * 0.5f), radius((max - min).length() * 0.5f)
+{
+}
+
+Bounds Bounds::fromPoints(const vec3f* points, size_t count, size_t stride)
+{
+	Bounds b;
+	if (count == 0) return b;
+
+	vec3soa soa;
+	soa.assign(points, count, stride);
+	vml::bounds(soa, b.min, b.max);
+	b.center = (b.min + b.max) * 0.5f;
+
+	float radius2 = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+		radius2 = std::max(radius2, (soa.get(i) - b.center).length2());
+	b.radius = sqrtf(radius2);
+	return b;
+}
+
+Bounds Bounds::transformed(const Matrix4x4 &m) const
+{
+	if (empty()) return *this;
+
+	//Arvo: each output axis picks the smaller / larger product per input axis
+	Bounds b;
+	for (int i = 0; i < 3; ++i)
+	{
+		b.min[i] = b.max[i] = m[i][3];
+		for (int j = 0; j < 3; ++j)
+		{
+			float e = m[i][j] * min[j];
+			float f = m[i][j] * max[j];
+			b.min[i] += std::min(e, f);
+			b.max[i] += std::max(e, f);
+		}
+	}
+	b.center = m * center;
+
+	float scale2 = 0.0f;
+	for (int j = 0; j < 3; ++j)
+		scale2 = std::max(scale2, m[0][j] * m[0][j] + m[1][j] * m[1][j] + m[2][j] * m[2][j]);
+	b.radius = radius * sqrtf(scale2);
+	return b;
+}
+
+void Frustum::extract(const Matrix4x4 &M, float nearW)
+{
+	for (int j = 0; j < 4; ++j)
+	{
+		planes[0][j] = M[3][j] + M[0][j];
+		planes[1][j] = M[3][j] - M[0][j];
+		planes[2][j] = M[3][j] + M[1][j];
+		planes[3][j] = M[3][j] - M[1][j];
+		planes[4][j] = M[2][j] + M[3][j] * nearW;
+		planes[5][j] = M[3][j] - M[2][j];
+	}
+	for (auto &plane : planes)
+	{
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		float inv = length > 0.0f ? 1.0f / length : 0.0f;
+		for (int j = 0; j < 4; ++j)
+			plane[j] *= inv;
+	}
+}
+
+bool Frustum::contains(const vec3f &c, float radius) const
+{
+	for (auto &plane : planes)
+	{
+		//same evaluation order as the batch kernel
+		float d = c.x * plane[0] + plane[3];
+		d = c.y * plane[1] + d;
+		d = c.z * plane[2] + d;
+		if (d + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::contains(const Bounds &b) const
+{
+	if (!contains(b.center, b.radius))
+		return false;
+	for (auto &plane : planes)
+	{
+		float x = plane[0] >= 0.0f ? b.max.x : b.min.x;
+		float y = plane[1] >= 0.0f ? b.max.y : b.min.y;
+		float z = plane[2] >= 0.0f ? b.max.z : b.min.z;
+		if (x * plane[0] + y * plane[1] + z * plane[2] + plane[3] < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+Containment Frustum::classify(const vec3f &min, const vec3f &max) const
+{
+	Containment result = Containment::INSIDE;
+	for (auto &plane : planes)
+	{
+		//corner farthest along the normal, then the nearest one
+		float x = plane[0] >= 0.0f ? max.x : min.x;
+		float y = plane[1] >= 0.0f ? max.y : min.y;
+		float z = plane[2] >= 0.0f ? max.z : min.z;
+		if (x * plane[0] + y * plane[1] + z * plane[2] + plane[3] < 0.0f)
+			return Containment::OUTSIDE;
+		x = plane[0] >= 0.0f ? min.x : max.x;
+		y = plane[1] >= 0.0f ? min.y : max.y;
+		z = plane[2] >= 0.0f ? min.z : max.z;
+		if (x * plane[0] + y * plane[1] + z * plane[2] + plane[3] < 0.0f)
+			result = Containment::INTERSECT;
+	}
+	return result;
+}
+
+#if VML_SIMD != VML_SIMD_NONE
+namespace
+{
+	using namespace simd;
+
+	//one bit per lane that survives every plane, written out as indices
+	template<typename V>
+	size_t cullKernel(const Frustum &frustum, const vec3soa &centers, const float* radii, uint32_t* out)
+	{
+		typedef lanes<V> L;
+		V px[6], py[6], pz[6], pw[6];
+		for (int p = 0; p < 6; ++p)
+		{
+			px[p] = L::splat(frustum.planes[p][0]);
+			py[p] = L::splat(frustum.planes[p][1]);
+			pz[p] = L::splat(frustum.planes[p][2]);
+			pw[p] = L::splat(frustum.planes[p][3]);
+		}
+		V zero = L::splat(0.0f);
+		const int all = (1 << L::width) - 1;
+
+		uint32_t* write = out;
+		size_t count = centers.size() / L::width * L::width;
+		for (size_t i = 0; i < count; i += L::width)
+		{
+			V x = L::load(&centers.x[i]);
+			V y = L::load(&centers.y[i]);
+			V z = L::load(&centers.z[i]);
+			V r = L::load(&radii[i]);
+
+			//smallest signed distance plus radius, negative means outside
+			V closest = add(madd(z, pz[0], madd(y, py[0], madd(x, px[0], pw[0]))), r);
+			for (int p = 1; p < 6; ++p)
+				closest = min(closest, add(madd(z, pz[p], madd(y, py[p], madd(x, px[p], pw[p]))), r));
+
+			int inside = ~mask(less(closest, zero)) & all;
+			while (inside)
+			{
+				int lane = 0;
+				while (!(inside & (1 << lane))) ++lane;
+				*write++ = uint32_t(i + lane);
+				inside &= inside - 1;
+			}
+		}
+		return write - out;
+	}
+}
+#endif
+
+size_t vml::cull(const Frustum &frustum, const vec3soa &centers, const std::vector<float> &radii,
+	std::vector<uint32_t> &visible)
+{
+	visible.resize(centers.size());
+	size_t done = 0, written = 0;
+#if VML_SIMD != VML_SIMD_NONE
+	written = cullKernel<simd::floatN>(frustum, centers, radii.data(), visible.data());
+	done = centers.size() / simd::lanes<simd::floatN>::width * simd::lanes<simd::floatN>::width;
+#endif
+	for (size_t i = done; i < centers.size(); ++i)
+		if (frustum.contains(centers.get(i), radii[i]))
+			visible[written++] = uint32_t(i);
+	visible.resize(written);
+	return written;
+}
+
+/*SCALAR REFERENCE*/
+size_t vml::scalar::cull(const Frustum &frustum, const vec3soa &centers, const std::vector<float> &radii,
+	std::vector<uint32_t> &visible)
+{
+	visible.clear();
+	for (size_t i = 0; i < centers.size(); ++i)
+		if (frustum.contains(centers.get(i), radii[i]))
+			visible.push_back(uint32_t(i));
+	return visible.size();
+}
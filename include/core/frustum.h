@@ -0,0 +1,86 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <vector>
+#include <stdint.h>
+#include <float.h>
+#include <vec3f.h>
+#include <matrix4x4.h>
+
+class vec3soa;
+
+//axis aligned box plus the sphere around it, the sphere is what the batch
+//cull tests, the box refines single objects
+struct Bounds
+{
+	Bounds() : min(FLT_MAX), max(-FLT_MAX), center(), radius(0.0f) {}
+	//sphere through the box corners
+	Bounds(const vec3f &min, const vec3f &max);
+
+	vec3f min, max;
+	vec3f center;
+	float radius;
+
+	bool empty() const { return min.x > max.x; }
+
+	//box from vml::bounds, sphere from the farthest point to the box center,
+	//stride in bytes so interleaved vertices work
+	static Bounds fromPoints(const vec3f* points, size_t count, size_t stride = sizeof(vec3f));
+
+	//box grows to hold the transformed box, radius scales by the largest axis
+	Bounds transformed(const Matrix4x4 &m) const;
+};
+
+enum class Containment : uint32_t
+{
+	OUTSIDE = 0, INTERSECT, INSIDE
+};
+
+class Frustum
+{
+public:
+	Frustum() {}
+	explicit Frustum(const Matrix4x4 &viewProj) { extract(viewProj); }
+
+	//left, right, bottom, top, near, far. normal points inside and is unit length,
+	//distance = dot(plane.xyz, p) + plane.w
+	float planes[6][4];
+
+	//planes of proj * view (Gribb / Hartmann), world space when view is
+	//the camera view. the depth policy picks the near plane
+	template<typename C = vml::VulkanConvention>
+	void extract(const Matrix4x4 &viewProj);
+
+	//false only if the sphere is completely outside one plane
+	bool contains(const vec3f &center, float radius) const;
+	//sphere first, then the box corner farthest along each plane normal
+	bool contains(const Bounds &bounds) const;
+	//box only, INSIDE lets a hierarchy accept a whole subtree untested
+	Containment classify(const vec3f &min, const vec3f &max) const;
+
+private:
+	void extract(const Matrix4x4 &viewProj, float nearW);
+};
+
+template<typename C>
+inline void Frustum::extract(const Matrix4x4 &viewProj)
+{
+	extract(viewProj, C::depth::nearW());
+}
+
+/*BATCH CULLING*/
+namespace vml
+{
+	//indices of the spheres that touch the frustum, in ascending order.
+	//8 spheres per step on AVX, 4 on SSE/NEON, returns visible.size()
+	size_t cull(const Frustum &frustum, const vec3soa &centers, const std::vector<float> &radii,
+		std::vector<uint32_t> &visible);
+
+	namespace scalar
+	{
+		size_t cull(const Frustum &frustum, const vec3soa &centers, const std::vector<float> &radii,
+			std::vector<uint32_t> &visible);
+	}
+}
+
+#endif // FRUSTUM_H
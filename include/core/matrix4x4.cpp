@@ -1,6 +1,31 @@
 ﻿#include "matrix4x4.h"
 #include <memory>
 #include <vec3f.h>
+#include <simd.h>
+
+/*COMPILE TIME CHECKS*/
+//the policies fold into constants, so a wrong sign or depth range fails the build
+namespace
+{
+	constexpr vml::mat4c vkProj = vml::perspective<vml::VulkanConvention>(90.0f, 1.0f, 1.0f, 11.0f);
+	constexpr vml::mat4c glProj = vml::perspective<vml::OpenGLConvention>(90.0f, 1.0f, 1.0f, 11.0f);
+	constexpr vml::mat4c vkClip = vml::mat4c(
+		1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.5f, 0.5f, 0.0f, 0.0f, 0.0f, 1.0f) * glProj;
+	static_assert(vkProj.at(1, 1) < 0.0f && glProj.at(1, 1) > 0.0f, "vulkan clip space points y down");
+	static_assert(vkProj.at(0, 0) > 0.99999f && vkProj.at(0, 0) < 1.00001f, "constexpr tan");
+	//near plane at depth 0 for vulkan, -1 for opengl, both look down -z
+	static_assert(vkProj.at(2, 2) * -1.0f + vkProj.at(2, 3) == 0.0f, "vulkan depth is zero to one");
+	static_assert(glProj.at(2, 2) * -1.0f + glProj.at(2, 3) == -1.0f, "opengl depth is minus one to one");
+	static_assert(vkProj.at(3, 2) == -1.0f && vkClip.at(3, 2) == -1.0f, "right handed");
+	static_assert(vkClip.at(2, 2) - vkProj.at(2, 2) < 1e-6f && vkProj.at(2, 2) - vkClip.at(2, 2) < 1e-6f,
+		"folded clip matches the clip matrix product");
+
+	constexpr vml::mat4c view = vml::lookAt<vml::VulkanConvention>(
+		vml::vec3c(0.0f, 0.0f, 5.0f), vml::vec3c(0.0f, 0.0f, 0.0f), vml::vec3c(0.0f, 1.0f, 0.0f));
+	static_assert(view.at(2, 2) == 1.0f && view.at(2, 3) == -5.0f, "view looks down -z");
+	static_assert(sizeof(vml::mat4c) == sizeof(Matrix4x4) && sizeof(vml::vec3c) == sizeof(vec3f), "same layout");
+}
 
 const Matrix4x4 Matrix4x4::zero = Matrix4x4(0.f, 0.f, 0.f, 0.f,
 	0.f, 0.f, 0.f, 0.f,
@@ -50,18 +75,43 @@ Matrix4x4::Matrix4x4(float m00, float m01, float m02, float m03,
 
 Matrix4x4 Matrix4x4::operator*(const Matrix4x4 &other) const
 {
+#if VML_SIMD == VML_SIMD_AVX
+	//two rows per register, the lane splats stay inside each 128 bit half
 	Matrix4x4 M;
-
+	__m128 b[4];
+	__m256 bb[4];
 	for (int i = 0; i < 4; ++i) {
-		for (int j = 0; j < 4; ++j) {
-			M.m[i][j] =
-				m[i][0] * other.m[0][j] +
-				m[i][1] * other.m[1][j] +
-				m[i][2] * other.m[2][j] +
-				m[i][3] * other.m[3][j];
-		}
+		b[i] = _mm_loadu_ps(other.m[i]);
+		bb[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(b[i]), b[i], 1);
+	}
+	for (int i = 0; i < 4; i += 2) {
+		__m256 a = _mm256_loadu_ps(m[i]);
+		__m256 r = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), bb[0]);
+		r = _mm256_add_ps(_mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x55), bb[1]), r);
+		r = _mm256_add_ps(_mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xAA), bb[2]), r);
+		r = _mm256_add_ps(_mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xFF), bb[3]), r);
+		_mm256_storeu_ps(M.m[i], r);
 	}
 	return M;
+#elif VML_SIMD != VML_SIMD_NONE
+	//row i of the result is sum(a[i][k] * b.row(k))
+	Matrix4x4 M;
+	simd::float4 b0 = simd::load(other.m[0]);
+	simd::float4 b1 = simd::load(other.m[1]);
+	simd::float4 b2 = simd::load(other.m[2]);
+	simd::float4 b3 = simd::load(other.m[3]);
+	for (int i = 0; i < 4; ++i) {
+		simd::float4 a = simd::load(m[i]);
+		simd::float4 r = simd::mul(simd::splat<0>(a), b0);
+		r = simd::madd(simd::splat<1>(a), b1, r);
+		r = simd::madd(simd::splat<2>(a), b2, r);
+		r = simd::madd(simd::splat<3>(a), b3, r);
+		simd::store(M.m[i], r);
+	}
+	return M;
+#else
+	return vml::scalar::multiply(*this, other);
+#endif
 }
 
 Matrix4x4& Matrix4x4::operator*=(const Matrix4x4 &other)
@@ -117,24 +167,27 @@ void Matrix4x4::setToIdentity()
 
 Matrix4x4& Matrix4x4::transpose()
 {
-	for (int row = 0; row < 4; ++row)
-		for (int col = row + 1; col < 4; ++col)
-		{
-			float tmp = m[row][col];
-			m[row][col] = m[col][row];
-			m[col][row] = tmp;
-		}
-
+	*this = transposed();
 	return *this;
 }
 
 Matrix4x4 Matrix4x4::transposed() const
 {
+#if VML_SIMD != VML_SIMD_NONE
 	Matrix4x4 M;
-	for (int row = 0; row < 4; ++row)
-		for (int col = 0; col < 4; ++col)
-			M.m[row][col] = m[col][row];
+	simd::float4 r0 = simd::load(m[0]);
+	simd::float4 r1 = simd::load(m[1]);
+	simd::float4 r2 = simd::load(m[2]);
+	simd::float4 r3 = simd::load(m[3]);
+	simd::transpose(r0, r1, r2, r3);
+	simd::store(M.m[0], r0);
+	simd::store(M.m[1], r1);
+	simd::store(M.m[2], r2);
+	simd::store(M.m[3], r3);
 	return M;
+#else
+	return vml::scalar::transposed(*this);
+#endif
 }
 
 Matrix4x4 Matrix4x4::rotatedX(float angle) const
@@ -235,8 +288,140 @@ void Matrix4x4::scale(vec3f s)
 	*this = *this * M;
 }
 
+#if VML_SIMD != VML_SIMD_NONE
+namespace simd
+{
+	//2x2 blocks stored row major in one register (x y / z w)
+	//A * B
+	inline float4 mat2Mul(float4 a, float4 b)
+	{
+		return add(mul(a, swizzle<0, 3, 0, 3>(b)),
+			mul(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
+	}
+	//adj(A) * B
+	inline float4 mat2AdjMul(float4 a, float4 b)
+	{
+		return sub(mul(swizzle<3, 3, 0, 0>(a), b),
+			mul(swizzle<1, 1, 2, 2>(a), swizzle<2, 3, 0, 1>(b)));
+	}
+	//A * adj(B)
+	inline float4 mat2MulAdj(float4 a, float4 b)
+	{
+		return sub(mul(a, swizzle<3, 0, 3, 0>(b)),
+			mul(swizzle<1, 0, 3, 2>(a), swizzle<2, 1, 2, 1>(b)));
+	}
+
+	inline float4 cross(float4 a, float4 b)
+	{
+		return sub(mul(swizzle<1, 2, 0, 3>(a), swizzle<2, 0, 1, 3>(b)),
+			mul(swizzle<2, 0, 1, 3>(a), swizzle<1, 2, 0, 3>(b)));
+	}
+}
+#endif
+
 Matrix4x4 Matrix4x4::inverted() const
 {
+#if VML_SIMD != VML_SIMD_NONE
+	using namespace simd;
+	//block inverse on the four 2x2 sub matrices
+	//| A B |      1    | X Y |
+	//| C D | -> ------ | Z W |
+	//            det M
+	float4 r0 = load(m[0]);
+	float4 r1 = load(m[1]);
+	float4 r2 = load(m[2]);
+	float4 r3 = load(m[3]);
+
+	float4 A = lowPairs(r0, r1);
+	float4 B = highPairs(r0, r1);
+	float4 C = lowPairs(r2, r3);
+	float4 D = highPairs(r2, r3);
+
+	//(det A, det B, det C, det D)
+	float4 detSub = sub(
+		mul(shuffle<0, 2, 0, 2>(r0, r2), shuffle<1, 3, 1, 3>(r1, r3)),
+		mul(shuffle<1, 3, 1, 3>(r0, r2), shuffle<0, 2, 0, 2>(r1, r3)));
+	float4 detA = splat<0>(detSub);
+	float4 detB = splat<1>(detSub);
+	float4 detC = splat<2>(detSub);
+	float4 detD = splat<3>(detSub);
+
+	float4 D_C = mat2AdjMul(D, C);
+	float4 A_B = mat2AdjMul(A, B);
+	float4 X_ = sub(mul(detD, A), mat2Mul(B, D_C));
+	float4 W_ = sub(mul(detA, D), mat2Mul(C, A_B));
+	float4 Y_ = sub(mul(detB, C), mat2MulAdj(D, A_B));
+	float4 Z_ = sub(mul(detC, B), mat2MulAdj(A, D_C));
+
+	//det M = det A * det D + det B * det C - tr(adj(A)B * adj(D)C)
+	float4 tr = mul(A_B, swizzle<0, 2, 1, 3>(D_C));
+	tr = add(tr, swizzle<2, 3, 0, 1>(tr));
+	tr = add(tr, swizzle<1, 0, 3, 2>(tr));
+	float4 detM = sub(add(mul(detA, detD), mul(detB, detC)), tr);
+	if (fabs(first(detM)) < MATRIX_EPSILON)
+		return zero;
+
+	float4 rDetM = div(set(1.f, -1.f, -1.f, 1.f), detM);
+	X_ = mul(X_, rDetM);
+	Y_ = mul(Y_, rDetM);
+	Z_ = mul(Z_, rDetM);
+	W_ = mul(W_, rDetM);
+
+	//adjugate swizzle and store in one shuffle
+	Matrix4x4 inv;
+	store(inv.m[0], shuffle<3, 1, 3, 1>(X_, Y_));
+	store(inv.m[1], shuffle<2, 0, 2, 0>(X_, Y_));
+	store(inv.m[2], shuffle<3, 1, 3, 1>(Z_, W_));
+	store(inv.m[3], shuffle<2, 0, 2, 0>(Z_, W_));
+	return inv;
+#else
+	return vml::scalar::inverted(*this);
+#endif
+}
+
+Matrix4x4 Matrix4x4::invertedAffine() const
+{
+#if VML_SIMD != VML_SIMD_NONE
+	using namespace simd;
+	//columns of the inverse 3x3 are the row cross products over det,
+	//the translation lanes cancel to zero in every cross product
+	float4 r0 = load(m[0]);
+	float4 r1 = load(m[1]);
+	float4 r2 = load(m[2]);
+
+	float4 c0 = cross(r1, r2);
+	float4 c1 = cross(r2, r0);
+	float4 c2 = cross(r0, r1);
+
+	float4 p = mul(r0, c0);
+	float4 det = add(add(splat<0>(p), splat<1>(p)), splat<2>(p));
+	if (fabs(first(det)) < MATRIX_EPSILON)
+		return zero;
+
+	float4 invDet = div(splat(1.0f), det);
+	c0 = mul(c0, invDet);
+	c1 = mul(c1, invDet);
+	c2 = mul(c2, invDet);
+
+	//t' = -inv(R) t, lane 3 becomes the 1 of the last row after transpose
+	float4 t = madd(c2, splat<3>(r2), madd(c1, splat<3>(r1), mul(c0, splat<3>(r0))));
+	float4 c3 = add(sub(simd::zero(), t), set(0.f, 0.f, 0.f, 1.f));
+
+	simd::transpose(c0, c1, c2, c3);
+	Matrix4x4 inv;
+	store(inv.m[0], c0);
+	store(inv.m[1], c1);
+	store(inv.m[2], c2);
+	store(inv.m[3], c3);
+	return inv;
+#else
+	return vml::scalar::invertedAffine(*this);
+#endif
+}
+
+Matrix4x4 vml::scalar::inverted(const Matrix4x4 &M)
+{
+	const float (&m)[4][4] = M.m;
 	Matrix4x4 inv;
 	float m00 = m[0][0];
 	float m01 = m[0][1];
@@ -270,7 +455,7 @@ Matrix4x4 Matrix4x4::inverted() const
 	float det = m00 * inv[0][0] + m01 * inv[1][0] +
 		m02 * inv[2][0] + m03 * inv[3][0];
 	if (fabs(det) < MATRIX_EPSILON)
-		return false;
+		return Matrix4x4::zero;
 	float invDet = 1.0f / det;
 
 	inv[0][1] = -(m01 * R23C23 - m02 * R23C13 + m03 * R23C12);
@@ -317,7 +502,66 @@ Matrix4x4 Matrix4x4::vulkandClip()
 	return clip;
 }
 
+Matrix4x4 vml::scalar::invertedAffine(const Matrix4x4 &M)
+{
+	const float (&m)[4][4] = M.m;
+	vec3f r0(m[0][0], m[0][1], m[0][2]);
+	vec3f r1(m[1][0], m[1][1], m[1][2]);
+	vec3f r2(m[2][0], m[2][1], m[2][2]);
+
+	vec3f c0 = vec3f::cross(r1, r2);
+	vec3f c1 = vec3f::cross(r2, r0);
+	vec3f c2 = vec3f::cross(r0, r1);
+
+	float det = vec3f::dot(r0, c0);
+	if (fabs(det) < MATRIX_EPSILON)
+		return Matrix4x4::zero;
+	float invDet = 1.0f / det;
+	c0 *= invDet;
+	c1 *= invDet;
+	c2 *= invDet;
+
+	vec3f t = -(c0 * m[0][3] + c1 * m[1][3] + c2 * m[2][3]);
+	return Matrix4x4(
+		c0.x, c1.x, c2.x, t.x,
+		c0.y, c1.y, c2.y, t.y,
+		c0.z, c1.z, c2.z, t.z,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Matrix4x4 vml::scalar::multiply(const Matrix4x4 &a, const Matrix4x4 &b)
+{
+	Matrix4x4 M;
+
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			M.m[i][j] =
+				a.m[i][0] * b.m[0][j] +
+				a.m[i][1] * b.m[1][j] +
+				a.m[i][2] * b.m[2][j] +
+				a.m[i][3] * b.m[3][j];
+		}
+	}
+	return M;
+}
+
+Matrix4x4 vml::scalar::transposed(const Matrix4x4 &m)
+{
+	Matrix4x4 M;
+	for (int row = 0; row < 4; ++row)
+		for (int col = 0; col < 4; ++col)
+			M.m[row][col] = m.m[col][row];
+	return M;
+}
+
 vec3f operator*(const Matrix4x4 &m, const vec3f &v)
+{
+	//one point does not fill the registers, the transpose costs more than it
+	//saves. many points go through vml::transformPoints
+	return vml::scalar::transform(m, v);
+}
+
+vec3f vml::scalar::transform(const Matrix4x4 &m, const vec3f &v)
 {
 	float x, y, z;
 	x = v.x * m.m[0][0] + v.y * m.m[0][1] + v.z * m.m[0][2] + m.m[0][3];
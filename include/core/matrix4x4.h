@@ -3,6 +3,7 @@
 #define MATRIX4X4_H
 
 #include <vml.h>
+#include <tmath.h>
 #include <assert.h>
 #include <vec3f.h>
 #include <iostream>
@@ -22,6 +23,9 @@ public:
 		float m10, float m11, float m12, float m13,
 		float m20, float m21, float m22, float m23,
 		float m30, float m31, float m32, float m33);
+	//from the constexpr type in tmath.h, element copies in math order
+	template<typename S>
+	Matrix4x4(const vml::tmat4<float, S> &M);
 	~Matrix4x4(){};
 
 	static const Matrix4x4 zero;
@@ -57,8 +61,14 @@ public:
 	Matrix4x4 rotatedZ(float angle) const;
 
 	Matrix4x4 inverted() const;
+	//rotation, scale, shear and translation only, the last row must be 0 0 0 1
+	Matrix4x4 invertedAffine() const;
 	static Matrix4x4 vulkandClip();
 
+	//the other way, as<vml::ColumnMajor>() is the glsl layout
+	template<typename S = vml::RowMajor>
+	vml::tmat4<float, S> as() const;
+
 	inline float* data() { return *m; }
 	inline const float* constData() const { return *m; }
 
@@ -67,6 +77,37 @@ public:
 
 vec3f operator*(const Matrix4x4 &m, const vec3f &v);
 
+/*SCALAR REFERENCE*/
+//the members pick SSE/AVX/NEON kernels at compile time (simd.h), these stay
+//plain C++ so the kernels can be checked and timed against them
+namespace vml
+{
+	namespace scalar
+	{
+		Matrix4x4 multiply(const Matrix4x4 &a, const Matrix4x4 &b);
+		Matrix4x4 transposed(const Matrix4x4 &m);
+		Matrix4x4 inverted(const Matrix4x4 &m);
+		Matrix4x4 invertedAffine(const Matrix4x4 &m);
+		vec3f transform(const Matrix4x4 &m, const vec3f &v);
+	}
+}
+
+template<typename S>
+inline Matrix4x4::Matrix4x4(const vml::tmat4<float, S> &M)
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			m[i][j] = M.at(i, j);
+}
+
+template<typename S>
+inline vml::tmat4<float, S> Matrix4x4::as() const
+{
+	return vml::tmat4<float, S>(
+		m[0][0], m[0][1], m[0][2], m[0][3], m[1][0], m[1][1], m[1][2], m[1][3],
+		m[2][0], m[2][1], m[2][2], m[2][3], m[3][0], m[3][1], m[3][2], m[3][3]);
+}
+
 inline const float* Matrix4x4::operator[](int i) const {
 	assert(i >= 0 && i < 4);
 	return m[i];
@@ -93,103 +134,26 @@ inline std::ostream& operator<<(std::ostream &o, const Matrix4x4 &mat)
 
 namespace vml
 {
+	//the convention is a template argument now (tmath.h), these keep the old
+	//names with the depth range the macros defaulted to
 	inline Matrix4x4 perspectiveRH(float fovY, float aspect, float znear, float zfar)
 	{
-		float const tanHalfFov = tan(RADIANS * fovY * 0.5f);
-
-		Matrix4x4 M;
-		M[0][0] = 1.f / (aspect* tanHalfFov);
-		M[1][1] = 1.f / tanHalfFov;
-		M[3][2] = -1.f;
-
-#if VML_DEPTH_CLIP_SPACE == VML_DEPTH_ZERO_TO_ONE
-
-		M[2][2] = zfar / (znear - zfar);
-		M[2][3] = -(zfar * znear) / (zfar - znear);
-#else
-		M[2][2] = -(zfar + znear) / (zfar - znear);
-		M[2][3] = -(2.f * zfar * znear) / (zfar - znear);
-#endif
-		return M;
+		return perspective<Convention<RightHanded, DepthNegativeOneToOne>>(fovY, aspect, znear, zfar);
 	}
 
 	inline Matrix4x4 perspectiveLH(float fovY, float aspect, float znear, float zfar)
 	{
-		float const tanHalfFov = tan(RADIANS * fovY * 0.5f);
-
-		Matrix4x4 M;
-		M[0][0] = 1.f / (aspect* tanHalfFov);
-		M[1][1] = 1.f / tanHalfFov;
-		M[3][2] = 1.f;
-
-#if VML_DEPTH_CLIP_SPACE == VML_DEPTH_ZERO_TO_ONE
-
-		M[2][2] = zfar / (znear - zfar);
-		M[2][3] = -(zfar * znear) / (zfar - znear);
-#else
-		M[2][2] = (zfar + znear) / (zfar - znear);
-		M[2][3] = -(2.f * zfar * znear) / (zfar - znear);
-#endif
-		return M;
-	}
-
-	inline Matrix4x4 perspective(float fovY, float aspect, float znear, float zfar)
-	{
-#	if VML_COORDINATE_SYSTEM == VML_LEFT_HAND
-		if(VML_VULKAN_CLIP)
-			return Matrix4x4::vulkandClip() * perspectiveLH(fovY, aspect, znear, zfar);
-		return perspectiveLH(fovY, aspect, znear, zfar);
-#	else
-		if (VML_VULKAN_CLIP)
-			return Matrix4x4::vulkandClip() * perspectiveRH(fovY, aspect, znear, zfar);
-		return perspectiveRH(fovY, aspect, znear, zfar);	//row for ray tracing(d12)
-#	endif 
-		
+		return perspective<Convention<LeftHanded, DepthNegativeOneToOne>>(fovY, aspect, znear, zfar);
 	}
 
 	inline Matrix4x4 lookAtRH(const vec3f &eye,const vec3f& center,const vec3f& upvector)
 	{
-		vec3f const forward = (center - eye).normalized();
-		vec3f const right	= vec3f::cross(forward, upvector).normalized();
-		vec3f const up		= vec3f::cross(right, forward);
-
-		float x = -vec3f::dot(  right, eye);
-		float y = -vec3f::dot(     up, eye);
-		float z =  vec3f::dot(forward, eye);
-
-		Matrix4x4 view = {
-		       right.x,     right.y,	 right.z,		x,
-			      up.x,        up.y,        up.z,		y,
-			-forward.x,  -forward.y,  -forward.z,		z,
-				 0.0f,      0.0f,       0.0f,    1.0f};
-		return view;
+		return lookAt<OpenGLConvention>(eye, center, upvector);
 	}
 
 	inline Matrix4x4 lookAtLH(const vec3f &eye, const vec3f& center, const vec3f& upvector)
 	{
-		vec3f const forward = (center - eye).normalized();
-		vec3f const right	= vec3f::cross(upvector, forward).normalized();
-		vec3f const up		= vec3f::cross(forward, right);
-
-		float x = -vec3f::dot(	 right, eye);
-		float y = -vec3f::dot(	    up, eye);
-		float z = -vec3f::dot( forward, eye);
-
-		Matrix4x4 view = {
-			   right.x,     right.y,	 right.z,		x,
-			      up.x,        up.y,        up.z,		y,
-			-forward.x,  -forward.y,  -forward.z,		z,
-			      0.0f,        0.0f,        0.0f,     1.0f };
-		return view;
-	}
-
-	inline Matrix4x4 lookAt(const vec3f &eye, const vec3f &center, const vec3f &up)
-	{
-#		if VML_COORDINATE_SYSTEM == VML_LEFT_HAND
-		return lookAtLH(eye, center, up);
-#else
-		return lookAtRH(eye, center, up);
-#endif
+		return lookAt<Convention<LeftHanded, DepthNegativeOneToOne>>(eye, center, upvector);
 	}
 
 	//for vulkan
@@ -214,17 +178,9 @@ namespace vml
 
 	inline Matrix4x4 perspectiveVK(float fovy, float aspect, float znear, float zfar)
 	{
-		Matrix4x4 proj = perspective(fovy, aspect, znear, zfar);
-		Matrix4x4 clip = {
-			1.0f,	0.0f,	0.0f,	0.0f,
-			0.0f,  -1.0f,	0.0f,	0.0f,
-			0.0f,	0.0f,	0.5f,	0.5f,
-			0.0f,	0.0f,	0.0f,	1.0f
-		};
-		return clip * proj;
+		return perspective<VulkanConvention>(fovy, aspect, znear, zfar);
 	}
 
-
 }
 
 #endif // MATRIX4X4_H
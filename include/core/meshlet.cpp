@@ -0,0 +1,155 @@
+#include "meshlet.h"
+#include <frustum.h>
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	inline float dot3(const vec3f &a, const vec3f &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline vec3f cross3(const vec3f &a, const vec3f &b)
+	{
+		return vec3f(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	//sphere and normal cone of the triangles in indices [first, first + count)
+	void finish(Meshlet &meshlet, const uint32_t* indices, const std::vector<uint32_t> &vertices,
+		const char* base, size_t stride)
+	{
+		auto position = [&](uint32_t v) -> const vec3f& { return *(const vec3f*)(base + v * stride); };
+		std::vector<vec3f> points(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+			points[i] = position(vertices[i]);
+		Bounds bounds = Bounds::fromPoints(points.data(), points.size());
+		meshlet.center = bounds.center;
+		meshlet.radius = bounds.radius;
+
+		std::vector<vec3f> normals;
+		vec3f axis;
+		for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+		{
+			const uint32_t* t = indices + meshlet.firstIndex + i;
+			vec3f n = cross3(position(t[1]) - position(t[0]), position(t[2]) - position(t[0]));
+			float length = sqrtf(dot3(n, n));
+			//no normal, it can not face either way
+			if (length <= 0.0f)
+				continue;
+			normals.push_back(n / length);
+			axis += normals.back();
+		}
+		float length = sqrtf(dot3(axis, axis));
+		meshlet.coneAxis = length > 0.0f ? axis / length : vec3f(0.0f, 0.0f, 1.0f);
+		meshlet.coneCos = length > 0.0f ? 1.0f : -1.0f;
+		for (const vec3f &n : normals)
+			meshlet.coneCos = std::min(meshlet.coneCos, dot3(n, meshlet.coneAxis));
+		meshlet.coneSin = sqrtf(std::max(0.0f, 1.0f - meshlet.coneCos * meshlet.coneCos));
+	}
+}
+
+std::vector<Meshlet> vml::buildMeshlets(uint32_t* indices, size_t indexCount,
+	const vec3f* positions, size_t vertexCount, size_t stride,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	const uint32_t NONE = UINT32_MAX;
+	uint32_t triangleCount = uint32_t(indexCount / 3);
+	std::vector<uint32_t> source(indices, indices + triangleCount * 3);
+
+	//triangles around every vertex
+	std::vector<uint32_t> offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+	for (uint32_t v : source)
+		offsets[v + 1]++;
+	for (size_t v = 1; v <= vertexCount; ++v)
+		offsets[v] += offsets[v - 1];
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (uint32_t i = 0; i < source.size(); ++i)
+			adjacency[fill[source[i]]++] = i / 3;
+	}
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	//meshlet a vertex was last added to
+	std::vector<uint32_t> owner(vertexCount, NONE);
+	std::vector<uint32_t> vertices;
+	uint32_t written = 0, seed = 0;
+
+	Meshlet current = {};
+	auto close = [&]() {
+		if (!current.indexCount) return;
+		finish(current, indices, vertices, (const char*)positions, stride);
+		meshlets.push_back(current);
+		current = Meshlet();
+		current.firstIndex = written;
+		vertices.clear();
+	};
+	auto missing = [&](uint32_t t) {
+		uint32_t id = (uint32_t)meshlets.size();
+		return uint32_t(owner[source[t * 3]] != id) + uint32_t(owner[source[t * 3 + 1]] != id) +
+			uint32_t(owner[source[t * 3 + 2]] != id);
+	};
+
+	for (uint32_t placed = 0; placed < triangleCount; ++placed)
+	{
+		//the neighbour that brings the fewest new vertices
+		uint32_t best = NONE, bestMissing = 4;
+		for (size_t i = 0; i < vertices.size() && bestMissing > 0; ++i)
+		{
+			uint32_t v = vertices[i];
+			for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a)
+			{
+				uint32_t t = adjacency[a];
+				if (emitted[t]) continue;
+				uint32_t m = missing(t);
+				if (m < bestMissing)
+				{
+					best = t;
+					bestMissing = m;
+					if (!m) break;
+				}
+			}
+		}
+		//nothing left around the meshlet, continue in index order
+		if (best == NONE)
+		{
+			while (emitted[seed]) ++seed;
+			best = seed;
+			bestMissing = missing(best);
+		}
+		if (vertices.size() + bestMissing > maxVertices || current.indexCount / 3 >= maxTriangles)
+		{
+			close();
+			bestMissing = 3;
+		}
+
+		uint32_t id = (uint32_t)meshlets.size();
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = source[best * 3 + k];
+			if (owner[v] != id)
+			{
+				owner[v] = id;
+				vertices.push_back(v);
+			}
+			indices[written++] = v;
+		}
+		emitted[best] = 1;
+		current.indexCount += 3;
+		current.vertexCount = (uint32_t)vertices.size();
+	}
+	close();
+	return meshlets;
+}
+
+bool vml::backFacing(const Meshlet &meshlet, const vec3f &eye)
+{
+	if (meshlet.coneCos <= 0.0f)
+		return false;
+	//every point p of the sphere and every normal n of the cone give
+	//dot(p - eye, n) >= distance * cos(angle to axis + cone angle) - radius
+	vec3f view = meshlet.center - eye;
+	float distance = sqrtf(dot3(view, view));
+	if (distance <= meshlet.radius)
+		return false;
+	float cosView = dot3(view, meshlet.coneAxis) / distance;
+	float sinView = sqrtf(std::max(0.0f, 1.0f - cosView * cosView));
+	return distance * (cosView * meshlet.coneCos - sinView * meshlet.coneSin) >= meshlet.radius;
+}
@@ -0,0 +1,40 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <vector>
+#include <stdint.h>
+#include <vec3f.h>
+
+//a cluster of neighbouring triangles, one contiguous range of the index
+//buffer so a plain vkCmdDrawIndexed draws it. object space
+struct Meshlet
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexCount;
+
+	vec3f center;
+	float radius;
+	//every triangle normal lies within acos(coneCos) of axis. a cone wider
+	//than a half space has coneCos <= 0 and never faces away as a whole
+	vec3f coneAxis;
+	float coneCos;
+	float coneSin;
+};
+
+namespace vml
+{
+	//reorders the triangles of indices so every meshlet is a range of it. a
+	//meshlet grows over the triangles that share its vertices until it holds
+	//maxVertices distinct vertices or maxTriangles triangles. stride in bytes
+	//so interleaved vertices work, winding is kept
+	std::vector<Meshlet> buildMeshlets(uint32_t* indices, size_t indexCount,
+		const vec3f* positions, size_t vertexCount, size_t stride,
+		uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+
+	//true if every counter clockwise triangle of the meshlet faces away from
+	//eye, both in the meshlet's space. conservative over the bounding sphere
+	bool backFacing(const Meshlet &meshlet, const vec3f &eye);
+}
+
+#endif // MESHLET_H
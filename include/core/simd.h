@@ -0,0 +1,204 @@
+#ifndef VML_SIMD_H
+#define VML_SIMD_H
+
+//compile time instruction set selection for the math kernels.
+//AVX builds (/arch:AVX) also use the SSE paths, define VML_NO_SIMD to force
+//the scalar reference code
+
+#define VML_SIMD_NONE					0
+#define VML_SIMD_SSE					1
+#define VML_SIMD_AVX					2
+#define VML_SIMD_NEON					3
+
+#if defined(VML_NO_SIMD)
+#define VML_SIMD						VML_SIMD_NONE
+#elif defined(__AVX__)
+#define VML_SIMD						VML_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VML_SIMD						VML_SIMD_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM) || defined(_M_ARM64)
+#define VML_SIMD						VML_SIMD_NEON
+#else
+#define VML_SIMD						VML_SIMD_NONE
+#endif
+
+#if VML_SIMD == VML_SIMD_AVX
+#include <immintrin.h>
+#elif VML_SIMD == VML_SIMD_SSE
+#include <emmintrin.h>
+#elif VML_SIMD == VML_SIMD_NEON
+#include <arm_neon.h>
+#include <cmath>
+#endif
+
+#if VML_SIMD == VML_SIMD_SSE || VML_SIMD == VML_SIMD_AVX
+#define VML_SIMD_X86
+#endif
+
+#if VML_SIMD != VML_SIMD_NONE
+
+//4 wide float register, every load and store is unaligned since
+//Matrix4x4 and vec3f arrays only guarantee 4 byte alignment on win32
+namespace simd
+{
+#ifdef VML_SIMD_X86
+	typedef __m128 float4;
+
+	inline float4 load(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p, float4 v) { _mm_storeu_ps(p, v); }
+	inline float4 set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+	inline float4 splat(float f) { return _mm_set1_ps(f); }
+	inline float4 zero() { return _mm_setzero_ps(); }
+	inline float first(float4 v) { return _mm_cvtss_f32(v); }
+
+	inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+	inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+	inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+	inline float4 div(float4 a, float4 b) { return _mm_div_ps(a, b); }
+	inline float4 min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+	inline float4 max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+	inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a); }
+
+	//(a[x], a[y], b[z], b[w])
+	template<int x, int y, int z, int w>
+	inline float4 shuffle(float4 a, float4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x)); }
+	template<int x, int y, int z, int w>
+	inline float4 swizzle(float4 a) { return shuffle<x, y, z, w>(a, a); }
+	template<int i>
+	inline float4 splat(float4 a) { return swizzle<i, i, i, i>(a); }
+
+	//(a0, a1, b0, b1) and (a2, a3, b2, b3)
+	inline float4 lowPairs(float4 a, float4 b) { return _mm_movelh_ps(a, b); }
+	inline float4 highPairs(float4 a, float4 b) { return _mm_movehl_ps(b, a); }
+
+	inline void transpose(float4 &r0, float4 &r1, float4 &r2, float4 &r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+
+	//all bits set in lanes where a < b, mask() packs the sign bits, lane 0 in bit 0
+	inline float4 less(float4 a, float4 b) { return _mm_cmplt_ps(a, b); }
+	inline int mask(float4 v) { return _mm_movemask_ps(v); }
+	//b in lanes where m is set, a elsewhere
+	inline float4 select(float4 m, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, a)); }
+#else
+	typedef float32x4_t float4;
+
+	inline float4 load(const float* p) { return vld1q_f32(p); }
+	inline void store(float* p, float4 v) { vst1q_f32(p, v); }
+	inline float4 set(float x, float y, float z, float w) { float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+	inline float4 splat(float f) { return vdupq_n_f32(f); }
+	inline float4 zero() { return vdupq_n_f32(0.0f); }
+	inline float first(float4 v) { return vgetq_lane_f32(v, 0); }
+
+	inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+	inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+	inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+	inline float4 div(float4 a, float4 b)
+	{
+#if defined(__aarch64__) || defined(_M_ARM64)
+		return vdivq_f32(a, b);
+#else
+		//armv7 has no divide, two newton steps on the reciprocal estimate
+		float4 r = vrecpeq_f32(b);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		return vmulq_f32(a, r);
+#endif
+	}
+	inline float4 min(float4 a, float4 b) { return vminq_f32(a, b); }
+	inline float4 max(float4 a, float4 b) { return vmaxq_f32(a, b); }
+	inline float4 sqrt(float4 a)
+	{
+#if defined(__aarch64__) || defined(_M_ARM64)
+		return vsqrtq_f32(a);
+#else
+		float v[4];
+		vst1q_f32(v, a);
+		for (int i = 0; i < 4; ++i) v[i] = std::sqrt(v[i]);
+		return vld1q_f32(v);
+#endif
+	}
+
+	//lane moves, the compiler folds constant lanes into ext/zip/dup
+	template<int x, int y, int z, int w>
+	inline float4 shuffle(float4 a, float4 b)
+	{
+		float4 r = vdupq_n_f32(vgetq_lane_f32(a, x));
+		r = vsetq_lane_f32(vgetq_lane_f32(a, y), r, 1);
+		r = vsetq_lane_f32(vgetq_lane_f32(b, z), r, 2);
+		return vsetq_lane_f32(vgetq_lane_f32(b, w), r, 3);
+	}
+	template<int x, int y, int z, int w>
+	inline float4 swizzle(float4 a) { return shuffle<x, y, z, w>(a, a); }
+	template<int i>
+	inline float4 splat(float4 a) { return vdupq_n_f32(vgetq_lane_f32(a, i)); }
+
+	inline float4 lowPairs(float4 a, float4 b) { return vcombine_f32(vget_low_f32(a), vget_low_f32(b)); }
+	inline float4 highPairs(float4 a, float4 b) { return vcombine_f32(vget_high_f32(a), vget_high_f32(b)); }
+
+	inline void transpose(float4 &r0, float4 &r1, float4 &r2, float4 &r3)
+	{
+		float32x4x2_t t01 = vtrnq_f32(r0, r1);
+		float32x4x2_t t23 = vtrnq_f32(r2, r3);
+		r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+		r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+		r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+		r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+	}
+
+	inline float4 less(float4 a, float4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+	inline int mask(float4 v)
+	{
+		uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(v), 31);
+		return int(vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) |
+			(vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3));
+	}
+	inline float4 select(float4 m, float4 a, float4 b) { return vbslq_f32(vreinterpretq_u32_f32(m), b, a); }
+#endif
+
+	//a * b + c, kept as two ops so results match the scalar code bit for bit
+	inline float4 madd(float4 a, float4 b, float4 c) { return add(mul(a, b), c); }
+
+#if VML_SIMD == VML_SIMD_AVX
+	//8 wide register for the batch kernels
+	typedef __m256 float8;
+
+	inline void store(float* p, float8 v) { _mm256_storeu_ps(p, v); }
+	inline float8 add(float8 a, float8 b) { return _mm256_add_ps(a, b); }
+	inline float8 sub(float8 a, float8 b) { return _mm256_sub_ps(a, b); }
+	inline float8 mul(float8 a, float8 b) { return _mm256_mul_ps(a, b); }
+	inline float8 div(float8 a, float8 b) { return _mm256_div_ps(a, b); }
+	inline float8 min(float8 a, float8 b) { return _mm256_min_ps(a, b); }
+	inline float8 max(float8 a, float8 b) { return _mm256_max_ps(a, b); }
+	inline float8 sqrt(float8 a) { return _mm256_sqrt_ps(a); }
+	inline float8 madd(float8 a, float8 b, float8 c) { return add(mul(a, b), c); }
+	inline float8 less(float8 a, float8 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline int mask(float8 v) { return _mm256_movemask_ps(v); }
+	inline float8 select(float8 m, float8 a, float8 b) { return _mm256_blendv_ps(a, b, m); }
+#endif
+
+	//width dependent loads so a kernel can be written once for 4 and 8 lanes
+	template<typename V> struct lanes;
+
+	template<> struct lanes<float4>
+	{
+		enum { width = 4 };
+		static float4 load(const float* p) { return simd::load(p); }
+		static float4 splat(float f) { return simd::splat(f); }
+	};
+
+#if VML_SIMD == VML_SIMD_AVX
+	template<> struct lanes<float8>
+	{
+		enum { width = 8 };
+		static float8 load(const float* p) { return _mm256_loadu_ps(p); }
+		static float8 splat(float f) { return _mm256_set1_ps(f); }
+	};
+
+	typedef float8 floatN;
+#else
+	typedef float4 floatN;
+#endif
+}
+
+#endif //VML_SIMD != VML_SIMD_NONE
+
+#endif //VML_SIMD_H
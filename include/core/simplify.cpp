@@ -0,0 +1,333 @@
+#include "simplify.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace
+{
+	inline float dot3(const vec3f &a, const vec3f &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline vec3f cross3(const vec3f &a, const vec3f &b)
+	{
+		return vec3f(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	//sum of squared distances to the planes of the triangles around a
+	//vertex, weighted by their area. the upper half of the 4x4 matrix
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0, c = 0;
+		double weight = 0;
+
+		void addPlane(const vec3f &n, float d, double w)
+		{
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+			b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+			c += w * d * d;
+			weight += w;
+		}
+		Quadric& operator+=(const Quadric &q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+			weight += q.weight;
+			return *this;
+		}
+		//mean squared distance of p to the planes
+		double error(const vec3f &p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double r = a00 * x * x + a11 * y * y + a22 * z * z
+				+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return r > 0.0 && weight > 0.0 ? r / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from, to;
+		double cost;
+		double geometric;
+
+		bool operator<(const Collapse &other) const { return cost < other.cost; }
+	};
+
+	inline uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+}
+
+size_t vml::simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+	const vec3f* positions, size_t vertexCount, size_t stride,
+	size_t targetIndexCount, const SimplifyAttributes* attributes, float* error)
+{
+	const char* base = (const char*)positions;
+	auto position = [&](uint32_t v) -> const vec3f& { return *(const vec3f*)(base + v * stride); };
+
+	/*WELD*/
+	//vertices split by normals or texture coordinates share a position, the
+	//topology is built over the first vertex of every position
+	std::vector<uint32_t> order(vertexCount), canonical(vertexCount), wedges(vertexCount, 0);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		order[v] = v;
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		const vec3f &pa = position(a), &pb = position(b);
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	});
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		uint32_t v = order[i];
+		canonical[v] = (i > 0 && position(order[i - 1]) == position(v)) ? canonical[order[i - 1]] : v;
+		wedges[canonical[v]]++;
+	}
+
+	//positions in the unit box so the error limits do not depend on the model size
+	vec3f low(FLT_MAX), high(-FLT_MAX);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const vec3f &p = position(indices[i]);
+		low = vec3f(std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z));
+		high = vec3f(std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z));
+	}
+	float extent = std::max(std::max(high.x - low.x, high.y - low.y), high.z - low.z);
+	float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+	std::vector<vec3f> unit(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		unit[v] = (position(v) - low) * scale;
+
+	/*LOCKED*/
+	//an edge with one triangle is on the border, more than two is not a
+	//manifold. seams stay where they are so attributes never bleed across
+	std::vector<uint8_t> locked(vertexCount, 0);
+	std::vector<uint64_t> borders;
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(indexCount);
+		for (size_t t = 0; t + 2 < indexCount; t += 3)
+			for (int k = 0; k < 3; ++k)
+				edges.push_back(edgeKey(canonical[indices[t + k]], canonical[indices[t + (k + 1) % 3]]));
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i]) ++j;
+			if (j - i == 1)
+				borders.push_back(edges[i]);
+			if (j - i != 2)
+			{
+				locked[uint32_t(edges[i] >> 32)] = 1;
+				locked[uint32_t(edges[i] & 0xffffffff)] = 1;
+			}
+			i = j;
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			locked[v] = locked[canonical[v]] || wedges[canonical[v]] > 1;
+	}
+
+	/*QUADRICS*/
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t + 2 < indexCount; t += 3)
+	{
+		const vec3f &p0 = unit[indices[t]], &p1 = unit[indices[t + 1]], &p2 = unit[indices[t + 2]];
+		vec3f n = cross3(p1 - p0, p2 - p0);
+		float length = sqrtf(dot3(n, n));
+		if (length <= 0.0f)
+			continue;
+		n = n / length;
+		float d = -dot3(n, p0);
+		for (int k = 0; k < 3; ++k)
+			quadrics[canonical[indices[t + k]]].addPlane(n, d, length * 0.5);
+	}
+
+	auto attributeError = [&](uint32_t a, uint32_t b) {
+		if (!attributes || !attributes->data)
+			return 0.0;
+		const float* fa = (const float*)((const char*)attributes->data + a * attributes->stride);
+		const float* fb = (const float*)((const char*)attributes->data + b * attributes->stride);
+		double sum = 0.0;
+		for (uint32_t k = 0; k < attributes->count; ++k)
+		{
+			double diff = fa[k] - fb[k];
+			sum += (attributes->weights ? attributes->weights[k] : 1.0) * diff * diff;
+		}
+		return sum;
+	};
+
+	//a from -> to collapse: the planes of both ends at the position of to, plus
+	//the attribute change over the length of the edge
+	auto evaluate = [&](uint32_t from, uint32_t to, Collapse &collapse) {
+		Quadric q = quadrics[canonical[from]];
+		q += quadrics[canonical[to]];
+		vec3f edge = unit[to] - unit[from];
+		collapse.from = from;
+		collapse.to = to;
+		collapse.geometric = q.error(unit[to]);
+		collapse.cost = collapse.geometric + attributeError(from, to) * dot3(edge, edge);
+	};
+
+	/*COLLAPSE*/
+	std::vector<uint32_t> result(indices, indices + indexCount);
+	std::vector<uint32_t> remap(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		remap[v] = v;
+	auto chase = [&](uint32_t v) {
+		while (remap[v] != v) v = remap[v];
+		return v;
+	};
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1), adjacency;
+	std::vector<uint64_t> edges;
+	std::vector<Collapse> collapses;
+	std::vector<uint8_t> touched(vertexCount);
+	double maxGeometric = 0.0;
+
+	auto border = [&](uint32_t a, uint32_t b) {
+		return std::binary_search(borders.begin(), borders.end(), edgeKey(canonical[a], canonical[b]));
+	};
+	//any triangle around from that turns over, or close to it. a triangle the
+	//collapse removes must not take a border edge with it
+	auto flips = [&](uint32_t from, uint32_t to) {
+		for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+		{
+			uint32_t t = adjacency[i];
+			uint32_t v[3] = { chase(result[t * 3]), chase(result[t * 3 + 1]), chase(result[t * 3 + 2]) };
+			if (v[0] == to || v[1] == to || v[2] == to)
+			{
+				for (int k = 0; k < 3; ++k)
+					if (v[k] != from && v[k] != to && border(to, v[k]))
+						return true;
+				continue;
+			}
+			vec3f before = cross3(unit[v[1]] - unit[v[0]], unit[v[2]] - unit[v[0]]);
+			for (int k = 0; k < 3; ++k)
+				if (v[k] == from) v[k] = to;
+			vec3f after = cross3(unit[v[1]] - unit[v[0]], unit[v[2]] - unit[v[0]]);
+			if (dot3(before, after) < 0.1f * sqrtf(dot3(before, before) * dot3(after, after)))
+				return true;
+		}
+		return false;
+	};
+
+	for (int pass = 0; pass < 100 && result.size() > targetIndexCount; ++pass)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		//triangles around every vertex
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t v : result)
+			adjacencyOffsets[v + 1]++;
+		for (size_t v = 1; v <= vertexCount; ++v)
+			adjacencyOffsets[v] += adjacencyOffsets[v - 1];
+		adjacency.resize(result.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i)
+				adjacency[fill[result[i]]++] = uint32_t(i / 3);
+		}
+
+		//cheaper direction of every edge with a free end
+		edges.clear();
+		for (size_t t = 0; t < triangleCount; ++t)
+			for (int k = 0; k < 3; ++k)
+				edges.push_back(edgeKey(result[t * 3 + k], result[t * 3 + (k + 1) % 3]));
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+		collapses.clear();
+		for (uint64_t key : edges)
+		{
+			uint32_t a = uint32_t(key >> 32), b = uint32_t(key & 0xffffffff);
+			Collapse ab, ba;
+			ab.cost = ba.cost = DBL_MAX;
+			if (!locked[a]) evaluate(a, b, ab);
+			if (!locked[b]) evaluate(b, a, ba);
+			if (ab.cost == DBL_MAX && ba.cost == DBL_MAX)
+				continue;
+			collapses.push_back(ab.cost <= ba.cost ? ab : ba);
+		}
+		if (collapses.empty())
+			break;
+		std::sort(collapses.begin(), collapses.end());
+
+		//one collapse per vertex and pass keeps the triangles around it valid.
+		//a collapse removes about two triangles
+		size_t goal = (result.size() - targetIndexCount) / 3;
+		size_t removed = 0, applied = 0;
+		std::fill(touched.begin(), touched.end(), 0);
+		for (const Collapse &collapse : collapses)
+		{
+			if (removed >= goal)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+			if (flips(collapse.from, collapse.to))
+				continue;
+			for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; ++i)
+			{
+				uint32_t t = adjacency[i];
+				removed += chase(result[t * 3]) == collapse.to || chase(result[t * 3 + 1]) == collapse.to ||
+					chase(result[t * 3 + 2]) == collapse.to;
+			}
+			remap[collapse.from] = collapse.to;
+			touched[collapse.from] = touched[collapse.to] = 1;
+			//every wedge of a position shares its quadric
+			quadrics[canonical[collapse.to]] += quadrics[canonical[collapse.from]];
+			maxGeometric = std::max(maxGeometric, collapse.geometric);
+			++applied;
+		}
+		if (!applied)
+			break;
+
+		size_t kept = 0;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			uint32_t v0 = chase(result[t * 3]), v1 = chase(result[t * 3 + 1]), v2 = chase(result[t * 3 + 2]);
+			if (v0 == v1 || v1 == v2 || v0 == v2)
+				continue;
+			result[kept++] = v0;
+			result[kept++] = v1;
+			result[kept++] = v2;
+		}
+		result.resize(kept);
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+	if (error)
+		*error = float(sqrt(maxGeometric)) / scale;
+	return result.size();
+}
+
+std::vector<MeshLod> vml::buildLods(const uint32_t* indices, size_t indexCount,
+	const vec3f* positions, size_t vertexCount, size_t stride,
+	const SimplifyAttributes* attributes, uint32_t maxLevels, std::vector<uint32_t> &lodIndices)
+{
+	std::vector<MeshLod> lods;
+	lodIndices.clear();
+	MeshLod full = { 0, (uint32_t)indexCount, 0.0f };
+	lods.push_back(full);
+
+	//levels below this many triangles save less than the draw costs
+	const size_t minIndexCount = 64 * 3;
+	std::vector<uint32_t> previous(indices, indices + indexCount), level(indexCount);
+	float error = 0.0f;
+	while (lods.size() < maxLevels && previous.size() > minIndexCount)
+	{
+		size_t target = previous.size() / 6 * 3;
+		float levelError = 0.0f;
+		size_t count = simplify(level.data(), previous.data(), previous.size(), positions, vertexCount, stride,
+			target, attributes, &levelError);
+		if (count == 0 || count * 4 > previous.size() * 3)
+			break;
+		//simplified from the last level, its error adds up
+		error += levelError;
+		MeshLod lod = { (uint32_t)(indexCount + lodIndices.size()), (uint32_t)count, error };
+		lods.push_back(lod);
+		lodIndices.insert(lodIndices.end(), level.begin(), level.begin() + count);
+		previous.assign(level.begin(), level.begin() + count);
+	}
+	return lods;
+}
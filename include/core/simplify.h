@@ -0,0 +1,49 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <vector>
+#include <stdint.h>
+#include <vec3f.h>
+
+//vertex attributes a collapse should keep, count floats starting at data
+//in every vertex, stride in bytes. weights per float, zero ignores it
+struct SimplifyAttributes
+{
+	const float* data = nullptr;
+	size_t stride = 0;
+	uint32_t count = 0;
+	const float* weights = nullptr;
+};
+
+//one level of detail, a range of the mesh's index buffer
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;			//object units, 0 for the full mesh
+};
+
+namespace vml
+{
+	//quadric error metric with half edge collapses. every collapse moves a
+	//vertex onto a neighbour, so the result only references the input
+	//vertices and any number of levels share one vertex buffer.
+	//vertices on an open border and on attribute seams (the same position
+	//in several vertices) are locked, a vertex is never collapsed if any of
+	//its triangles would flip. returns the index count written to
+	//destination, which needs room for indexCount. error is the largest
+	//distance of a removed vertex to the surface, object units
+	size_t simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+		const vec3f* positions, size_t vertexCount, size_t stride,
+		size_t targetIndexCount, const SimplifyAttributes* attributes = nullptr, float* error = nullptr);
+
+	//level 0 is indices itself. every further level is simplified from the one
+	//before to half its triangles and appended to lodIndices, with firstIndex
+	//counting on after indexCount so both go into one index buffer. stops at
+	//maxLevels, or when a level cannot get below three quarters of the last
+	std::vector<MeshLod> buildLods(const uint32_t* indices, size_t indexCount,
+		const vec3f* positions, size_t vertexCount, size_t stride,
+		const SimplifyAttributes* attributes, uint32_t maxLevels, std::vector<uint32_t> &lodIndices);
+}
+
+#endif // SIMPLIFY_H
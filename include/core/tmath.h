@@ -0,0 +1,318 @@
+#ifndef TMATH_H
+#define TMATH_H
+
+#include <vml.h>
+#include <vec2f.h>
+#include <vec3f.h>
+#include <math.h>
+
+/*COMPILE TIME MATH*/
+//literal vector / matrix types whose functions are all constexpr (C++11 rules,
+//single return, so v140 folds them too). handedness, depth range, clip space
+//fixup and storage order are template policies instead of VML_* macros, so the
+//result never depends on what was defined before matrix4x4.h got included.
+//vec3f / vec2 convert both ways with plain element copies, Matrix4x4 takes a
+//tmat4 in its constructor and hands one out with as<Storage>() (matrix4x4.h)
+
+namespace vml
+{
+	/*POLICIES*/
+	//camera looks down -z
+	struct RightHanded
+	{
+		static constexpr float forward() { return -1.0f; }
+	};
+	//camera looks down +z
+	struct LeftHanded
+	{
+		static constexpr float forward() { return 1.0f; }
+	};
+
+	//z_ndc = (scale * z + offset) / w, with w = forward * z.
+	//the near clip plane is row 2 + nearW * row 3 of the projection
+	struct DepthZeroToOne
+	{
+		static constexpr float nearW() { return 0.0f; }
+		template<typename T>
+		static constexpr T scale(T znear, T zfar) { return zfar / (zfar - znear); }
+		template<typename T>
+		static constexpr T offset(T znear, T zfar) { return -(zfar * znear) / (zfar - znear); }
+	};
+	struct DepthNegativeOneToOne
+	{
+		static constexpr float nearW() { return 1.0f; }
+		template<typename T>
+		static constexpr T scale(T znear, T zfar) { return (zfar + znear) / (zfar - znear); }
+		template<typename T>
+		static constexpr T offset(T znear, T zfar) { return -(T(2) * zfar * znear) / (zfar - znear); }
+	};
+
+	//vulkan framebuffer y points down
+	struct ClipFlipY
+	{
+		template<typename T>
+		static constexpr T y() { return T(-1); }
+	};
+	struct ClipIdentity
+	{
+		template<typename T>
+		static constexpr T y() { return T(1); }
+	};
+
+	//element (row, col) lives at e[index(row, col)]
+	struct RowMajor
+	{
+		static constexpr int index(int row, int col) { return row * 4 + col; }
+	};
+	//glsl layout, uploads without a transpose
+	struct ColumnMajor
+	{
+		static constexpr int index(int row, int col) { return col * 4 + row; }
+	};
+
+	template<typename Handedness, typename Depth, typename Clip = ClipIdentity>
+	struct Convention
+	{
+		typedef Handedness handedness;
+		typedef Depth depth;
+		typedef Clip clip;
+	};
+
+	typedef Convention<RightHanded, DepthZeroToOne, ClipFlipY>			VulkanConvention;
+	typedef Convention<RightHanded, DepthNegativeOneToOne, ClipIdentity>	OpenGLConvention;
+
+	/*CONSTEXPR SCALAR HELPERS*/
+	namespace detail
+	{
+		//keeps an argument out of template deduction so vec3f / int arguments convert
+		template<typename T> struct identity { typedef T type; };
+
+		//capped, newton can end up flipping between two neighbouring doubles
+		constexpr double sqrtNewton(double x, double cur, double prev, int n)
+		{
+			return (cur == prev || n == 0) ? cur : sqrtNewton(x, 0.5 * (cur + x / cur), cur, n - 1);
+		}
+		constexpr double sinSeries(double x2, double term, double sum, int n)
+		{
+			return n > 24 ? sum : sinSeries(x2, -term * x2 / ((2 * n) * (2 * n + 1)), sum + term, n + 1);
+		}
+		constexpr double cosSeries(double x2, double term, double sum, int n)
+		{
+			return n > 24 ? sum : cosSeries(x2, -term * x2 / ((2 * n - 1) * (2 * n)), sum + term, n + 1);
+		}
+	}
+
+	//exact enough for projection setup, not meant for per frame use
+	constexpr double csqrt(double x) { return x <= 0.0 ? 0.0 : detail::sqrtNewton(x, x > 1.0 ? x : 1.0, 0.0, 128); }
+	constexpr double csin(double x) { return detail::sinSeries(x * x, x, 0.0, 1); }
+	constexpr double ccos(double x) { return detail::cosSeries(x * x, 1.0, 0.0, 1); }
+	//valid on (-pi/2, pi/2), half the field of view always is
+	constexpr double ctan(double x) { return csin(x) / ccos(x); }
+	constexpr float cradians(float deg) { return VML_PI / 180.f * deg; }
+
+	/*VECTORS*/
+	template<typename T>
+	struct tvec2
+	{
+		T x, y;
+
+		constexpr tvec2() : x(0), y(0) {}
+		constexpr tvec2(T x, T y) : x(x), y(y) {}
+		tvec2(const vec2<T> &v) : x(v.x), y(v.y) {}
+		operator vec2<T>() const { return vec2<T>(x, y); }
+
+		constexpr tvec2 operator+(const tvec2 &v) const { return tvec2(x + v.x, y + v.y); }
+		constexpr tvec2 operator-(const tvec2 &v) const { return tvec2(x - v.x, y - v.y); }
+		constexpr tvec2 operator*(T f) const { return tvec2(x * f, y * f); }
+		constexpr T dot(const tvec2 &v) const { return x * v.x + y * v.y; }
+	};
+
+	template<typename T>
+	struct tvec3
+	{
+		T x, y, z;
+
+		constexpr tvec3() : x(0), y(0), z(0) {}
+		constexpr tvec3(T x, T y, T z) : x(x), y(y), z(z) {}
+		tvec3(const vec3f &v) : x(v.x), y(v.y), z(v.z) {}
+		operator vec3f() const { return vec3f(float(x), float(y), float(z)); }
+
+		constexpr tvec3 operator+(const tvec3 &v) const { return tvec3(x + v.x, y + v.y, z + v.z); }
+		constexpr tvec3 operator-(const tvec3 &v) const { return tvec3(x - v.x, y - v.y, z - v.z); }
+		constexpr tvec3 operator-() const { return tvec3(-x, -y, -z); }
+		constexpr tvec3 operator*(T f) const { return tvec3(x * f, y * f, z * f); }
+		constexpr tvec3 operator/(T f) const { return tvec3(x / f, y / f, z / f); }
+
+		constexpr T dot(const tvec3 &v) const { return x * v.x + y * v.y + z * v.z; }
+		constexpr tvec3 cross(const tvec3 &v) const
+		{
+			return tvec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
+		}
+		constexpr T length() const { return T(csqrt(double(dot(*this)))); }
+		constexpr tvec3 normalized() const { return *this / length(); }
+	};
+
+	/*MATRIX*/
+	template<typename T, typename Storage> struct tmat4storage;
+
+	template<typename T>
+	struct tmat4storage<T, RowMajor>
+	{
+		T e[16];
+		constexpr tmat4storage(
+			T m00, T m01, T m02, T m03, T m10, T m11, T m12, T m13,
+			T m20, T m21, T m22, T m23, T m30, T m31, T m32, T m33)
+			: e{ m00, m01, m02, m03, m10, m11, m12, m13,
+				m20, m21, m22, m23, m30, m31, m32, m33 } {}
+	};
+
+	template<typename T>
+	struct tmat4storage<T, ColumnMajor>
+	{
+		T e[16];
+		constexpr tmat4storage(
+			T m00, T m01, T m02, T m03, T m10, T m11, T m12, T m13,
+			T m20, T m21, T m22, T m23, T m30, T m31, T m32, T m33)
+			: e{ m00, m10, m20, m30, m01, m11, m21, m31,
+				m02, m12, m22, m32, m03, m13, m23, m33 } {}
+	};
+
+	//constructor arguments and at() are always in math (row, col) order,
+	//only the memory layout follows Storage
+	template<typename T, typename Storage = RowMajor>
+	struct tmat4 : tmat4storage<T, Storage>
+	{
+		typedef tmat4storage<T, Storage> base;
+
+		constexpr tmat4()
+			: base(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1) {}
+		constexpr tmat4(
+			T m00, T m01, T m02, T m03, T m10, T m11, T m12, T m13,
+			T m20, T m21, T m22, T m23, T m30, T m31, T m32, T m33)
+			: base(m00, m01, m02, m03, m10, m11, m12, m13,
+				m20, m21, m22, m23, m30, m31, m32, m33) {}
+
+		constexpr T at(int row, int col) const { return this->e[Storage::index(row, col)]; }
+		const T* data() const { return this->e; }
+
+		template<typename S>
+		constexpr T rowCol(const tmat4<T, S> &b, int row, int col) const
+		{
+			return at(row, 0) * b.at(0, col) + at(row, 1) * b.at(1, col) +
+				at(row, 2) * b.at(2, col) + at(row, 3) * b.at(3, col);
+		}
+
+		template<typename S>
+		constexpr tmat4 operator*(const tmat4<T, S> &b) const
+		{
+			return tmat4(
+				rowCol(b, 0, 0), rowCol(b, 0, 1), rowCol(b, 0, 2), rowCol(b, 0, 3),
+				rowCol(b, 1, 0), rowCol(b, 1, 1), rowCol(b, 1, 2), rowCol(b, 1, 3),
+				rowCol(b, 2, 0), rowCol(b, 2, 1), rowCol(b, 2, 2), rowCol(b, 2, 3),
+				rowCol(b, 3, 0), rowCol(b, 3, 1), rowCol(b, 3, 2), rowCol(b, 3, 3));
+		}
+
+		//point transform, w assumed 1 and dropped
+		constexpr tvec3<T> operator*(const tvec3<T> &v) const
+		{
+			return tvec3<T>(
+				at(0, 0) * v.x + at(0, 1) * v.y + at(0, 2) * v.z + at(0, 3),
+				at(1, 0) * v.x + at(1, 1) * v.y + at(1, 2) * v.z + at(1, 3),
+				at(2, 0) * v.x + at(2, 1) * v.y + at(2, 2) * v.z + at(2, 3));
+		}
+
+		constexpr tmat4 transposed() const
+		{
+			return tmat4(
+				at(0, 0), at(1, 0), at(2, 0), at(3, 0), at(0, 1), at(1, 1), at(2, 1), at(3, 1),
+				at(0, 2), at(1, 2), at(2, 2), at(3, 2), at(0, 3), at(1, 3), at(2, 3), at(3, 3));
+		}
+
+		//same matrix in another memory layout
+		template<typename S>
+		constexpr tmat4<T, S> stored() const
+		{
+			return tmat4<T, S>(
+				at(0, 0), at(0, 1), at(0, 2), at(0, 3), at(1, 0), at(1, 1), at(1, 2), at(1, 3),
+				at(2, 0), at(2, 1), at(2, 2), at(2, 3), at(3, 0), at(3, 1), at(3, 2), at(3, 3));
+		}
+
+		static constexpr tmat4 translation(const tvec3<T> &t)
+		{
+			return tmat4(1, 0, 0, t.x, 0, 1, 0, t.y, 0, 0, 1, t.z, 0, 0, 0, 1);
+		}
+		static constexpr tmat4 scaling(const tvec3<T> &s)
+		{
+			return tmat4(s.x, 0, 0, 0, 0, s.y, 0, 0, 0, 0, s.z, 0, 0, 0, 0, 1);
+		}
+	};
+
+	typedef tvec2<float> vec2c;
+	typedef tvec3<float> vec3c;
+	typedef tmat4<float, RowMajor> mat4c;
+	typedef tmat4<float, ColumnMajor> mat4c_glsl;
+
+	/*PROJECTION AND VIEW*/
+	namespace detail
+	{
+		template<typename C, typename T, typename S>
+		constexpr tmat4<T, S> perspective(T f, T aspect, T znear, T zfar)
+		{
+			return tmat4<T, S>(
+				f / aspect, 0, 0, 0,
+				0, C::clip::template y<T>() * f, 0, 0,
+				0, 0, T(C::handedness::forward()) * C::depth::scale(znear, zfar), C::depth::offset(znear, zfar),
+				0, 0, T(C::handedness::forward()), 0);
+		}
+
+		template<typename T, typename S>
+		constexpr tmat4<T, S> viewRows(const tvec3<T> &s, const tvec3<T> &u, const tvec3<T> &b, const tvec3<T> &eye)
+		{
+			return tmat4<T, S>(
+				s.x, s.y, s.z, -s.dot(eye),
+				u.x, u.y, u.z, -u.dot(eye),
+				b.x, b.y, b.z, -b.dot(eye),
+				0, 0, 0, 1);
+		}
+
+		//side and back axis known, up follows from them
+		template<typename H, typename T, typename S>
+		constexpr tmat4<T, S> viewSide(const tvec3<T> &f, const tvec3<T> &s, const tvec3<T> &eye)
+		{
+			return viewRows<T, S>(s, s.cross(f) * T(-H::forward()), f * T(H::forward()), eye);
+		}
+
+		template<typename H, typename T, typename S>
+		constexpr tmat4<T, S> viewForward(const tvec3<T> &f, const tvec3<T> &up, const tvec3<T> &eye)
+		{
+			return viewSide<H, T, S>(f, (f.cross(up) * T(-H::forward())).normalized(), eye);
+		}
+	}
+
+	//fovY in degrees, the convention's clip fixup is folded into the matrix
+	template<typename C, typename T = float, typename S = RowMajor>
+	constexpr tmat4<T, S> perspective(typename detail::identity<T>::type fovY, typename detail::identity<T>::type aspect,
+		typename detail::identity<T>::type znear, typename detail::identity<T>::type zfar)
+	{
+		return detail::perspective<C, T, S>(T(1.0 / ctan(double(cradians(float(fovY))) * 0.5)),
+			aspect, znear, zfar);
+	}
+
+	//the same for a field of view only known at run time, tan instead of the series
+	template<typename C, typename T = float, typename S = RowMajor>
+	inline tmat4<T, S> perspectiveRuntime(typename detail::identity<T>::type fovY, typename detail::identity<T>::type aspect,
+		typename detail::identity<T>::type znear, typename detail::identity<T>::type zfar)
+	{
+		return detail::perspective<C, T, S>(T(1.0 / tan(double(cradians(float(fovY))) * 0.5)),
+			aspect, znear, zfar);
+	}
+
+	template<typename C, typename T = float, typename S = RowMajor>
+	constexpr tmat4<T, S> lookAt(const typename detail::identity<tvec3<T>>::type &eye,
+		const typename detail::identity<tvec3<T>>::type &center, const typename detail::identity<tvec3<T>>::type &up)
+	{
+		return detail::viewForward<typename C::handedness, T, S>((center - eye).normalized(), up, eye);
+	}
+}
+
+#endif // TMATH_H
@@ -0,0 +1,223 @@
+#include "vec3soa.h"
+#include <matrix4x4.h>
+#include <simd.h>
+#include <float.h>
+
+void vec3soa::assign(const vec3f* v, size_t count, size_t stride)
+{
+	resize(count);
+	const char* src = (const char*)v;
+	for (size_t i = 0; i < count; ++i, src += stride)
+	{
+		const vec3f &p = *(const vec3f*)src;
+		x[i] = p.x;
+		y[i] = p.y;
+		z[i] = p.z;
+	}
+}
+
+void vec3soa::copyTo(vec3f* v, size_t stride) const
+{
+	char* dst = (char*)v;
+	for (size_t i = 0; i < size(); ++i, dst += stride)
+		*(vec3f*)dst = vec3f(x[i], y[i], z[i]);
+}
+
+#if VML_SIMD != VML_SIMD_NONE
+namespace
+{
+	using namespace simd;
+
+	//each kernel returns how many elements it handled, the scalar code does the tail
+	template<typename V>
+	size_t pointsKernel(const Matrix4x4 &m, const vec3soa &in, vec3soa &out)
+	{
+		typedef lanes<V> L;
+		V m00 = L::splat(m.m[0][0]), m01 = L::splat(m.m[0][1]), m02 = L::splat(m.m[0][2]), m03 = L::splat(m.m[0][3]);
+		V m10 = L::splat(m.m[1][0]), m11 = L::splat(m.m[1][1]), m12 = L::splat(m.m[1][2]), m13 = L::splat(m.m[1][3]);
+		V m20 = L::splat(m.m[2][0]), m21 = L::splat(m.m[2][1]), m22 = L::splat(m.m[2][2]), m23 = L::splat(m.m[2][3]);
+
+		size_t count = in.size() / L::width * L::width;
+		for (size_t i = 0; i < count; i += L::width)
+		{
+			V x = L::load(&in.x[i]);
+			V y = L::load(&in.y[i]);
+			V z = L::load(&in.z[i]);
+			store(&out.x[i], add(madd(z, m02, madd(y, m01, mul(x, m00))), m03));
+			store(&out.y[i], add(madd(z, m12, madd(y, m11, mul(x, m10))), m13));
+			store(&out.z[i], add(madd(z, m22, madd(y, m21, mul(x, m20))), m23));
+		}
+		return count;
+	}
+
+	template<typename V>
+	size_t normalsKernel(const Matrix4x4 &m, const vec3soa &in, vec3soa &out)
+	{
+		typedef lanes<V> L;
+		V m00 = L::splat(m.m[0][0]), m01 = L::splat(m.m[0][1]), m02 = L::splat(m.m[0][2]);
+		V m10 = L::splat(m.m[1][0]), m11 = L::splat(m.m[1][1]), m12 = L::splat(m.m[1][2]);
+		V m20 = L::splat(m.m[2][0]), m21 = L::splat(m.m[2][1]), m22 = L::splat(m.m[2][2]);
+		V one = L::splat(1.0f);
+
+		size_t count = in.size() / L::width * L::width;
+		for (size_t i = 0; i < count; i += L::width)
+		{
+			V x = L::load(&in.x[i]);
+			V y = L::load(&in.y[i]);
+			V z = L::load(&in.z[i]);
+			V nx = madd(z, m02, madd(y, m01, mul(x, m00)));
+			V ny = madd(z, m12, madd(y, m11, mul(x, m10)));
+			V nz = madd(z, m22, madd(y, m21, mul(x, m20)));
+			//same reciprocal multiply as vec3f::normalize
+			V inv = div(one, sqrt(madd(nz, nz, madd(ny, ny, mul(nx, nx)))));
+			store(&out.x[i], mul(nx, inv));
+			store(&out.y[i], mul(ny, inv));
+			store(&out.z[i], mul(nz, inv));
+		}
+		return count;
+	}
+
+	//4 matrices per step, a transpose turns their rows into per lane coefficients
+	size_t instancesKernel(const Matrix4x4* matrices, const vec3soa &in, vec3soa &out)
+	{
+		size_t count = in.size() / 4 * 4;
+		for (size_t i = 0; i < count; i += 4)
+		{
+			float4 x = load(&in.x[i]);
+			float4 y = load(&in.y[i]);
+			float4 z = load(&in.z[i]);
+			float4 r[3];
+			for (int row = 0; row < 3; ++row)
+			{
+				float4 c0 = load(matrices[i + 0].m[row]);
+				float4 c1 = load(matrices[i + 1].m[row]);
+				float4 c2 = load(matrices[i + 2].m[row]);
+				float4 c3 = load(matrices[i + 3].m[row]);
+				transpose(c0, c1, c2, c3);
+				r[row] = add(madd(z, c2, madd(y, c1, mul(x, c0))), c3);
+			}
+			store(&out.x[i], r[0]);
+			store(&out.y[i], r[1]);
+			store(&out.z[i], r[2]);
+		}
+		return count;
+	}
+
+	template<typename V>
+	size_t boundsKernel(const vec3soa &in, vec3f &bmin, vec3f &bmax)
+	{
+		typedef lanes<V> L;
+		size_t count = in.size() / L::width * L::width;
+		if (count == 0) return 0;
+
+		V minX = L::load(&in.x[0]), minY = L::load(&in.y[0]), minZ = L::load(&in.z[0]);
+		V maxX = minX, maxY = minY, maxZ = minZ;
+		for (size_t i = L::width; i < count; i += L::width)
+		{
+			V x = L::load(&in.x[i]);
+			V y = L::load(&in.y[i]);
+			V z = L::load(&in.z[i]);
+			minX = min(minX, x); maxX = max(maxX, x);
+			minY = min(minY, y); maxY = max(maxY, y);
+			minZ = min(minZ, z); maxZ = max(maxZ, z);
+		}
+
+		float lanesMin[3][L::width], lanesMax[3][L::width];
+		store(lanesMin[0], minX); store(lanesMax[0], maxX);
+		store(lanesMin[1], minY); store(lanesMax[1], maxY);
+		store(lanesMin[2], minZ); store(lanesMax[2], maxZ);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (int lane = 0; lane < L::width; ++lane)
+			{
+				bmin[axis] = std::min(bmin[axis], lanesMin[axis][lane]);
+				bmax[axis] = std::max(bmax[axis], lanesMax[axis][lane]);
+			}
+		}
+		return count;
+	}
+}
+#endif
+
+void vml::transformPoints(const Matrix4x4 &m, const vec3soa &in, vec3soa &out)
+{
+	out.resize(in.size());
+	size_t done = 0;
+#if VML_SIMD != VML_SIMD_NONE
+	done = pointsKernel<simd::floatN>(m, in, out);
+#endif
+	for (size_t i = done; i < in.size(); ++i)
+		out.set(i, vml::scalar::transform(m, in.get(i)));
+}
+
+void vml::transformNormals(const Matrix4x4 &m, const vec3soa &in, vec3soa &out)
+{
+	out.resize(in.size());
+	size_t done = 0;
+#if VML_SIMD != VML_SIMD_NONE
+	done = normalsKernel<simd::floatN>(m, in, out);
+#endif
+	Matrix4x4 M = m;
+	for (size_t i = done; i < in.size(); ++i)
+		out.set(i, M.normal(in.get(i)));
+}
+
+void vml::transformInstances(const Matrix4x4* matrices, const vec3soa &in, vec3soa &out)
+{
+	out.resize(in.size());
+	size_t done = 0;
+#if VML_SIMD != VML_SIMD_NONE
+	done = instancesKernel(matrices, in, out);
+#endif
+	for (size_t i = done; i < in.size(); ++i)
+		out.set(i, vml::scalar::transform(matrices[i], in.get(i)));
+}
+
+void vml::bounds(const vec3soa &in, vec3f &min, vec3f &max)
+{
+	min = vec3f(FLT_MAX);
+	max = vec3f(-FLT_MAX);
+	size_t done = 0;
+#if VML_SIMD != VML_SIMD_NONE
+	done = boundsKernel<simd::floatN>(in, min, max);
+#endif
+	for (size_t i = done; i < in.size(); ++i)
+	{
+		min = vec3f(std::min(min.x, in.x[i]), std::min(min.y, in.y[i]), std::min(min.z, in.z[i]));
+		max = vec3f(std::max(max.x, in.x[i]), std::max(max.y, in.y[i]), std::max(max.z, in.z[i]));
+	}
+}
+
+/*SCALAR REFERENCE*/
+void vml::scalar::transformPoints(const Matrix4x4 &m, const vec3soa &in, vec3soa &out)
+{
+	out.resize(in.size());
+	for (size_t i = 0; i < in.size(); ++i)
+		out.set(i, vml::scalar::transform(m, in.get(i)));
+}
+
+void vml::scalar::transformNormals(const Matrix4x4 &m, const vec3soa &in, vec3soa &out)
+{
+	out.resize(in.size());
+	Matrix4x4 M = m;
+	for (size_t i = 0; i < in.size(); ++i)
+		out.set(i, M.normal(in.get(i)));
+}
+
+void vml::scalar::transformInstances(const Matrix4x4* matrices, const vec3soa &in, vec3soa &out)
+{
+	out.resize(in.size());
+	for (size_t i = 0; i < in.size(); ++i)
+		out.set(i, vml::scalar::transform(matrices[i], in.get(i)));
+}
+
+void vml::scalar::bounds(const vec3soa &in, vec3f &min, vec3f &max)
+{
+	min = vec3f(FLT_MAX);
+	max = vec3f(-FLT_MAX);
+	for (size_t i = 0; i < in.size(); ++i)
+	{
+		min = vec3f(std::min(min.x, in.x[i]), std::min(min.y, in.y[i]), std::min(min.z, in.z[i]));
+		max = vec3f(std::max(max.x, in.x[i]), std::max(max.y, in.y[i]), std::max(max.z, in.z[i]));
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef VEC3SOA_H
+#define VEC3SOA_H
+
+#include <vector>
+#include <vec3f.h>
+
+class Matrix4x4;
+
+//structure of arrays vec3 stream, one float array per component so the
+//batch kernels below can fill a whole register from each array
+class vec3soa
+{
+public:
+	vec3soa() {}
+	explicit vec3soa(size_t count) { resize(count); }
+	vec3soa(const vec3f* v, size_t count) { assign(v, count); }
+
+	std::vector<float> x, y, z;
+
+	size_t size() const { return x.size(); }
+	void resize(size_t count) { x.resize(count); y.resize(count); z.resize(count); }
+	void clear() { x.clear(); y.clear(); z.clear(); }
+
+	vec3f get(size_t i) const { return vec3f(x[i], y[i], z[i]); }
+	void set(size_t i, const vec3f &v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+
+	//convert from / to the 12 byte AoS layout, stride in bytes for interleaved vertices
+	void assign(const vec3f* v, size_t count, size_t stride = sizeof(vec3f));
+	void copyTo(vec3f* v, size_t stride = sizeof(vec3f)) const;
+};
+
+/*BATCH TRANSFORMS*/
+//8 wide on AVX builds, 4 wide on SSE/NEON, out is resized to match and may alias in.
+//results match the per element Matrix4x4 operators bit for bit
+namespace vml
+{
+	//out[i] = m * in[i] as a point
+	void transformPoints(const Matrix4x4 &m, const vec3soa &in, vec3soa &out);
+	//out[i] = normalize(upper 3x3 of m * in[i]), pass the inverse transpose
+	//for non uniform scale, same as Matrix4x4::normal
+	void transformNormals(const Matrix4x4 &m, const vec3soa &in, vec3soa &out);
+	//out[i] = matrices[i] * in[i], one point per instance
+	void transformInstances(const Matrix4x4* matrices, const vec3soa &in, vec3soa &out);
+	//axis aligned bounds of the stream, min > max when empty
+	void bounds(const vec3soa &in, vec3f &min, vec3f &max);
+
+	namespace scalar
+	{
+		void transformPoints(const Matrix4x4 &m, const vec3soa &in, vec3soa &out);
+		void transformNormals(const Matrix4x4 &m, const vec3soa &in, vec3soa &out);
+		void transformInstances(const Matrix4x4* matrices, const vec3soa &in, vec3soa &out);
+		void bounds(const vec3soa &in, vec3f &min, vec3f &max);
+	}
+}
+
+#endif // VEC3SOA_H